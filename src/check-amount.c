@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include "check-amount.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+static inline bool
+check_amount_is_digit (char ch)
+{
+  return ch >= '0' && ch <= '9';
+}
+
+static inline bool
+check_amount_is_blank (char ch)
+{
+  return ch == ' ' || ch == '\t';
+}
+
+static CheckAmountStatus
+check_amount_fail (CheckAmountStatus status,
+                   const char *text,
+                   const char *cur,
+                   gsize *error_pos)
+{
+  if (error_pos)
+    {
+      *error_pos = (gsize) (cur - text);
+    }
+
+  return status;
+}
+
+/*
+ * Parse `text` in a single pass. On success, stores the amount in `cents`.
+ * On failure, `error_pos` (if not NULL) receives the byte offset of the first
+ * character that could not be accepted.
+ */
+CheckAmountStatus
+check_amount_parse (const char *text, gint64 *cents, gsize *error_pos)
+{
+  const char *cur = text;
+  gint64 dollars = 0;
+  int n_dollar_digits = 0;
+  int n_cent_digits = 0;
+  int group_len = 0;
+  bool grouped = false;
+  int cent_value = 0;
+
+  if (!text)
+    {
+      return CHECK_AMOUNT_ERROR_EMPTY;
+    }
+
+  while (check_amount_is_blank (*cur))
+    {
+      ++cur;
+    }
+
+  if (*cur == '$')
+    {
+      ++cur;
+
+      while (check_amount_is_blank (*cur))
+        {
+          ++cur;
+        }
+    }
+
+  /* Dollars, optionally grouped by thousands */
+  for (;; ++cur)
+    {
+      char ch = *cur;
+
+      if (check_amount_is_digit (ch))
+        {
+          dollars = (dollars * 10) + (ch - '0');
+          ++n_dollar_digits;
+          ++group_len;
+
+          if (dollars > CHECK_AMOUNT_MAX_DOLLARS)
+            {
+              return check_amount_fail (CHECK_AMOUNT_ERROR_RANGE, text, cur, error_pos);
+            }
+
+          if (grouped && group_len > 3)
+            {
+              return check_amount_fail (CHECK_AMOUNT_ERROR_GROUPING, text, cur, error_pos);
+            }
+        }
+      else if (ch == ',')
+        {
+          /* The first group has 1 to 3 digits, every later one exactly 3 */
+          if (group_len == 0 || group_len > 3 || (grouped && group_len != 3))
+            {
+              return check_amount_fail (CHECK_AMOUNT_ERROR_GROUPING, text, cur, error_pos);
+            }
+
+          grouped = true;
+          group_len = 0;
+        }
+      else
+        {
+          break;
+        }
+    }
+
+  if (grouped && group_len != 3)
+    {
+      return check_amount_fail (CHECK_AMOUNT_ERROR_GROUPING, text, cur, error_pos);
+    }
+
+  /* Cents */
+  if (*cur == '.')
+    {
+      ++cur;
+
+      for (; check_amount_is_digit (*cur); ++cur)
+        {
+          if (n_cent_digits == 2)
+            {
+              return check_amount_fail (CHECK_AMOUNT_ERROR_CENTS, text, cur, error_pos);
+            }
+
+          cent_value = (cent_value * 10) + (*cur - '0');
+          ++n_cent_digits;
+        }
+
+      if (n_cent_digits == 1)
+        {
+          cent_value *= 10;
+        }
+    }
+
+  while (check_amount_is_blank (*cur))
+    {
+      ++cur;
+    }
+
+  if (*cur != '\0')
+    {
+      return check_amount_fail (CHECK_AMOUNT_ERROR_CHARACTER, text, cur, error_pos);
+    }
+
+  if (n_dollar_digits == 0 && n_cent_digits == 0)
+    {
+      return check_amount_fail (CHECK_AMOUNT_ERROR_EMPTY, text, cur, error_pos);
+    }
+
+  if (cents)
+    {
+      *cents = (dollars * 100) + cent_value;
+    }
+
+  return CHECK_AMOUNT_OK;
+}
+
+const char *
+check_amount_status_to_string (CheckAmountStatus status)
+{
+  switch (status)
+    {
+    case CHECK_AMOUNT_OK:
+      return "Valid amount";
+    case CHECK_AMOUNT_ERROR_EMPTY:
+      return "No amount given";
+    case CHECK_AMOUNT_ERROR_CHARACTER:
+      return "Unexpected character";
+    case CHECK_AMOUNT_ERROR_GROUPING:
+      return "Misplaced thousands separator";
+    case CHECK_AMOUNT_ERROR_CENTS:
+      return "More than two decimal places";
+    case CHECK_AMOUNT_ERROR_RANGE:
+      return "Amount too large";
+    default:
+      return "Invalid amount";
+    }
+}
+
+/*
+ * Write `cents` as dollars with thousands separators, e.g. "1,234.56".
+ * Returns the string length, or -1 if it is out of range or does not fit.
+ */
+int
+check_amount_format (char *dst, gsize len, gint64 cents)
+{
+  char buffer[32];
+  char *cur = buffer + sizeof (buffer);
+  guint64 dollars;
+  int n_digits = 0;
+  gsize n;
+
+  if (!dst || cents < 0 || cents > CHECK_AMOUNT_MAX_CENTS)
+    {
+      return -1;
+    }
+
+  dollars = (guint64) cents / 100;
+
+  /* Built from the end: cents, the point, then dollars in groups of three */
+  *--cur = '0' + (cents % 10);
+  *--cur = '0' + ((cents / 10) % 10);
+  *--cur = '.';
+
+  do
+    {
+      if (n_digits && (n_digits % 3) == 0)
+        {
+          *--cur = ',';
+        }
+
+      *--cur = '0' + (dollars % 10);
+      dollars /= 10;
+      ++n_digits;
+    }
+  while (dollars);
+
+  n = (gsize) ((buffer + sizeof (buffer)) - cur);
+
+  if (n >= len)
+    {
+      return -1;
+    }
+
+  memcpy (dst, cur, n);
+  dst[n] = '\0';
+
+  return (int) n;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef CHECKWRITER_CHECK_AMOUNT_H_
+#define CHECKWRITER_CHECK_AMOUNT_H_
+
+#include <glib.h>
+
+/*
+ * Amounts are handled as a whole number of cents. The parser does not depend
+ * on the locale and accepts, with optional surrounding blanks:
+ *
+ *   [$] digits [. [d [d]]]           1234   1234.5   $1234.56   .99
+ *   [$] d[d[d]] (,ddd)* [. [d [d]]]  1,234,567.89
+ *
+ * One decimal place means tenths ("1.5" is $1.50). Dollars are limited to
+ * what num_to_words () can spell, G_MAXUINT32.
+ */
+
+#define CHECK_AMOUNT_MAX_DOLLARS ((gint64) G_MAXUINT32)
+#define CHECK_AMOUNT_MAX_CENTS ((CHECK_AMOUNT_MAX_DOLLARS * 100) + 99)
+
+typedef enum
+{
+  CHECK_AMOUNT_OK,
+  CHECK_AMOUNT_ERROR_EMPTY,     /* No digits */
+  CHECK_AMOUNT_ERROR_CHARACTER, /* Unexpected character */
+  CHECK_AMOUNT_ERROR_GROUPING,  /* Thousands separator out of place */
+  CHECK_AMOUNT_ERROR_CENTS,     /* More than two decimal places */
+  CHECK_AMOUNT_ERROR_RANGE,     /* Larger than CHECK_AMOUNT_MAX_DOLLARS */
+} CheckAmountStatus;
+
+CheckAmountStatus check_amount_parse (const char *text,
+                                      gint64 *cents,
+                                      gsize *error_pos);
+
+const char *check_amount_status_to_string (CheckAmountStatus status);
+
+int check_amount_format (char *dst,
+                         gsize len,
+                         gint64 cents);
+
+#endif /* CHECKWRITER_CHECK_AMOUNT_H_ */
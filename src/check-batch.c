@@ -0,0 +1,804 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include "check-batch.h"
+#include "check-amount.h"
+#include "check-micr.h"
+
+#include <string.h>
+
+#define CSV_FIELD_DATE (0)
+#define CSV_FIELD_NAME (1)
+#define CSV_FIELD_AMOUNT (2)
+#define CSV_FIELD_MEMO (3)
+#define CSV_FIELD_CHECK_NUMBER (4)
+#define CSV_FIELD_ROUTING (5)
+#define CSV_FIELD_ACCOUNT (6)
+#define CSV_N_FIELDS (7)
+
+/* Strings never straddle blocks, so a block can only be partly used */
+#define CHECK_BATCH_BLOCK_SIZE (64 * 1024)
+#define CHECK_BATCH_MAX_BLOCKS (G_MAXUINT16 + 1)
+
+/* Arena string: block index in the high 16 bits, offset in the low 16 bits */
+typedef guint32 CheckBatchString;
+
+typedef struct check_batch_record
+{
+  gint64 cents;
+
+  CheckBatchString date;
+  CheckBatchString name;
+  CheckBatchString memo;
+  CheckBatchString check_number;
+  CheckBatchString routing;
+  CheckBatchString account;
+
+  /* Lengths without the NUL, always below STRING_LEN */
+  guint8 date_len;
+  guint8 name_len;
+  guint8 memo_len;
+  guint8 check_number_len;
+  guint8 routing_len;
+  guint8 account_len;
+
+  guint8 flags; /* CheckBatchFlags */
+} CheckBatchRecord;
+
+G_STATIC_ASSERT (STRING_LEN <= (G_MAXUINT8 + 1));
+G_STATIC_ASSERT (sizeof (CheckBatchRecord) == 40);
+
+struct check_batch
+{
+  GArray *records; /* CheckBatchRecord */
+
+  /* String arena: blocks of CHECK_BATCH_BLOCK_SIZE bytes, the last one in use */
+  GPtrArray *blocks;
+  gsize block_used;
+
+  /* Arena string -> CheckBatchString, for interning */
+  GHashTable *strings;
+};
+
+G_DEFINE_QUARK (check-batch-error-quark, check_batch_error)
+
+/**
+ * String arena
+ */
+
+static inline const char *
+check_batch_string_get (const CheckBatch *batch, CheckBatchString string)
+{
+  const char *block = g_ptr_array_index (batch->blocks, string >> 16);
+
+  return block + (string & 0xFFFF);
+}
+
+/*
+ * Store `text`, truncated to STRING_LEN - 1 bytes, or find the copy stored
+ * earlier. Returns false once the arena is full.
+ */
+static bool
+check_batch_intern (CheckBatch *batch,
+                    const char *text,
+                    CheckBatchString *string,
+                    guint8 *length)
+{
+  char truncated[STRING_LEN];
+  gpointer value = NULL;
+  gsize len = strnlen (text, STRING_LEN);
+  char *dst = NULL;
+
+  if (len >= STRING_LEN)
+    {
+      len = STRING_LEN - 1;
+      memcpy (truncated, text, len);
+      truncated[len] = '\0';
+      text = truncated;
+    }
+
+  *length = (guint8) len;
+
+  if (g_hash_table_lookup_extended (batch->strings, text, NULL, &value))
+    {
+      *string = GPOINTER_TO_UINT (value);
+      return true;
+    }
+
+  if (batch->blocks->len == 0 || (batch->block_used + len + 1) > CHECK_BATCH_BLOCK_SIZE)
+    {
+      if (batch->blocks->len == CHECK_BATCH_MAX_BLOCKS)
+        {
+          return false;
+        }
+
+      g_ptr_array_add (batch->blocks, g_malloc (CHECK_BATCH_BLOCK_SIZE));
+      batch->block_used = 0;
+    }
+
+  dst = (char *) g_ptr_array_index (batch->blocks, batch->blocks->len - 1) + batch->block_used;
+  memcpy (dst, text, len + 1);
+
+  *string = ((batch->blocks->len - 1) << 16) | (guint32) batch->block_used;
+  batch->block_used += len + 1;
+
+  g_hash_table_insert (batch->strings, dst, GUINT_TO_POINTER (*string));
+
+  return true;
+}
+
+static inline void
+check_batch_string_copy (const CheckBatch *batch,
+                         CheckBatchString string,
+                         guint8 length,
+                         char *dst)
+{
+  memcpy (dst, check_batch_string_get (batch, string), length);
+  dst[length] = '\0';
+}
+
+/**
+ * Batch
+ */
+
+CheckBatch *
+check_batch_new (void)
+{
+  CheckBatch *batch = g_new0 (CheckBatch, 1);
+
+  batch->records = g_array_new (FALSE, FALSE, sizeof (CheckBatchRecord));
+  batch->blocks = g_ptr_array_new_with_free_func (g_free);
+  batch->strings = g_hash_table_new (g_str_hash, g_str_equal);
+
+  return batch;
+}
+
+void
+check_batch_free (CheckBatch *batch)
+{
+  if (!batch)
+    {
+      return;
+    }
+
+  g_hash_table_unref (batch->strings);
+  g_ptr_array_unref (batch->blocks);
+  g_array_unref (batch->records);
+  g_free (batch);
+}
+
+guint
+check_batch_get_n_checks (const CheckBatch *batch)
+{
+  g_return_val_if_fail (batch != NULL, 0);
+
+  return batch->records->len;
+}
+
+/*
+ * Add a check. Strings longer than a CheckData field are truncated. The MICR
+ * fields may be NULL for a check without a MICR line. Returns false if
+ * `cents` is out of range, the MICR fields do not make a valid line, or the
+ * string arena is full.
+ */
+bool
+check_batch_append (CheckBatch *batch,
+                    const char *date,
+                    const char *name,
+                    gint64 cents,
+                    const char *memo,
+                    const char *check_number,
+                    const char *routing,
+                    const char *account)
+{
+  char micr[CHECK_MICR_LINE_LEN];
+  CheckBatchRecord record;
+
+  g_return_val_if_fail (batch != NULL, false);
+
+  if (cents < 0 || cents > CHECK_AMOUNT_MAX_CENTS)
+    {
+      return false;
+    }
+
+  if (check_micr_format_line (micr, sizeof (micr), check_number, routing, account) != CHECK_MICR_OK)
+    {
+      return false;
+    }
+
+  record.cents = cents;
+  record.flags = 0;
+
+  if (!check_batch_intern (batch, date ? date : "", &record.date, &record.date_len)
+      || !check_batch_intern (batch, name ? name : "", &record.name, &record.name_len)
+      || !check_batch_intern (batch, memo ? memo : "", &record.memo, &record.memo_len)
+      || !check_batch_intern (batch, check_number ? check_number : "",
+                              &record.check_number, &record.check_number_len)
+      || !check_batch_intern (batch, routing ? routing : "", &record.routing, &record.routing_len)
+      || !check_batch_intern (batch, account ? account : "", &record.account, &record.account_len))
+    {
+      return false;
+    }
+
+  g_array_append_val (batch->records, record);
+
+  return true;
+}
+
+/* Expand check `index` into what render_check_plan () draws */
+bool
+check_batch_get (const CheckBatch *batch, guint index, NumWordsLocale locale, CheckData *check_data)
+{
+  const CheckBatchRecord *record = NULL;
+  char check_number[STRING_LEN];
+  char routing[STRING_LEN];
+  char account[STRING_LEN];
+
+  g_return_val_if_fail (batch != NULL, false);
+  g_return_val_if_fail (check_data != NULL, false);
+
+  if (index >= batch->records->len)
+    {
+      return false;
+    }
+
+  record = &g_array_index (batch->records, CheckBatchRecord, index);
+
+  check_batch_string_copy (batch, record->date, record->date_len, check_data->date);
+  check_batch_string_copy (batch, record->name, record->name_len, check_data->name);
+  check_batch_string_copy (batch, record->memo, record->memo_len, check_data->memo);
+  check_batch_string_copy (batch, record->check_number, record->check_number_len, check_number);
+  check_batch_string_copy (batch, record->routing, record->routing_len, routing);
+  check_batch_string_copy (batch, record->account, record->account_len, account);
+
+  /* Validated by check_batch_append () */
+  check_data_set_micr (check_data, check_number, routing, account);
+
+  return check_data_set_amount_cents (check_data, record->cents, locale) == 0;
+}
+
+gint64
+check_batch_get_cents (const CheckBatch *batch, guint index)
+{
+  g_return_val_if_fail (batch != NULL, 0);
+  g_return_val_if_fail (index < batch->records->len, 0);
+
+  return g_array_index (batch->records, CheckBatchRecord, index).cents;
+}
+
+CheckBatchFlags
+check_batch_get_flags (const CheckBatch *batch, guint index)
+{
+  g_return_val_if_fail (batch != NULL, 0);
+  g_return_val_if_fail (index < batch->records->len, 0);
+
+  return g_array_index (batch->records, CheckBatchRecord, index).flags;
+}
+
+/* Approximate heap size of the batch, in bytes */
+gsize
+check_batch_get_memory_size (const CheckBatch *batch)
+{
+  gsize size;
+
+  g_return_val_if_fail (batch != NULL, 0);
+
+  size = sizeof (CheckBatch);
+  size += batch->records->len * sizeof (CheckBatchRecord);
+  size += batch->blocks->len * (CHECK_BATCH_BLOCK_SIZE + sizeof (gpointer));
+
+  /* A hash table node is about a hash, a key and a value */
+  size += g_hash_table_size (batch->strings) * (sizeof (guint) + (2 * sizeof (gpointer)));
+
+  return size;
+}
+
+/**
+ * Duplicates
+ *
+ * Checks are compared on a 64 bit hash of their payee, amount and date, so a
+ * false match is vanishingly unlikely. The hashes of the batch go into an
+ * open addressing table kept at most half full, with a blocked Bloom filter
+ * in front: 16 bits per check, in blocks of one cache line. Most checks are
+ * not duplicates, and the filter rules those out from a few percent of the
+ * memory of the table, which stays in the cache when the table does not.
+ */
+
+#define DUPLICATES_BLOOM_BLOCK_BITS (512)
+#define DUPLICATES_BLOOM_BITS_PER_CHECK (16)
+#define DUPLICATES_BLOOM_N_BITS (4) /* Set per check, 9 bits of the hash each */
+
+#define DUPLICATES_FNV_OFFSET G_GUINT64_CONSTANT (0xcbf29ce484222325)
+#define DUPLICATES_FNV_PRIME G_GUINT64_CONSTANT (0x100000001b3)
+
+typedef struct duplicates_entry
+{
+  guint64 key; /* 0 in an empty slot */
+  guint index; /* First check of the batch with the key */
+} DuplicatesEntry;
+
+typedef struct duplicates_set
+{
+  CheckBatch *batch;
+
+  guint64 *bloom;
+  gsize bloom_mask; /* Number of blocks - 1 */
+
+  DuplicatesEntry *entries;
+  gsize mask; /* Number of slots - 1 */
+} DuplicatesSet;
+
+/* The splitmix64 finalizer */
+static inline guint64
+duplicates_mix (guint64 hash)
+{
+  hash ^= hash >> 30;
+  hash *= G_GUINT64_CONSTANT (0xbf58476d1ce4e5b9);
+  hash ^= hash >> 27;
+  hash *= G_GUINT64_CONSTANT (0x94d049bb133111eb);
+  hash ^= hash >> 31;
+
+  return hash;
+}
+
+/* Never 0. `day` receives the date as YYYYMMDD, or 0 if it does not parse. */
+static guint64
+duplicates_key (const char *payee,
+                gsize payee_len,
+                gint64 cents,
+                const char *date,
+                gsize date_len,
+                guint32 *day)
+{
+  guint64 hash = DUPLICATES_FNV_OFFSET;
+
+  /* Letters and digits only; bytes of other UTF-8 characters are kept */
+  for (gsize i = 0; i < payee_len; ++i)
+    {
+      guchar c = payee[i];
+
+      if (c < 0x80)
+        {
+          if (!g_ascii_isalnum (c))
+            {
+              continue;
+            }
+
+          c |= 0x20; /* Lower case, digits already have the bit */
+        }
+
+      hash = (hash ^ c) * DUPLICATES_FNV_PRIME;
+    }
+
+  *day = check_ledger_parse_date (date, date_len);
+
+  if (*day == 0)
+    {
+      /* 0xFF never occurs in UTF-8, so the payee cannot run into the date */
+      hash = (hash ^ 0xFF) * DUPLICATES_FNV_PRIME;
+
+      for (gsize i = 0; i < date_len; ++i)
+        {
+          hash = (hash ^ (guchar) date[i]) * DUPLICATES_FNV_PRIME;
+        }
+    }
+
+  hash = duplicates_mix (hash ^ (guint64) cents);
+  hash = duplicates_mix (hash + *day);
+
+  return hash ? hash : 1;
+}
+
+static gsize
+duplicates_round_up (gsize n)
+{
+  gsize size = 1;
+
+  while (size < n)
+    {
+      size <<= 1;
+    }
+
+  return size;
+}
+
+static void
+duplicates_set_init (DuplicatesSet *set, CheckBatch *batch)
+{
+  guint n_checks = batch->records->len;
+  gsize n_blocks = duplicates_round_up (MAX (1, ((gsize) n_checks * DUPLICATES_BLOOM_BITS_PER_CHECK)
+                                                    / DUPLICATES_BLOOM_BLOCK_BITS));
+  gsize n_slots = duplicates_round_up (MAX (16, (gsize) n_checks * 2));
+
+  set->batch = batch;
+  set->bloom = g_new0 (guint64, n_blocks * (DUPLICATES_BLOOM_BLOCK_BITS / 64));
+  set->bloom_mask = n_blocks - 1;
+  set->entries = g_new0 (DuplicatesEntry, n_slots);
+  set->mask = n_slots - 1;
+}
+
+static void
+duplicates_set_clear (DuplicatesSet *set)
+{
+  g_clear_pointer (&set->bloom, g_free);
+  g_clear_pointer (&set->entries, g_free);
+}
+
+/* The high bits pick the block, the low ones the bits within it */
+static inline guint64 *
+duplicates_bloom_block (const DuplicatesSet *set, guint64 key)
+{
+  return set->bloom + (((key >> 40) & set->bloom_mask) * (DUPLICATES_BLOOM_BLOCK_BITS / 64));
+}
+
+static bool
+duplicates_bloom_contains (const DuplicatesSet *set, guint64 key)
+{
+  const guint64 *block = duplicates_bloom_block (set, key);
+
+  for (int i = 0; i < DUPLICATES_BLOOM_N_BITS; ++i)
+    {
+      guint bit = (key >> (9 * i)) & (DUPLICATES_BLOOM_BLOCK_BITS - 1);
+
+      if (!(block[bit / 64] & (G_GUINT64_CONSTANT (1) << (bit % 64))))
+        {
+          return false;
+        }
+    }
+
+  return true;
+}
+
+static void
+duplicates_bloom_add (DuplicatesSet *set, guint64 key)
+{
+  guint64 *block = duplicates_bloom_block (set, key);
+
+  for (int i = 0; i < DUPLICATES_BLOOM_N_BITS; ++i)
+    {
+      guint bit = (key >> (9 * i)) & (DUPLICATES_BLOOM_BLOCK_BITS - 1);
+
+      block[bit / 64] |= G_GUINT64_CONSTANT (1) << (bit % 64);
+    }
+}
+
+/* The slot holding `key`, or the empty slot where it belongs */
+static DuplicatesEntry *
+duplicates_lookup (const DuplicatesSet *set, guint64 key)
+{
+  gsize slot = key & set->mask;
+
+  while (set->entries[slot].key != 0 && set->entries[slot].key != key)
+    {
+      slot = (slot + 1) & set->mask;
+    }
+
+  return &set->entries[slot];
+}
+
+/* The first check of the batch with `key`, or NULL */
+static CheckBatchRecord *
+duplicates_find (const DuplicatesSet *set, guint64 key)
+{
+  const DuplicatesEntry *entry;
+
+  if (!duplicates_bloom_contains (set, key))
+    {
+      return NULL;
+    }
+
+  entry = duplicates_lookup (set, key);
+
+  return entry->key ? &g_array_index (set->batch->records, CheckBatchRecord, entry->index) : NULL;
+}
+
+static gboolean
+check_batch_match_issued (const CheckJournalRecord *record, gpointer user_data)
+{
+  const DuplicatesSet *set = user_data;
+  CheckBatchRecord *match;
+  guint32 day;
+  guint64 key;
+
+  key = duplicates_key (record->strings[CHECK_JOURNAL_PAYEE], record->lengths[CHECK_JOURNAL_PAYEE],
+                        record->cents, record->strings[CHECK_JOURNAL_DATE],
+                        record->lengths[CHECK_JOURNAL_DATE], &day);
+  match = duplicates_find (set, key);
+
+  if (match)
+    {
+      match->flags |= CHECK_BATCH_ISSUED;
+    }
+
+  return TRUE;
+}
+
+/*
+ * Flag the checks that repeat the payee, amount and date of an earlier check
+ * of the batch (CHECK_BATCH_DUPLICATE) or of a check of `ledger`, which may
+ * be NULL (CHECK_BATCH_ISSUED). Only the ledger checks dated within the
+ * dates of the batch are looked at. Flags set by an earlier call are
+ * cleared. Returns the number of checks flagged.
+ */
+guint
+check_batch_find_duplicates (CheckBatch *batch, const CheckLedger *ledger)
+{
+  DuplicatesSet set;
+  guint32 first_day = G_MAXUINT32, last_day = 0;
+  guint n_flagged = 0;
+
+  g_return_val_if_fail (batch != NULL, 0);
+
+  duplicates_set_init (&set, batch);
+
+  for (guint i = 0; i < batch->records->len; ++i)
+    {
+      CheckBatchRecord *record = &g_array_index (batch->records, CheckBatchRecord, i);
+      DuplicatesEntry *entry;
+      guint32 day;
+      guint64 key;
+
+      key = duplicates_key (check_batch_string_get (batch, record->name), record->name_len,
+                            record->cents, check_batch_string_get (batch, record->date),
+                            record->date_len, &day);
+      record->flags = 0;
+
+      if (day)
+        {
+          first_day = MIN (first_day, day);
+          last_day = MAX (last_day, day);
+        }
+
+      if (duplicates_find (&set, key))
+        {
+          record->flags = CHECK_BATCH_DUPLICATE;
+          continue;
+        }
+
+      duplicates_bloom_add (&set, key);
+      entry = duplicates_lookup (&set, key);
+      entry->key = key;
+      entry->index = i;
+    }
+
+  if (ledger && first_day <= last_day)
+    {
+      char first_date[16], last_date[16];
+
+      g_snprintf (first_date, sizeof (first_date), "%04u-%02u-%02u",
+                  first_day / 10000, (first_day / 100) % 100, first_day % 100);
+      g_snprintf (last_date, sizeof (last_date), "%04u-%02u-%02u",
+                  last_day / 10000, (last_day / 100) % 100, last_day % 100);
+
+      check_ledger_find_date (ledger, first_date, last_date, check_batch_match_issued, &set);
+    }
+
+  duplicates_set_clear (&set);
+
+  for (guint i = 0; i < batch->records->len; ++i)
+    {
+      n_flagged += g_array_index (batch->records, CheckBatchRecord, i).flags != 0;
+    }
+
+  return n_flagged;
+}
+
+/**
+ * CSV import
+ */
+
+/*
+ * Split one CSV line into at most `n_fields` fields, each copied into a
+ * STRING_LEN buffer. Returns the number of fields found, or -1 on an
+ * unterminated quote.
+ */
+static int
+check_batch_split_line (const char *line,
+                        const char *end,
+                        char fields[][STRING_LEN],
+                        int n_fields)
+{
+  const char *cur = line;
+  int field = 0;
+
+  while (field < n_fields)
+    {
+      char *dst = fields[field];
+      size_t len = 0;
+      gboolean quoted = FALSE;
+
+      if (cur < end && *cur == '"')
+        {
+          quoted = TRUE;
+          ++cur;
+        }
+
+      while (cur < end)
+        {
+          char ch = *cur;
+
+          if (quoted && ch == '"')
+            {
+              if ((cur + 1) < end && cur[1] == '"')
+                {
+                  /* Escaped quote */
+                  ++cur;
+                }
+              else
+                {
+                  quoted = FALSE;
+                  ++cur;
+                  continue;
+                }
+            }
+          else if (!quoted && ch == ',')
+            {
+              break;
+            }
+
+          if (len < (STRING_LEN - 1))
+            {
+              dst[len++] = ch;
+            }
+          ++cur;
+        }
+
+      if (quoted)
+        {
+          return -1;
+        }
+
+      dst[len] = '\0';
+      ++field;
+
+      if (cur >= end)
+        {
+          break;
+        }
+
+      /* Skip the separator */
+      ++cur;
+    }
+
+  return field;
+}
+
+CheckBatch *
+check_batch_load_csv (const char *path, GError **error)
+{
+  g_autofree char *contents = NULL;
+  gsize length = 0;
+  CheckBatch *batch = NULL;
+  const char *cur, *end;
+  guint line_nr = 0;
+
+  g_return_val_if_fail (path != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (!g_file_get_contents (path, &contents, &length, error))
+    {
+      return NULL;
+    }
+
+  batch = check_batch_new ();
+  cur = contents;
+  end = contents + length;
+
+  while (cur < end)
+    {
+      const char *eol = memchr (cur, '\n', end - cur);
+      const char *next = eol ? (eol + 1) : end;
+      char fields[CSV_N_FIELDS][STRING_LEN];
+      CheckMicrStatus micr_status;
+      CheckAmountStatus status;
+      char micr[CHECK_MICR_LINE_LEN];
+      gsize error_pos = 0;
+      gint64 cents = 0;
+      int n;
+
+      ++line_nr;
+
+      if (!eol)
+        {
+          eol = end;
+        }
+
+      /* Tolerate DOS line endings */
+      if (eol > cur && eol[-1] == '\r')
+        {
+          --eol;
+        }
+
+      if (eol == cur || *cur == '#')
+        {
+          cur = next;
+          continue;
+        }
+
+      memset (fields, 0, sizeof (fields));
+      n = check_batch_split_line (cur, eol, fields, CSV_N_FIELDS);
+      cur = next;
+
+      if (n < 0)
+        {
+          g_set_error (error, CHECK_BATCH_ERROR, CHECK_BATCH_ERROR_PARSE,
+                       "%s:%u: Unterminated quoted field", path, line_nr);
+          check_batch_free (batch);
+          return NULL;
+        }
+
+      if (n < (CSV_FIELD_AMOUNT + 1))
+        {
+          g_set_error (error, CHECK_BATCH_ERROR, CHECK_BATCH_ERROR_PARSE,
+                       "%s:%u: Expected at least %d fields, found %d",
+                       path, line_nr, CSV_FIELD_AMOUNT + 1, n);
+          check_batch_free (batch);
+          return NULL;
+        }
+
+      /* Skip header row */
+      if (batch->records->len == 0 && g_ascii_strcasecmp (fields[CSV_FIELD_DATE], "date") == 0)
+        {
+          continue;
+        }
+
+      status = check_amount_parse (fields[CSV_FIELD_AMOUNT], &cents, &error_pos);
+
+      if (status != CHECK_AMOUNT_OK)
+        {
+          g_set_error (error, CHECK_BATCH_ERROR, CHECK_BATCH_ERROR_PARSE,
+                       "%s:%u: Invalid amount \"%s\": %s at character %" G_GSIZE_FORMAT,
+                       path, line_nr, fields[CSV_FIELD_AMOUNT],
+                       check_amount_status_to_string (status), error_pos + 1);
+          check_batch_free (batch);
+          return NULL;
+        }
+
+      /* Reject bad routing numbers here rather than print them */
+      micr_status = check_micr_format_line (micr, sizeof (micr), fields[CSV_FIELD_CHECK_NUMBER],
+                                            fields[CSV_FIELD_ROUTING], fields[CSV_FIELD_ACCOUNT]);
+
+      if (micr_status != CHECK_MICR_OK)
+        {
+          g_set_error (error, CHECK_BATCH_ERROR, CHECK_BATCH_ERROR_MICR,
+                       "%s:%u: Invalid MICR line (routing \"%s\", account \"%s\", check \"%s\"): %s",
+                       path, line_nr, fields[CSV_FIELD_ROUTING], fields[CSV_FIELD_ACCOUNT],
+                       fields[CSV_FIELD_CHECK_NUMBER], check_micr_status_to_string (micr_status));
+          check_batch_free (batch);
+          return NULL;
+        }
+
+      if (!check_batch_append (batch, fields[CSV_FIELD_DATE], fields[CSV_FIELD_NAME],
+                               cents, fields[CSV_FIELD_MEMO], fields[CSV_FIELD_CHECK_NUMBER],
+                               fields[CSV_FIELD_ROUTING], fields[CSV_FIELD_ACCOUNT]))
+        {
+          g_set_error (error, CHECK_BATCH_ERROR, CHECK_BATCH_ERROR_FULL,
+                       "%s:%u: Too many distinct strings in one batch", path, line_nr);
+          check_batch_free (batch);
+          return NULL;
+        }
+    }
+
+  g_debug ("%s: Loaded %u checks from %s (%" G_GSIZE_FORMAT " bytes)", __func__,
+           batch->records->len, path, check_batch_get_memory_size (batch));
+
+  return batch;
+}
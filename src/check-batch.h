@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef CHECKWRITER_CHECK_BATCH_H_
+#define CHECKWRITER_CHECK_BATCH_H_
+
+#include "check-ledger.h"
+#include "check-properties.h"
+
+#include <glib.h>
+
+/*
+ * A batch is a list of checks, one per printed page.
+ *
+ * A CheckData takes over a kilobyte whatever it holds, so a batch stores its
+ * checks compactly instead: the amount as a number of cents, and the other
+ * fields as offset/length references into a string arena. Strings are
+ * interned, so a payee, memo or account that repeats through the batch is
+ * stored once. check_batch_get () expands a check back into a CheckData for
+ * rendering, with the amount in words in the language of the layout, and
+ * check_batch_free () releases the whole batch at once.
+ *
+ * A batch must not be appended to while other threads read from it.
+ *
+ * Batches are read from CSV files with the columns:
+ *
+ *   date,name,amount,memo,check_number,routing,account
+ *
+ * The last three are optional and fill in the MICR line (see check-micr.h).
+ * A row whose routing number fails the ABA checksum fails the whole load, so
+ * nothing is printed from a batch with a bad row. Fields may be quoted with
+ * '"' (a doubled quote escapes itself). Empty lines and lines starting with
+ * '#' are ignored, and a header row whose first field is "date" is skipped.
+ *
+ * check_batch_find_duplicates () flags checks that look like a payment made
+ * twice: the same payee, amount and date as an earlier check of the batch, or
+ * as a check already issued according to the ledger (see check-ledger.h).
+ * Payees are compared on their letters and digits only, ignoring ASCII case,
+ * so "ACME Inc." matches "Acme, Inc"; dates are compared as parsed by
+ * check_ledger_parse_date (), and as written when they do not parse.
+ */
+
+#define CHECK_BATCH_ERROR (check_batch_error_quark ())
+
+typedef enum
+{
+  CHECK_BATCH_ERROR_PARSE,
+  CHECK_BATCH_ERROR_FULL,
+  CHECK_BATCH_ERROR_MICR,
+} CheckBatchError;
+
+/* See check_batch_find_duplicates () */
+typedef enum
+{
+  CHECK_BATCH_DUPLICATE = 1 << 0, /* Same as an earlier check of the batch */
+  CHECK_BATCH_ISSUED = 1 << 1,    /* Same as a check of the ledger */
+} CheckBatchFlags;
+
+typedef struct check_batch CheckBatch;
+
+GQuark check_batch_error_quark (void);
+
+CheckBatch *check_batch_new (void);
+
+void check_batch_free (CheckBatch *batch);
+
+guint check_batch_get_n_checks (const CheckBatch *batch);
+
+bool check_batch_append (CheckBatch *batch,
+                         const char *date,
+                         const char *name,
+                         gint64 cents,
+                         const char *memo,
+                         const char *check_number,
+                         const char *routing,
+                         const char *account);
+
+bool check_batch_get (const CheckBatch *batch,
+                      guint index,
+                      NumWordsLocale locale,
+                      CheckData *check_data);
+
+gint64 check_batch_get_cents (const CheckBatch *batch,
+                              guint index);
+
+CheckBatchFlags check_batch_get_flags (const CheckBatch *batch,
+                                       guint index);
+
+guint check_batch_find_duplicates (CheckBatch *batch,
+                                   const CheckLedger *ledger);
+
+gsize check_batch_get_memory_size (const CheckBatch *batch);
+
+CheckBatch *check_batch_load_csv (const char *path,
+                                  GError **error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (CheckBatch, check_batch_free)
+
+#endif /* CHECKWRITER_CHECK_BATCH_H_ */
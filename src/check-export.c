@@ -0,0 +1,813 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include "check-export.h"
+
+#include <cairo-pdf.h>
+#include <glib/gstdio.h>
+#include <math.h>
+#include <string.h>
+
+G_DEFINE_QUARK (check-export-error-quark, check_export_error)
+
+static gboolean
+check_export_check_status (cairo_status_t status,
+                           const char *path,
+                           GError **error)
+{
+  if (status != CAIRO_STATUS_SUCCESS)
+    {
+      g_set_error (error, CHECK_EXPORT_ERROR, CHECK_EXPORT_ERROR_CAIRO,
+                   "%s: %s", path, cairo_status_to_string (status));
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+CheckExportFormat
+check_export_format_from_path (const char *path)
+{
+  const char *ext = NULL;
+
+  if (!path)
+    {
+      return CHECK_EXPORT_FORMAT_UNKNOWN;
+    }
+
+  /* A directory receives one PNG per page */
+  if (g_file_test (path, G_FILE_TEST_IS_DIR))
+    {
+      return CHECK_EXPORT_FORMAT_PNG;
+    }
+
+  ext = strrchr (path, '.');
+
+  if (!ext)
+    {
+      return CHECK_EXPORT_FORMAT_UNKNOWN;
+    }
+
+  if (g_ascii_strcasecmp (ext, ".pdf") == 0)
+    {
+      return CHECK_EXPORT_FORMAT_PDF;
+    }
+  else if (g_ascii_strcasecmp (ext, ".png") == 0)
+    {
+      return CHECK_EXPORT_FORMAT_PNG;
+    }
+
+  return CHECK_EXPORT_FORMAT_UNKNOWN;
+}
+
+/*
+ * Journal every check of `batch` as issued with the layout `check_prop`, and
+ * sync the journal, so that none of them can be rendered without a record.
+ */
+gboolean
+check_export_journal (CheckJournal *journal,
+                      const CheckProperties *check_prop,
+                      const CheckBatch *batch,
+                      GError **error)
+{
+  guint32 layout_id;
+  CheckData check_data;
+
+  g_return_val_if_fail (journal != NULL, FALSE);
+  g_return_val_if_fail (check_prop != NULL, FALSE);
+  g_return_val_if_fail (batch != NULL, FALSE);
+
+  layout_id = check_journal_get_layout_id (check_prop);
+
+  for (guint i = 0; i < check_batch_get_n_checks (batch); ++i)
+    {
+      check_batch_get (batch, i, check_prop->words_locale, &check_data);
+
+      if (!check_journal_append (journal, &check_data, check_batch_get_cents (batch, i), layout_id, error))
+        {
+          g_prefix_error (error, "Check %u could not be journaled: ", i + 1);
+          return FALSE;
+        }
+    }
+
+  return check_journal_sync (journal, error);
+}
+
+/**
+ * Worker pool
+ *
+ * A batch is split into contiguous chunks of pages, one per pool task. PNG
+ * workers render into one image surface they reuse for the whole chunk and
+ * write the files themselves. PDF workers record the text of each page into a
+ * recording surface; the calling thread then replays the recordings into the
+ * PDF in page order, a window of pages at a time so memory stays bounded.
+ *
+ * The static part of a PDF page (borders, pattern, underlines and labels) is
+ * the same on every page, so it is recorded once and painted under each
+ * page's text. cairo writes a recording surface used as a source as a form
+ * XObject, and emits a surface it has seen before only once: the template is
+ * stored a single time and referenced from every page.
+ */
+
+#define EXPORT_PAGES_PER_CHUNK (16)
+
+typedef struct
+{
+  CheckExportFormat format;
+  const char *path;
+  const CheckProperties *check_prop;
+  const CheckBatch *batch;
+  guint n_records;
+  DisplayProperties display;
+  int flags;
+
+  GCancellable *cancellable;
+  CheckExportProgressFunc progress_func;
+  gpointer progress_data;
+
+  /* PDF: static layer shared by all pages, recorded pages of the current window */
+  cairo_surface_t *page_template;
+  cairo_surface_t **pages;
+  guint window_start;
+
+  GMutex lock;
+  GCond done;
+  guint pending;
+  guint n_done;
+  GError *error;
+} CheckExportJob;
+
+typedef struct
+{
+  guint first;
+  guint last; /* Exclusive */
+} CheckExportChunk;
+
+static char *
+check_export_png_page_path (const char *path, guint page, guint n_pages)
+{
+  const char *ext = NULL;
+
+  /* Write into a directory */
+  if (g_file_test (path, G_FILE_TEST_IS_DIR))
+    {
+      return g_strdup_printf ("%s%scheck-%04u.png", path,
+                              g_str_has_suffix (path, G_DIR_SEPARATOR_S) ? "" : G_DIR_SEPARATOR_S,
+                              page + 1);
+    }
+
+  if (n_pages <= 1)
+    {
+      return g_strdup (path);
+    }
+
+  ext = strrchr (path, '.');
+
+  if (!ext)
+    {
+      return g_strdup_printf ("%s-%04u", path, page + 1);
+    }
+
+  return g_strdup_printf ("%.*s-%04u%s", (int) (ext - path), path, page + 1, ext);
+}
+
+static cairo_status_t
+check_export_render_png_chunk (CheckExportJob *job,
+                               const CheckExportChunk *chunk,
+                               char **failed_path)
+{
+  cairo_surface_t *surface = NULL;
+  cairo_status_t status = CAIRO_STATUS_SUCCESS;
+  CheckRenderPlan plan;
+  CheckData check_data;
+
+  check_render_plan_init (&plan);
+
+  /* One surface per worker, reused for every page of the chunk */
+  surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24,
+                                        (int) job->display.width,
+                                        (int) job->display.height);
+
+  for (guint i = chunk->first;
+       i < chunk->last && status == CAIRO_STATUS_SUCCESS && !g_cancellable_is_cancelled (job->cancellable);
+       ++i)
+    {
+      g_autofree char *page_path = check_export_png_page_path (job->path, i, job->n_records);
+      cairo_t *cr = cairo_create (surface);
+
+      check_render_plan_update (&plan, cr, &job->display, job->check_prop, job->flags);
+      check_batch_get (job->batch, i, job->check_prop->words_locale, &check_data);
+      render_check_plan (cr, &plan, &check_data);
+
+      status = cairo_status (cr);
+      cairo_destroy (cr);
+
+      if (status == CAIRO_STATUS_SUCCESS)
+        {
+          status = cairo_surface_write_to_png (surface, page_path);
+        }
+
+      if (status != CAIRO_STATUS_SUCCESS)
+        {
+          *failed_path = g_steal_pointer (&page_path);
+        }
+    }
+
+  cairo_surface_destroy (surface);
+  check_render_plan_clear (&plan);
+
+  return status;
+}
+
+static cairo_status_t
+check_export_record_pdf_chunk (CheckExportJob *job,
+                               const CheckExportChunk *chunk)
+{
+  cairo_rectangle_t extents = { 0, 0, job->display.width, job->display.height };
+  cairo_status_t status = CAIRO_STATUS_SUCCESS;
+  CheckRenderPlan plan;
+  CheckData check_data;
+
+  check_render_plan_init (&plan);
+
+  for (guint i = chunk->first;
+       i < chunk->last && status == CAIRO_STATUS_SUCCESS && !g_cancellable_is_cancelled (job->cancellable);
+       ++i)
+    {
+      cairo_surface_t *page = cairo_recording_surface_create (CAIRO_CONTENT_COLOR_ALPHA, &extents);
+      cairo_t *cr = cairo_create (page);
+
+      check_render_plan_update (&plan, cr, &job->display, job->check_prop, job->flags);
+      check_batch_get (job->batch, i, job->check_prop->words_locale, &check_data);
+
+      /* Only the text, the rest is in the page template */
+      for (int field = 0; field < CHECK_N_FIELDS; ++field)
+        {
+          render_check_plan_field (cr, &plan, field, &check_data);
+        }
+
+      status = cairo_status (cr);
+      cairo_destroy (cr);
+
+      job->pages[i - job->window_start] = page;
+    }
+
+  check_render_plan_clear (&plan);
+
+  return status;
+}
+
+/* Record the static layer of a page, shared by every page of the document */
+static cairo_surface_t *
+check_export_record_pdf_template (const CheckExportJob *job)
+{
+  static const char template_id[] = "checkwriter-page-template";
+  cairo_rectangle_t extents = { 0, 0, job->display.width, job->display.height };
+  cairo_surface_t *surface = cairo_recording_surface_create (CAIRO_CONTENT_COLOR_ALPHA, &extents);
+  cairo_t *cr = cairo_create (surface);
+  CheckRenderPlan plan;
+
+  check_render_plan_init (&plan);
+  check_render_plan_update (&plan, cr, &job->display, job->check_prop, job->flags);
+  render_check_plan_background (cr, &plan);
+  check_render_plan_clear (&plan);
+
+  cairo_destroy (cr);
+
+  /* Make sure every page refers to the same XObject */
+  cairo_surface_set_mime_data (surface, CAIRO_MIME_TYPE_UNIQUE_ID,
+                               (const unsigned char *) template_id, sizeof (template_id) - 1,
+                               NULL, NULL);
+
+  return surface;
+}
+
+static void
+check_export_worker (gpointer data, gpointer user_data)
+{
+  CheckExportChunk *chunk = data;
+  CheckExportJob *job = user_data;
+  g_autofree char *failed_path = NULL;
+  cairo_status_t status;
+  guint n_done;
+
+  if (job->format == CHECK_EXPORT_FORMAT_PNG)
+    {
+      status = check_export_render_png_chunk (job, chunk, &failed_path);
+    }
+  else
+    {
+      status = check_export_record_pdf_chunk (job, chunk);
+    }
+
+  g_mutex_lock (&job->lock);
+
+  if (status != CAIRO_STATUS_SUCCESS && !job->error)
+    {
+      check_export_check_status (status, failed_path ? failed_path : job->path, &job->error);
+    }
+
+  if (!job->error)
+    {
+      g_cancellable_set_error_if_cancelled (job->cancellable, &job->error);
+    }
+
+  job->n_done += chunk->last - chunk->first;
+  n_done = job->n_done;
+
+  if (--job->pending == 0)
+    {
+      g_cond_signal (&job->done);
+    }
+
+  g_mutex_unlock (&job->lock);
+
+  if (job->progress_func)
+    {
+      job->progress_func (n_done, job->n_records, job->progress_data);
+    }
+
+  g_free (chunk);
+}
+
+/* Render pages [first, last) across the pool and wait for them */
+static gboolean
+check_export_run_pages (CheckExportJob *job,
+                        GThreadPool *pool,
+                        guint first,
+                        guint last)
+{
+  gboolean ok;
+
+  g_mutex_lock (&job->lock);
+
+  for (guint i = first; i < last; i += EXPORT_PAGES_PER_CHUNK)
+    {
+      CheckExportChunk *chunk = g_new (CheckExportChunk, 1);
+
+      chunk->first = i;
+      chunk->last = MIN (i + EXPORT_PAGES_PER_CHUNK, last);
+
+      ++job->pending;
+
+      if (pool)
+        {
+          g_thread_pool_push (pool, chunk, NULL);
+        }
+      else
+        {
+          g_mutex_unlock (&job->lock);
+          check_export_worker (chunk, job);
+          g_mutex_lock (&job->lock);
+        }
+    }
+
+  while (job->pending > 0)
+    {
+      g_cond_wait (&job->done, &job->lock);
+    }
+
+  ok = (job->error == NULL);
+
+  g_mutex_unlock (&job->lock);
+
+  return ok;
+}
+
+static GThreadPool *
+check_export_pool_new (CheckExportJob *job, guint n_jobs)
+{
+  if (n_jobs == 0)
+    {
+      n_jobs = g_get_num_processors ();
+    }
+
+  /* Render on the calling thread */
+  if (n_jobs <= 1 || job->n_records <= EXPORT_PAGES_PER_CHUNK)
+    {
+      return NULL;
+    }
+
+  return g_thread_pool_new (check_export_worker, job, n_jobs, FALSE, NULL);
+}
+
+static void
+check_export_job_init (CheckExportJob *job,
+                       CheckExportFormat format,
+                       const char *path,
+                       const CheckProperties *check_prop,
+                       const CheckBatch *batch,
+                       int flags,
+                       GCancellable *cancellable,
+                       CheckExportProgressFunc progress_func,
+                       gpointer progress_data)
+{
+  memset (job, 0, sizeof (CheckExportJob));
+
+  job->format = format;
+  job->path = path;
+  job->check_prop = check_prop;
+  job->batch = batch;
+  job->n_records = check_batch_get_n_checks (batch);
+  job->flags = flags;
+  job->cancellable = cancellable;
+  job->progress_func = progress_func;
+  job->progress_data = progress_data;
+
+  g_mutex_init (&job->lock);
+  g_cond_init (&job->done);
+}
+
+static void
+check_export_job_clear (CheckExportJob *job)
+{
+  g_mutex_clear (&job->lock);
+  g_cond_clear (&job->done);
+  g_clear_error (&job->error);
+}
+
+static gboolean
+check_export_pdf_full (const char *path,
+                       const CheckProperties *check_prop,
+                       const CheckBatch *batch,
+                       int flags,
+                       guint n_jobs,
+                       GCancellable *cancellable,
+                       CheckExportProgressFunc progress_func,
+                       gpointer progress_data,
+                       GError **error)
+{
+  cairo_surface_t *surface = NULL;
+  cairo_t *cr = NULL;
+  GThreadPool *pool = NULL;
+  CheckExportJob job;
+  cairo_status_t status;
+  guint window_size;
+  gboolean ok = TRUE;
+
+  g_return_val_if_fail (path != NULL, FALSE);
+  g_return_val_if_fail (check_prop != NULL, FALSE);
+  g_return_val_if_fail (batch != NULL, FALSE);
+
+  check_export_job_init (&job, CHECK_EXPORT_FORMAT_PDF, path, check_prop, batch, flags,
+                         cancellable, progress_func, progress_data);
+
+  /* PDF user space is in points, so render at 72 DPI */
+  job.display.x_dpi = POINTS_PER_INCH;
+  job.display.y_dpi = POINTS_PER_INCH;
+  job.display.width = (check_prop->width * POINTS_PER_INCH) / INCH_PER_MM;
+  job.display.height = (check_prop->height * POINTS_PER_INCH) / INCH_PER_MM;
+
+  surface = cairo_pdf_surface_create (path, job.display.width, job.display.height);
+
+  /* Nothing was written yet, and `path` may be a file the export could not open */
+  if (!check_export_check_status (cairo_surface_status (surface), path, error))
+    {
+      cairo_surface_destroy (surface);
+      check_export_job_clear (&job);
+      return FALSE;
+    }
+
+  job.page_template = check_export_record_pdf_template (&job);
+
+  pool = check_export_pool_new (&job, n_jobs);
+  window_size = EXPORT_PAGES_PER_CHUNK * (pool ? g_thread_pool_get_max_threads (pool) : 1);
+  job.pages = g_new0 (cairo_surface_t *, window_size);
+
+  cr = cairo_create (surface);
+
+  for (guint start = 0; ok && start < job.n_records; start += window_size)
+    {
+      guint end = MIN (start + window_size, job.n_records);
+
+      job.window_start = start;
+      ok = check_export_run_pages (&job, pool, start, end);
+
+      /* Replay the recorded pages in order */
+      for (guint i = 0; i < (end - start); ++i)
+        {
+          if (ok)
+            {
+              cairo_set_source_surface (cr, job.page_template, 0, 0);
+              cairo_paint (cr);
+              cairo_set_source_surface (cr, job.pages[i], 0, 0);
+              cairo_paint (cr);
+              cairo_show_page (cr);
+            }
+
+          g_clear_pointer (&job.pages[i], cairo_surface_destroy);
+        }
+    }
+
+  if (pool)
+    {
+      g_thread_pool_free (pool, FALSE, TRUE);
+    }
+
+  g_free (job.pages);
+
+  status = cairo_status (cr);
+  cairo_destroy (cr);
+  cairo_surface_destroy (job.page_template);
+
+  cairo_surface_finish (surface);
+
+  if (status == CAIRO_STATUS_SUCCESS)
+    {
+      status = cairo_surface_status (surface);
+    }
+
+  cairo_surface_destroy (surface);
+
+  if (!ok)
+    {
+      g_propagate_error (error, g_steal_pointer (&job.error));
+    }
+  else
+    {
+      ok = check_export_check_status (status, path, error);
+    }
+
+  /* Do not leave a truncated document behind, whatever stopped the export */
+  if (!ok)
+    {
+      g_unlink (path);
+    }
+
+  check_export_job_clear (&job);
+
+  g_debug ("%s: Wrote %u pages to %s", __func__, job.n_records, path);
+
+  return ok;
+}
+
+gboolean
+check_export_pdf (const char *path,
+                  const CheckProperties *check_prop,
+                  const CheckBatch *batch,
+                  int flags,
+                  guint n_jobs,
+                  GError **error)
+{
+  return check_export_pdf_full (path, check_prop, batch, flags, n_jobs, NULL, NULL, NULL, error);
+}
+
+static gboolean
+check_export_png_full (const char *path,
+                       const CheckProperties *check_prop,
+                       const CheckBatch *batch,
+                       double dpi,
+                       int flags,
+                       guint n_jobs,
+                       GCancellable *cancellable,
+                       CheckExportProgressFunc progress_func,
+                       gpointer progress_data,
+                       GError **error)
+{
+  GThreadPool *pool = NULL;
+  CheckExportJob job;
+  gboolean ok;
+
+  g_return_val_if_fail (path != NULL, FALSE);
+  g_return_val_if_fail (check_prop != NULL, FALSE);
+  g_return_val_if_fail (batch != NULL, FALSE);
+  g_return_val_if_fail (dpi > 0, FALSE);
+
+  check_export_job_init (&job, CHECK_EXPORT_FORMAT_PNG, path, check_prop, batch, flags,
+                         cancellable, progress_func, progress_data);
+
+  job.display.x_dpi = dpi;
+  job.display.y_dpi = dpi;
+  job.display.width = ceil ((check_prop->width * dpi) / INCH_PER_MM);
+  job.display.height = ceil ((check_prop->height * dpi) / INCH_PER_MM);
+
+  pool = check_export_pool_new (&job, n_jobs);
+  ok = check_export_run_pages (&job, pool, 0, job.n_records);
+
+  if (pool)
+    {
+      g_thread_pool_free (pool, FALSE, TRUE);
+    }
+
+  if (!ok)
+    {
+      g_propagate_error (error, g_steal_pointer (&job.error));
+    }
+
+  check_export_job_clear (&job);
+
+  g_debug ("%s: Wrote %u images to %s", __func__, job.n_records, path);
+
+  return ok;
+}
+
+gboolean
+check_export_png (const char *path,
+                  const CheckProperties *check_prop,
+                  const CheckBatch *batch,
+                  double dpi,
+                  int flags,
+                  guint n_jobs,
+                  GError **error)
+{
+  return check_export_png_full (path, check_prop, batch, dpi, flags, n_jobs, NULL, NULL, NULL, error);
+}
+
+/**
+ * Asynchronous export
+ *
+ * The export runs in a GTask thread, which spreads the pages over the worker
+ * pool as above. Progress is reported in the thread-default main context of
+ * the caller, at most once per main loop iteration however fast the workers
+ * finish their chunks.
+ */
+
+typedef struct
+{
+  char *path;
+  const CheckLayout *layout;
+  const CheckBatch *batch;
+  double dpi;
+  int flags;
+  guint n_jobs;
+
+  CheckExportProgressFunc progress_func;
+  gpointer progress_data;
+  GMainContext *context;
+
+  /* Set by the workers, read in `context` */
+  gint n_done;
+  guint n_total;
+  gint report_pending;
+} CheckExportTaskData;
+
+static void
+check_export_task_data_free (gpointer data)
+{
+  CheckExportTaskData *task_data = data;
+
+  g_free (task_data->path);
+  check_layout_unref (task_data->layout);
+  g_main_context_unref (task_data->context);
+  g_free (task_data);
+}
+
+static gboolean
+check_export_task_report_progress (gpointer user_data)
+{
+  GTask *task = user_data;
+  CheckExportTaskData *task_data = g_task_get_task_data (task);
+
+  g_atomic_int_set (&task_data->report_pending, 0);
+
+  /* Nothing after the completion callback */
+  if (!g_task_get_completed (task))
+    {
+      task_data->progress_func ((guint) g_atomic_int_get (&task_data->n_done),
+                                task_data->n_total,
+                                task_data->progress_data);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Called from the workers */
+static void
+check_export_task_on_progress (guint n_done, guint n_total, gpointer user_data)
+{
+  GTask *task = user_data;
+  CheckExportTaskData *task_data = g_task_get_task_data (task);
+
+  (void) n_total;
+
+  g_atomic_int_set (&task_data->n_done, (gint) n_done);
+
+  if (g_atomic_int_compare_and_exchange (&task_data->report_pending, 0, 1))
+    {
+      g_main_context_invoke_full (task_data->context, G_PRIORITY_DEFAULT,
+                                  check_export_task_report_progress,
+                                  g_object_ref (task), g_object_unref);
+    }
+}
+
+static void
+check_export_task_thread (GTask *task,
+                          gpointer source_object,
+                          gpointer data,
+                          GCancellable *cancellable)
+{
+  CheckExportTaskData *task_data = data;
+  const CheckProperties *check_prop = &task_data->layout->properties;
+  CheckExportProgressFunc progress_func = NULL;
+  GError *error = NULL;
+  gboolean ok;
+
+  (void) source_object;
+
+  if (task_data->progress_func)
+    {
+      progress_func = check_export_task_on_progress;
+    }
+
+  switch (check_export_format_from_path (task_data->path))
+    {
+    case CHECK_EXPORT_FORMAT_PDF:
+      ok = check_export_pdf_full (task_data->path, check_prop, task_data->batch,
+                                  task_data->flags, task_data->n_jobs,
+                                  cancellable, progress_func, task, &error);
+      break;
+
+    case CHECK_EXPORT_FORMAT_PNG:
+      ok = check_export_png_full (task_data->path, check_prop, task_data->batch,
+                                  task_data->dpi, task_data->flags, task_data->n_jobs,
+                                  cancellable, progress_func, task, &error);
+      break;
+
+    case CHECK_EXPORT_FORMAT_UNKNOWN:
+    default:
+      g_task_return_new_error (task, CHECK_EXPORT_ERROR, CHECK_EXPORT_ERROR_FORMAT,
+                               "%s: Unknown output format (expected .pdf or .png)",
+                               task_data->path);
+      return;
+    }
+
+  if (ok)
+    {
+      g_task_return_boolean (task, TRUE);
+    }
+  else
+    {
+      g_task_return_error (task, error);
+    }
+}
+
+/*
+ * Export `batch` to `path` without blocking the calling thread. The format
+ * follows the file name as for check_export_format_from_path (); `dpi` only
+ * applies to PNG output. The batch must not change until `callback` runs.
+ * `progress_func`, if not NULL, is called with the number of pages done.
+ */
+void
+check_export_async (const char *path,
+                    const CheckLayout *layout,
+                    const CheckBatch *batch,
+                    double dpi,
+                    int flags,
+                    guint n_jobs,
+                    GCancellable *cancellable,
+                    CheckExportProgressFunc progress_func,
+                    gpointer progress_data,
+                    GAsyncReadyCallback callback,
+                    gpointer user_data)
+{
+  g_autoptr (GTask) task = NULL;
+  CheckExportTaskData *task_data = NULL;
+
+  g_return_if_fail (path != NULL);
+  g_return_if_fail (layout != NULL);
+  g_return_if_fail (batch != NULL);
+  g_return_if_fail (dpi > 0);
+
+  task_data = g_new0 (CheckExportTaskData, 1);
+  task_data->path = g_strdup (path);
+  task_data->layout = check_layout_ref (layout);
+  task_data->batch = batch;
+  task_data->dpi = dpi;
+  task_data->flags = flags;
+  task_data->n_jobs = n_jobs;
+  task_data->progress_func = progress_func;
+  task_data->progress_data = progress_data;
+  task_data->context = g_main_context_ref_thread_default ();
+  task_data->n_total = check_batch_get_n_checks (batch);
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, check_export_async);
+  g_task_set_task_data (task, task_data, check_export_task_data_free);
+  g_task_run_in_thread (task, check_export_task_thread);
+}
+
+gboolean
+check_export_finish (GAsyncResult *result, GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
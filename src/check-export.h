@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef CHECKWRITER_CHECK_EXPORT_H_
+#define CHECKWRITER_CHECK_EXPORT_H_
+
+#include "check-batch.h"
+#include "check-journal.h"
+#include "check-properties.h"
+
+#include <gio/gio.h>
+#include <glib.h>
+
+/*
+ * Render checks straight onto cairo PDF or image surfaces, without any
+ * widgets. A PDF gets one page per check of the batch, sized to the check.
+ * PNG output writes one image per record; with more than one record, the
+ * page number is appended to the file name ("checks.png" ->
+ * "checks-0001.png"), and an existing directory receives "check-0001.png",
+ * "check-0002.png", ...
+ *
+ * Pages are rendered by a pool of `n_jobs` worker threads, each with its own
+ * cairo surfaces; 0 uses one worker per processor. check_export_async () does
+ * the same from a GTask thread, reporting progress and honouring
+ * cancellation, so that a user interface stays responsive during long jobs.
+ *
+ * Exported checks are as good as printed ones, so callers record them with
+ * check_export_journal () before any page is rendered, as the print path
+ * does.
+ */
+
+#define EXPORT_DEFAULT_DPI (300.0)
+
+#define CHECK_EXPORT_ERROR (check_export_error_quark ())
+
+typedef enum
+{
+  CHECK_EXPORT_ERROR_FORMAT,
+  CHECK_EXPORT_ERROR_CAIRO,
+} CheckExportError;
+
+typedef enum
+{
+  CHECK_EXPORT_FORMAT_UNKNOWN,
+  CHECK_EXPORT_FORMAT_PDF,
+  CHECK_EXPORT_FORMAT_PNG,
+} CheckExportFormat;
+
+typedef void (*CheckExportProgressFunc) (guint n_done,
+                                         guint n_total,
+                                         gpointer user_data);
+
+GQuark check_export_error_quark (void);
+
+CheckExportFormat check_export_format_from_path (const char *path);
+
+gboolean check_export_journal (CheckJournal *journal,
+                               const CheckProperties *check_prop,
+                               const CheckBatch *batch,
+                               GError **error);
+
+gboolean check_export_pdf (const char *path,
+                           const CheckProperties *check_prop,
+                           const CheckBatch *batch,
+                           int flags,
+                           guint n_jobs,
+                           GError **error);
+
+gboolean check_export_png (const char *path,
+                           const CheckProperties *check_prop,
+                           const CheckBatch *batch,
+                           double dpi,
+                           int flags,
+                           guint n_jobs,
+                           GError **error);
+
+void check_export_async (const char *path,
+                         const CheckLayout *layout,
+                         const CheckBatch *batch,
+                         double dpi,
+                         int flags,
+                         guint n_jobs,
+                         GCancellable *cancellable,
+                         CheckExportProgressFunc progress_func,
+                         gpointer progress_data,
+                         GAsyncReadyCallback callback,
+                         gpointer user_data);
+
+gboolean check_export_finish (GAsyncResult *result,
+                              GError **error);
+
+#endif /* CHECKWRITER_CHECK_EXPORT_H_ */
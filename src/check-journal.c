@@ -0,0 +1,784 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include "check-journal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#define JOURNAL_FILE_MAGIC ("CWJRNL1")
+#define JOURNAL_FILE_VERSION (1)
+
+typedef struct journal_file_header
+{
+  char magic[8]; /* JOURNAL_FILE_MAGIC, NUL terminated */
+  guint32 version;
+  guint32 reserved;
+} JournalFileHeader;
+
+/* Precedes every payload; records are packed, so read it with memcpy () */
+typedef struct journal_record_header
+{
+  guint32 length;
+  guint32 crc;
+} JournalRecordHeader;
+
+/* Fixed part of a payload, followed by the strings */
+typedef struct journal_record
+{
+  guint64 sequence;
+  gint64 issued_at;
+  gint64 cents;
+  guint32 layout_id;
+  guint8 lengths[CHECK_JOURNAL_N_STRINGS];
+  guint8 reserved[6];
+} JournalRecord;
+
+/* Strings are cut to what a CheckData field holds */
+#define JOURNAL_STRING_MAX (STRING_LEN - 1)
+#define JOURNAL_PAYLOAD_MAX (sizeof (JournalRecord) + (CHECK_JOURNAL_N_STRINGS * JOURNAL_STRING_MAX))
+#define JOURNAL_RECORD_MAX (sizeof (JournalRecordHeader) + JOURNAL_PAYLOAD_MAX)
+
+G_STATIC_ASSERT (sizeof (JournalFileHeader) == 16);
+G_STATIC_ASSERT (sizeof (JournalRecord) == 40);
+G_STATIC_ASSERT (JOURNAL_STRING_MAX <= G_MAXUINT8);
+
+struct check_journal
+{
+  char *path;
+
+  /* Locked while open; -1 once a write or sync failed, and then the journal refuses to append */
+  int fd;
+  guint64 length; /* Bytes of whole records in the file */
+
+  guint64 n_entries;
+  guint group_size;
+  guint n_unsynced;
+};
+
+struct check_journal_file
+{
+  char *path;
+
+  /* NULL while the file does not exist or is empty */
+  GMappedFile *file;
+  const char *data;
+  gsize length;
+
+  gsize start; /* First record, `length` when there is no complete header */
+};
+
+G_DEFINE_QUARK (check-journal-error-quark, check_journal_error)
+
+char *
+check_journal_get_default_path (void)
+{
+  return g_build_filename (g_get_user_data_dir (), "checkwriter", "issued.journal", NULL);
+}
+
+static guint32 crc32_table[256];
+
+static void
+check_journal_ensure_crc32_table (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+    {
+      for (guint32 i = 0; i < 256; ++i)
+        {
+          guint32 crc = i;
+
+          for (int bit = 0; bit < 8; ++bit)
+            {
+              crc = (crc & 1) ? ((crc >> 1) ^ 0xEDB88320u) : (crc >> 1);
+            }
+
+          crc32_table[i] = crc;
+        }
+
+      g_once_init_leave (&initialized, 1);
+    }
+}
+
+/*
+ * CRC-32 of `data`, continuing from `crc`, which is 0 for the first block.
+ * This is the checksum of zlib's crc32 () and `cksum -a crc32b`.
+ */
+guint32
+check_journal_crc32 (guint32 crc, const void *data, gsize len)
+{
+  const guchar *bytes = data;
+
+  check_journal_ensure_crc32_table ();
+
+  crc = ~crc;
+
+  for (gsize i = 0; i < len; ++i)
+    {
+      crc = crc32_table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+  return ~crc;
+}
+
+/* Field by field, so padding and bytes past the font name do not count */
+guint32
+check_journal_get_layout_id (const CheckProperties *properties)
+{
+  const FieldProperties *fields[CHECK_N_FIELDS];
+  double size[4];
+  gint32 font_height;
+  guint32 crc = 0;
+
+  g_return_val_if_fail (properties != NULL, 0);
+
+  fields[CHECK_FIELD_DATE] = &properties->date;
+  fields[CHECK_FIELD_NAME] = &properties->name;
+  fields[CHECK_FIELD_AMOUNT] = &properties->amount;
+  fields[CHECK_FIELD_AMOUNT_IN_WORDS] = &properties->amount_in_words;
+  fields[CHECK_FIELD_MEMO] = &properties->memo;
+  fields[CHECK_FIELD_MICR] = &properties->micr;
+
+  size[0] = properties->width;
+  size[1] = properties->height;
+  size[2] = properties->x_pad;
+  size[3] = properties->y_pad;
+  font_height = properties->check_font_height;
+
+  for (gsize i = 0; i < G_N_ELEMENTS (fields); ++i)
+    {
+      crc = check_journal_crc32 (crc, fields[i], sizeof (FieldProperties));
+    }
+
+  crc = check_journal_crc32 (crc, size, sizeof (size));
+  crc = check_journal_crc32 (crc, &font_height, sizeof (font_height));
+
+  return check_journal_crc32 (crc, properties->check_font, strnlen (properties->check_font, STRING_LEN));
+}
+
+static void
+check_journal_init_header (JournalFileHeader *header)
+{
+  memset (header, 0, sizeof (JournalFileHeader));
+  memcpy (header->magic, JOURNAL_FILE_MAGIC, sizeof (header->magic));
+  header->version = JOURNAL_FILE_VERSION;
+}
+
+static void
+check_journal_set_io_error (GError **error, const char *path, int saved_errno)
+{
+  g_set_error (error, CHECK_JOURNAL_ERROR, CHECK_JOURNAL_ERROR_IO,
+               "%s: %s", path, g_strerror (saved_errno));
+}
+
+/**
+ * Reading
+ */
+
+/*
+ * Map the journal at `path`, or the default journal when NULL. A journal
+ * that does not exist yet, or whose header was cut short while creating it,
+ * has no records.
+ */
+CheckJournalFile *
+check_journal_file_open (const char *path, GError **error)
+{
+  g_autoptr (CheckJournalFile) file = NULL;
+  GError *local_error = NULL;
+  JournalFileHeader header;
+
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  file = g_new0 (CheckJournalFile, 1);
+  file->path = path ? g_strdup (path) : check_journal_get_default_path ();
+  file->file = g_mapped_file_new (file->path, FALSE, &local_error);
+
+  if (!file->file)
+    {
+      /* Nothing issued yet */
+      if (g_error_matches (local_error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        {
+          g_error_free (local_error);
+          return g_steal_pointer (&file);
+        }
+
+      g_propagate_error (error, local_error);
+      return NULL;
+    }
+
+  file->data = g_mapped_file_get_contents (file->file);
+  file->length = g_mapped_file_get_length (file->file);
+
+  if (file->length < sizeof (JournalFileHeader))
+    {
+      if (file->length > 0 && memcmp (file->data, JOURNAL_FILE_MAGIC, MIN (file->length, sizeof (header.magic))) != 0)
+        {
+          g_set_error (error, CHECK_JOURNAL_ERROR, CHECK_JOURNAL_ERROR_FORMAT,
+                       "%s: Not a check journal", file->path);
+          return NULL;
+        }
+
+      file->start = file->length;
+      return g_steal_pointer (&file);
+    }
+
+  memcpy (&header, file->data, sizeof (JournalFileHeader));
+
+  if (memcmp (header.magic, JOURNAL_FILE_MAGIC, sizeof (header.magic)) != 0
+      || header.version != JOURNAL_FILE_VERSION)
+    {
+      g_set_error (error, CHECK_JOURNAL_ERROR, CHECK_JOURNAL_ERROR_FORMAT,
+                   "%s: Not a check journal, or an unsupported version", file->path);
+      return NULL;
+    }
+
+  file->start = sizeof (JournalFileHeader);
+
+  return g_steal_pointer (&file);
+}
+
+void
+check_journal_file_free (CheckJournalFile *file)
+{
+  if (!file)
+    {
+      return;
+    }
+
+  g_clear_pointer (&file->file, g_mapped_file_unref);
+  g_free (file->path);
+  g_free (file);
+}
+
+/*
+ * Read the record at byte `*offset` of the file, 0 for the first one, and
+ * move `*offset` to the next record. Returns FALSE at the end of the file
+ * and on a record that is incomplete or fails its CRC, leaving `*offset`.
+ */
+gboolean
+check_journal_file_read (const CheckJournalFile *file,
+                         guint64 *offset,
+                         CheckJournalRecord *record)
+{
+  JournalRecordHeader header;
+  JournalRecord fixed;
+  const char *payload = NULL;
+  const char *strings = NULL;
+  guint64 pos, total;
+
+  g_return_val_if_fail (file != NULL, FALSE);
+  g_return_val_if_fail (offset != NULL, FALSE);
+  g_return_val_if_fail (record != NULL, FALSE);
+
+  pos = (*offset == 0) ? file->start : *offset;
+
+  if (pos < file->start || pos >= file->length || (file->length - pos) < sizeof (JournalRecordHeader))
+    {
+      return FALSE;
+    }
+
+  memcpy (&header, file->data + pos, sizeof (JournalRecordHeader));
+  payload = file->data + pos + sizeof (JournalRecordHeader);
+
+  if (header.length < sizeof (JournalRecord)
+      || header.length > JOURNAL_PAYLOAD_MAX
+      || header.length > (file->length - pos - sizeof (JournalRecordHeader))
+      || check_journal_crc32 (0, payload, header.length) != header.crc)
+    {
+      return FALSE;
+    }
+
+  memcpy (&fixed, payload, sizeof (JournalRecord));
+
+  strings = payload + sizeof (JournalRecord);
+  total = sizeof (JournalRecord);
+
+  for (int i = 0; i < CHECK_JOURNAL_N_STRINGS; ++i)
+    {
+      record->strings[i] = strings;
+      record->lengths[i] = fixed.lengths[i];
+      strings += fixed.lengths[i];
+      total += fixed.lengths[i];
+    }
+
+  if (total != header.length)
+    {
+      return FALSE;
+    }
+
+  record->offset = pos;
+  record->sequence = fixed.sequence;
+  record->issued_at = fixed.issued_at;
+  record->cents = fixed.cents;
+  record->layout_id = fixed.layout_id;
+
+  *offset = pos + sizeof (JournalRecordHeader) + header.length;
+
+  return TRUE;
+}
+
+/*
+ * Walk the records in order, calling `func` (if not NULL) for each one.
+ * Stops at the first record that is incomplete, corrupt or out of sequence,
+ * or when `func` returns FALSE. Returns the offset just past the last good
+ * record, and their number in `n_entries`.
+ */
+static guint64
+check_journal_file_scan (const CheckJournalFile *file,
+                         CheckJournalFunc func,
+                         gpointer user_data,
+                         guint64 *n_entries)
+{
+  CheckJournalRecord record;
+  guint64 offset = file->start;
+  guint64 next = offset;
+  guint64 n = 0;
+
+  while (check_journal_file_read (file, &next, &record) && record.sequence == n)
+    {
+      offset = next;
+      ++n;
+
+      if (func && !func (&record, user_data))
+        {
+          break;
+        }
+    }
+
+  *n_entries = n;
+
+  return offset;
+}
+
+/*
+ * Call `func` for each entry of the journal at `path` (the default journal
+ * when NULL), oldest first. The strings of a record are only valid during
+ * the call.
+ */
+gboolean
+check_journal_foreach (const char *path,
+                       CheckJournalFunc func,
+                       gpointer user_data,
+                       GError **error)
+{
+  g_autoptr (CheckJournalFile) file = NULL;
+  guint64 n_entries;
+
+  g_return_val_if_fail (func != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  file = check_journal_file_open (path, error);
+
+  if (!file)
+    {
+      return FALSE;
+    }
+
+  check_journal_file_scan (file, func, user_data, &n_entries);
+
+  return TRUE;
+}
+
+/* Copy a string of `record` to `dst`, NUL terminated and cut to fit */
+void
+check_journal_record_get_string (const CheckJournalRecord *record,
+                                 CheckJournalString string,
+                                 char *dst,
+                                 gsize len)
+{
+  gsize n;
+
+  g_return_if_fail (record != NULL);
+  g_return_if_fail (string < CHECK_JOURNAL_N_STRINGS);
+  g_return_if_fail (dst != NULL && len > 0);
+
+  n = MIN (record->lengths[string], len - 1);
+  memcpy (dst, record->strings[string], n);
+  dst[n] = '\0';
+}
+
+/**
+ * Appending
+ */
+
+/* Encode `record` with its record header into `buffer`; returns the size */
+static gsize
+check_journal_encode (char *buffer, const CheckJournalRecord *record)
+{
+  JournalRecordHeader header;
+  JournalRecord fixed;
+  char *cur = buffer + sizeof (JournalRecordHeader);
+
+  memset (&fixed, 0, sizeof (JournalRecord));
+  fixed.sequence = record->sequence;
+  fixed.issued_at = record->issued_at;
+  fixed.cents = record->cents;
+  fixed.layout_id = record->layout_id;
+  memcpy (fixed.lengths, record->lengths, sizeof (fixed.lengths));
+
+  memcpy (cur, &fixed, sizeof (JournalRecord));
+  cur += sizeof (JournalRecord);
+
+  for (int i = 0; i < CHECK_JOURNAL_N_STRINGS; ++i)
+    {
+      memcpy (cur, record->strings[i], record->lengths[i]);
+      cur += record->lengths[i];
+    }
+
+  header.length = (guint32) (cur - buffer - sizeof (JournalRecordHeader));
+  header.crc = check_journal_crc32 (0, buffer + sizeof (JournalRecordHeader), header.length);
+  memcpy (buffer, &header, sizeof (JournalRecordHeader));
+
+  return (gsize) (cur - buffer);
+}
+
+static gboolean
+check_journal_write_all (CheckJournal *journal,
+                         const char *data,
+                         gsize len,
+                         GError **error)
+{
+  while (len > 0)
+    {
+      gssize written = write (journal->fd, data, len);
+
+      if (written < 0)
+        {
+          int saved_errno = errno;
+
+          if (saved_errno == EINTR)
+            {
+              continue;
+            }
+
+          check_journal_set_io_error (error, journal->path, saved_errno);
+          return FALSE;
+        }
+
+      data += written;
+      len -= written;
+    }
+
+  return TRUE;
+}
+
+/*
+ * After a failed write or sync the state of the file is unknown, and a later
+ * sync may report success without having written anything (Linux marks the
+ * pages clean). Stop appending rather than journal checks that may be lost.
+ */
+static void
+check_journal_fail (CheckJournal *journal)
+{
+  if (journal->fd >= 0)
+    {
+      /* Leave whole records only, so the next open needs no repair */
+      if (ftruncate (journal->fd, (off_t) journal->length) < 0)
+        {
+          g_debug ("%s: Could not truncate %s: %s", __func__, journal->path, g_strerror (errno));
+        }
+
+      close (journal->fd);
+      journal->fd = -1;
+    }
+}
+
+/*
+ * A new file is only there after a system crash once its directory entry is
+ * on disk, however often the file itself was synced.
+ */
+static gboolean
+check_journal_sync_dir (const char *dir, GError **error)
+{
+  int fd = g_open (dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC, 0);
+
+  if (fd < 0 || g_fsync (fd) < 0)
+    {
+      check_journal_set_io_error (error, dir, errno);
+
+      if (fd >= 0)
+        {
+          close (fd);
+        }
+
+      return FALSE;
+    }
+
+  close (fd);
+
+  return TRUE;
+}
+
+/*
+ * Open the journal at `path`, or the default journal when NULL, for
+ * appending. The file stays locked until check_journal_free (), so that no
+ * other handle, in this process or another, appends with the same sequence
+ * numbers; opening it meanwhile fails with CHECK_JOURNAL_ERROR_BUSY.
+ */
+CheckJournal *
+check_journal_open (const char *path, guint group_size, GError **error)
+{
+  g_autoptr (CheckJournal) journal = NULL;
+  g_autoptr (CheckJournalFile) file = NULL;
+  g_autofree char *dir = NULL;
+  gboolean created = FALSE;
+
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  journal = g_new0 (CheckJournal, 1);
+  journal->path = path ? g_strdup (path) : check_journal_get_default_path ();
+  journal->fd = -1;
+  journal->group_size = MAX (group_size, 1);
+
+  dir = g_path_get_dirname (journal->path);
+
+  if (g_mkdir_with_parents (dir, 0700) < 0)
+    {
+      check_journal_set_io_error (error, dir, errno);
+      return NULL;
+    }
+
+  journal->fd = g_open (journal->path, O_RDWR | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0600);
+  created = (journal->fd >= 0);
+
+  if (journal->fd < 0 && errno == EEXIST)
+    {
+      journal->fd = g_open (journal->path, O_RDWR | O_APPEND | O_CLOEXEC, 0600);
+    }
+
+  if (journal->fd < 0)
+    {
+      check_journal_set_io_error (error, journal->path, errno);
+      return NULL;
+    }
+
+  /* Per open file, so two handles in one process exclude each other too */
+  if (flock (journal->fd, LOCK_EX | LOCK_NB) < 0)
+    {
+      if (errno == EWOULDBLOCK)
+        {
+          g_set_error (error, CHECK_JOURNAL_ERROR, CHECK_JOURNAL_ERROR_BUSY,
+                       "%s: In use by another print or export job", journal->path);
+        }
+      else
+        {
+          check_journal_set_io_error (error, journal->path, errno);
+        }
+
+      return NULL;
+    }
+
+  if (created && !check_journal_sync_dir (dir, error))
+    {
+      return NULL;
+    }
+
+  /* Only read under the lock, when no one else is appending */
+  file = check_journal_file_open (journal->path, error);
+
+  if (!file)
+    {
+      return NULL;
+    }
+
+  journal->length = check_journal_file_scan (file, NULL, NULL, &journal->n_entries);
+
+  /* A new journal, or one whose header was cut short while creating it */
+  if (file->length < sizeof (JournalFileHeader))
+    {
+      JournalFileHeader header;
+
+      check_journal_init_header (&header);
+
+      if (ftruncate (journal->fd, 0) < 0)
+        {
+          check_journal_set_io_error (error, journal->path, errno);
+          return NULL;
+        }
+
+      /* The header is synced with the first group */
+      if (!check_journal_write_all (journal, (const char *) &header, sizeof (JournalFileHeader), error))
+        {
+          check_journal_fail (journal);
+          return NULL;
+        }
+
+      journal->length = sizeof (JournalFileHeader);
+      journal->n_unsynced = 1;
+
+      return g_steal_pointer (&journal);
+    }
+
+  if (journal->length < file->length)
+    {
+      g_warning ("%s: Discarding %" G_GUINT64_FORMAT " bytes after entry %" G_GUINT64_FORMAT
+                 ", left by an interrupted write",
+                 journal->path, file->length - journal->length, journal->n_entries);
+
+      if (ftruncate (journal->fd, (off_t) journal->length) < 0 || g_fsync (journal->fd) < 0)
+        {
+          check_journal_set_io_error (error, journal->path, errno);
+          return NULL;
+        }
+    }
+
+  g_debug ("%s: %" G_GUINT64_FORMAT " checks in %s", __func__, journal->n_entries, journal->path);
+
+  return g_steal_pointer (&journal);
+}
+
+void
+check_journal_free (CheckJournal *journal)
+{
+  g_autoptr (GError) error = NULL;
+
+  if (!journal)
+    {
+      return;
+    }
+
+  if (journal->fd >= 0)
+    {
+      if (!check_journal_sync (journal, &error))
+        {
+          g_warning ("Could not sync the check journal: %s", error->message);
+        }
+
+      if (journal->fd >= 0)
+        {
+          close (journal->fd);
+        }
+    }
+
+  g_free (journal->path);
+  g_free (journal);
+}
+
+guint64
+check_journal_get_n_entries (const CheckJournal *journal)
+{
+  g_return_val_if_fail (journal != NULL, 0);
+
+  return journal->n_entries;
+}
+
+/*
+ * Write an entry for the check in `check_data`, stamped with the current
+ * time. `cents` is its amount, or -1 when it does not parse. The file is
+ * synced when this completes a group of `group_size` entries. Once an
+ * append fails the journal is closed and every later append fails.
+ */
+gboolean
+check_journal_append (CheckJournal *journal,
+                      const CheckData *check_data,
+                      gint64 cents,
+                      guint32 layout_id,
+                      GError **error)
+{
+  const char *strings[CHECK_JOURNAL_N_STRINGS] = {
+    [CHECK_JOURNAL_CHECK_NUMBER] = check_data->check_number,
+    [CHECK_JOURNAL_PAYEE] = check_data->name,
+    [CHECK_JOURNAL_DATE] = check_data->date,
+    [CHECK_JOURNAL_MEMO] = check_data->memo,
+    [CHECK_JOURNAL_ROUTING] = check_data->routing,
+    [CHECK_JOURNAL_ACCOUNT] = check_data->account,
+  };
+  char buffer[JOURNAL_RECORD_MAX];
+  CheckJournalRecord record;
+  gsize size;
+
+  g_return_val_if_fail (journal != NULL, FALSE);
+  g_return_val_if_fail (check_data != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (journal->fd < 0)
+    {
+      g_set_error (error, CHECK_JOURNAL_ERROR, CHECK_JOURNAL_ERROR_IO,
+                   "%s: Closed after an earlier error", journal->path);
+      return FALSE;
+    }
+
+  record.sequence = journal->n_entries;
+  record.issued_at = g_get_real_time ();
+  record.cents = cents;
+  record.layout_id = layout_id;
+
+  for (int i = 0; i < CHECK_JOURNAL_N_STRINGS; ++i)
+    {
+      record.strings[i] = strings[i];
+      record.lengths[i] = (guint8) strnlen (strings[i], JOURNAL_STRING_MAX);
+    }
+
+  size = check_journal_encode (buffer, &record);
+
+  /* One write per record, a torn one is cut off when reopening */
+  if (!check_journal_write_all (journal, buffer, size, error))
+    {
+      check_journal_fail (journal);
+      return FALSE;
+    }
+
+  journal->length += size;
+  ++journal->n_entries;
+
+  if (++journal->n_unsynced >= journal->group_size)
+    {
+      return check_journal_sync (journal, error);
+    }
+
+  return TRUE;
+}
+
+/* Make every appended entry durable, e.g. when a print job finishes */
+gboolean
+check_journal_sync (CheckJournal *journal, GError **error)
+{
+  g_return_val_if_fail (journal != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (journal->fd < 0)
+    {
+      g_set_error (error, CHECK_JOURNAL_ERROR, CHECK_JOURNAL_ERROR_IO,
+                   "%s: Closed after an earlier error", journal->path);
+      return FALSE;
+    }
+
+  if (journal->n_unsynced == 0)
+    {
+      return TRUE;
+    }
+
+  if (g_fsync (journal->fd) < 0)
+    {
+      check_journal_set_io_error (error, journal->path, errno);
+      check_journal_fail (journal);
+      return FALSE;
+    }
+
+  journal->n_unsynced = 0;
+
+  return TRUE;
+}
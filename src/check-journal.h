@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef CHECKWRITER_CHECK_JOURNAL_H_
+#define CHECKWRITER_CHECK_JOURNAL_H_
+
+#include "check-properties.h"
+
+#include <glib.h>
+
+/*
+ * Append-only journal of issued checks. A check is journaled before its page
+ * is sent to the printer, so after a crash the journal lists every number
+ * that may have gone out.
+ *
+ * Each entry is written to the file as soon as it is appended, and the file
+ * is synced once every `group_size` entries and when the job finishes, so
+ * a batch does not wait for the disk on every page. Entries written since
+ * the last sync survive a crash of the application but not of the system.
+ *
+ * The file starts with a 16 byte header, followed by one record per entry:
+ *
+ *   guint32 length   Payload bytes
+ *   guint32 crc      CRC-32 (IEEE 802.3) of the payload
+ *   payload          Sequence number, time, cents, layout and the string
+ *                    lengths, then the strings without NUL terminators
+ *
+ * Numbers are in host byte order. A record that is cut short or fails its
+ * CRC ends the journal: it can only be the tail of an interrupted write, and
+ * it is truncated away when the journal is next opened for appending.
+ *
+ * Only one CheckJournal appends to a file at a time: check_journal_open ()
+ * locks the file until check_journal_free (), and fails with
+ * CHECK_JOURNAL_ERROR_BUSY while another window or process has it open.
+ * Readers take no lock; they stop at the last whole record.
+ *
+ * An entry keeps what the print path fills in a CheckData, except for what
+ * is derived from the rest: the amount, in figures and in words, comes from
+ * the cents and the MICR line from the numbers. Layouts are identified by
+ * check_journal_get_layout_id (), a CRC-32 of the layout properties that,
+ * unlike CheckLayout.version, is the same in every process.
+ *
+ * The default journal is $XDG_DATA_HOME/checkwriter/issued.journal.
+ */
+
+#define CHECK_JOURNAL_ERROR (check_journal_error_quark ())
+
+/* Entries written per sync while printing */
+#define CHECK_JOURNAL_GROUP_SIZE (32)
+
+typedef enum
+{
+  CHECK_JOURNAL_ERROR_IO,
+  CHECK_JOURNAL_ERROR_FORMAT,
+  CHECK_JOURNAL_ERROR_BUSY,
+} CheckJournalError;
+
+/* Strings of an entry, in the order they are stored */
+typedef enum
+{
+  CHECK_JOURNAL_CHECK_NUMBER,
+  CHECK_JOURNAL_PAYEE,
+  CHECK_JOURNAL_DATE,
+  CHECK_JOURNAL_MEMO,
+  CHECK_JOURNAL_ROUTING,
+  CHECK_JOURNAL_ACCOUNT,
+  CHECK_JOURNAL_N_STRINGS,
+} CheckJournalString;
+
+typedef struct check_journal CheckJournal;
+
+/* Read-only mapping of a journal, for lookups and exports */
+typedef struct check_journal_file CheckJournalFile;
+
+/* An entry read in place from a CheckJournalFile */
+typedef struct check_journal_record
+{
+  guint64 offset;    /* Of the record in the file */
+  guint64 sequence;  /* Position in the journal, from 0 */
+  gint64 issued_at;  /* Microseconds since the epoch, g_get_real_time () */
+  gint64 cents;      /* -1 when the amount did not parse */
+  guint32 layout_id; /* check_journal_get_layout_id () */
+
+  /* Point into the mapped file and are not NUL terminated */
+  const char *strings[CHECK_JOURNAL_N_STRINGS];
+  guint8 lengths[CHECK_JOURNAL_N_STRINGS];
+} CheckJournalRecord;
+
+/* Return FALSE to stop iterating */
+typedef gboolean (*CheckJournalFunc) (const CheckJournalRecord *record,
+                                      gpointer user_data);
+
+GQuark check_journal_error_quark (void);
+
+char *check_journal_get_default_path (void);
+
+guint32 check_journal_crc32 (guint32 crc,
+                             const void *data,
+                             gsize len);
+
+guint32 check_journal_get_layout_id (const CheckProperties *properties);
+
+CheckJournal *check_journal_open (const char *path,
+                                  guint group_size,
+                                  GError **error);
+
+void check_journal_free (CheckJournal *journal);
+
+guint64 check_journal_get_n_entries (const CheckJournal *journal);
+
+gboolean check_journal_append (CheckJournal *journal,
+                               const CheckData *check_data,
+                               gint64 cents,
+                               guint32 layout_id,
+                               GError **error);
+
+gboolean check_journal_sync (CheckJournal *journal,
+                             GError **error);
+
+CheckJournalFile *check_journal_file_open (const char *path,
+                                           GError **error);
+
+void check_journal_file_free (CheckJournalFile *file);
+
+gboolean check_journal_file_read (const CheckJournalFile *file,
+                                  guint64 *offset,
+                                  CheckJournalRecord *record);
+
+gboolean check_journal_foreach (const char *path,
+                                CheckJournalFunc func,
+                                gpointer user_data,
+                                GError **error);
+
+void check_journal_record_get_string (const CheckJournalRecord *record,
+                                      CheckJournalString string,
+                                      char *dst,
+                                      gsize len);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (CheckJournal, check_journal_free)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (CheckJournalFile, check_journal_file_free)
+
+#endif /* CHECKWRITER_CHECK_JOURNAL_H_ */
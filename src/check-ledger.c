@@ -0,0 +1,721 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include "check-ledger.h"
+#include "check-payees.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define LEDGER_FILE_MAGIC ("CWLIDX1")
+#define LEDGER_FILE_VERSION (1)
+
+/* Below this many recent checks, the index file is not rewritten */
+#define LEDGER_MERGE_MIN (1024)
+
+/*
+ * The header is followed by CHECK_LEDGER_N_INDEXES arrays of `n_checks`
+ * journal offsets, one per index, in CheckLedgerIndex order.
+ */
+typedef struct ledger_file_header
+{
+  char magic[8]; /* LEDGER_FILE_MAGIC, NUL terminated */
+  guint32 version;
+  guint32 reserved;
+  guint64 n_checks;
+
+  /* The last indexed check, to tell whether the journal is still the same */
+  guint64 last_offset;
+  gint64 last_issued_at;
+  guint64 journal_end; /* Offset just past it */
+} LedgerFileHeader;
+
+G_STATIC_ASSERT (sizeof (LedgerFileHeader) % 8 == 0);
+
+/* What an index sorts on; strings point into the journal */
+typedef struct ledger_key
+{
+  const char *number; /* Without leading zeros */
+  gsize number_len;
+  const char *payee;
+  gsize payee_len;
+  guint32 date;
+  guint64 sequence;
+} LedgerKey;
+
+typedef enum
+{
+  LEDGER_RUN_INDEXED, /* Mapped from the index file */
+  LEDGER_RUN_RECENT,  /* Journaled since, sorted in memory */
+  LEDGER_N_RUNS,
+} LedgerRun;
+
+struct check_ledger
+{
+  char *index_path;
+  CheckJournalFile *journal;
+
+  /* First run; NULL without a valid index file */
+  GMappedFile *index_file;
+  const guint64 *indexed[CHECK_LEDGER_N_INDEXES];
+  guint64 n_indexed;
+  guint64 indexed_end; /* Journal offset past the first run, 0 for the start */
+
+  /* Second run: keys in journal order, and their positions in index order */
+  LedgerKey *recent_keys;
+  guint64 *recent_offsets;
+  guint32 *recent[CHECK_LEDGER_N_INDEXES];
+  guint32 n_recent;
+};
+
+static bool
+parse_digits (const char *text, int n, guint *value)
+{
+  *value = 0;
+
+  for (int i = 0; i < n; ++i)
+    {
+      if (!g_ascii_isdigit (text[i]))
+        {
+          return false;
+        }
+
+      *value = (*value * 10) + (guint) (text[i] - '0');
+    }
+
+  return true;
+}
+
+/*
+ * Dates sort as the number YYYYMMDD. MM/DD/YYYY, as the date picker writes
+ * them, and YYYY-MM-DD are understood; anything else is 0 and sorts first.
+ */
+guint32
+check_ledger_parse_date (const char *date, gsize length)
+{
+  guint year, month, day;
+  bool ok = false;
+
+  g_return_val_if_fail (date != NULL || length == 0, 0);
+
+  if (length == 10 && date[2] == '/' && date[5] == '/')
+    {
+      ok = parse_digits (date, 2, &month) && parse_digits (date + 3, 2, &day)
+           && parse_digits (date + 6, 4, &year);
+    }
+  else if (length == 10 && date[4] == '-' && date[7] == '-')
+    {
+      ok = parse_digits (date, 4, &year) && parse_digits (date + 5, 2, &month)
+           && parse_digits (date + 8, 2, &day);
+    }
+
+  if (!ok || month < 1 || month > 12 || day < 1 || day > 31)
+    {
+      return 0;
+    }
+
+  return (year * 10000) + (month * 100) + day;
+}
+
+static void
+ledger_key_set_number (LedgerKey *key, const char *number, gsize length)
+{
+  while (length > 0 && *number == '0')
+    {
+      ++number;
+      --length;
+    }
+
+  key->number = number;
+  key->number_len = length;
+}
+
+static void
+ledger_key_init (LedgerKey *key, const CheckJournalRecord *record)
+{
+  ledger_key_set_number (key, record->strings[CHECK_JOURNAL_CHECK_NUMBER],
+                         record->lengths[CHECK_JOURNAL_CHECK_NUMBER]);
+
+  key->payee = record->strings[CHECK_JOURNAL_PAYEE];
+  key->payee_len = record->lengths[CHECK_JOURNAL_PAYEE];
+  key->date = check_ledger_parse_date (record->strings[CHECK_JOURNAL_DATE],
+                                       record->lengths[CHECK_JOURNAL_DATE]);
+  key->sequence = record->sequence;
+}
+
+static inline int
+compare_uint (guint64 a, guint64 b)
+{
+  return (a > b) - (a < b);
+}
+
+static int
+ledger_key_compare (CheckLedgerIndex index, const LedgerKey *a, const LedgerKey *b)
+{
+  int cmp = 0;
+
+  switch (index)
+    {
+    case CHECK_LEDGER_BY_NUMBER:
+      cmp = compare_uint (a->number_len, b->number_len);
+
+      if (cmp == 0 && a->number_len > 0)
+        {
+          cmp = memcmp (a->number, b->number, a->number_len);
+        }
+      break;
+
+    case CHECK_LEDGER_BY_PAYEE:
+      cmp = check_payee_compare (a->payee, a->payee_len, b->payee, b->payee_len);
+
+      if (cmp == 0)
+        {
+          cmp = compare_uint (a->date, b->date);
+        }
+      break;
+
+    case CHECK_LEDGER_BY_DATE:
+      cmp = compare_uint (a->date, b->date);
+      break;
+
+    default:
+      g_assert_not_reached ();
+    }
+
+  return (cmp != 0) ? cmp : compare_uint (a->sequence, b->sequence);
+}
+
+/**
+ * Runs
+ */
+
+static inline guint64
+check_ledger_run_length (const CheckLedger *ledger, LedgerRun run)
+{
+  return (run == LEDGER_RUN_INDEXED) ? ledger->n_indexed : ledger->n_recent;
+}
+
+static inline guint64
+check_ledger_run_offset (const CheckLedger *ledger, LedgerRun run, CheckLedgerIndex index, guint64 i)
+{
+  if (run == LEDGER_RUN_INDEXED)
+    {
+      return ledger->indexed[index][i];
+    }
+
+  return ledger->recent_offsets[ledger->recent[index][i]];
+}
+
+/* Key of the check at position `i` of an index; FALSE if it cannot be read */
+static bool
+check_ledger_run_key (const CheckLedger *ledger,
+                      LedgerRun run,
+                      CheckLedgerIndex index,
+                      guint64 i,
+                      LedgerKey *key)
+{
+  CheckJournalRecord record;
+  guint64 offset;
+
+  if (run == LEDGER_RUN_RECENT)
+    {
+      *key = ledger->recent_keys[ledger->recent[index][i]];
+      return true;
+    }
+
+  offset = ledger->indexed[index][i];
+
+  if (!check_journal_file_read (ledger->journal, &offset, &record))
+    {
+      return false;
+    }
+
+  ledger_key_init (key, &record);
+
+  return true;
+}
+
+/*
+ * First position in a run whose key is not less than `bound`. The bounds of
+ * a lookup have the smallest or largest sequence number, so they include
+ * every check with the same key.
+ */
+static guint64
+check_ledger_run_search (const CheckLedger *ledger,
+                         LedgerRun run,
+                         CheckLedgerIndex index,
+                         const LedgerKey *bound)
+{
+  guint64 lo = 0;
+  guint64 hi = check_ledger_run_length (ledger, run);
+
+  while (lo < hi)
+    {
+      guint64 mid = lo + ((hi - lo) / 2);
+      LedgerKey key;
+
+      /* An unreadable check sorts first rather than stop the search */
+      if (!check_ledger_run_key (ledger, run, index, mid, &key)
+          || ledger_key_compare (index, &key, bound) < 0)
+        {
+          lo = mid + 1;
+        }
+      else
+        {
+          hi = mid;
+        }
+    }
+
+  return lo;
+}
+
+/* Call `func` for the checks between `first` and `last` of an index, in order */
+static guint64
+check_ledger_find (const CheckLedger *ledger,
+                   CheckLedgerIndex index,
+                   const LedgerKey *first,
+                   const LedgerKey *last,
+                   CheckJournalFunc func,
+                   gpointer user_data)
+{
+  guint64 pos[LEDGER_N_RUNS], end[LEDGER_N_RUNS];
+  guint64 n_found = 0;
+
+  for (int run = 0; run < LEDGER_N_RUNS; ++run)
+    {
+      pos[run] = check_ledger_run_search (ledger, run, index, first);
+      end[run] = check_ledger_run_search (ledger, run, index, last);
+    }
+
+  while (pos[LEDGER_RUN_INDEXED] < end[LEDGER_RUN_INDEXED] || pos[LEDGER_RUN_RECENT] < end[LEDGER_RUN_RECENT])
+    {
+      LedgerRun run = (pos[LEDGER_RUN_INDEXED] < end[LEDGER_RUN_INDEXED]) ? LEDGER_RUN_INDEXED : LEDGER_RUN_RECENT;
+      CheckJournalRecord record;
+      guint64 offset;
+
+      /* Merge the runs, taking the smaller key first */
+      if (pos[LEDGER_RUN_INDEXED] < end[LEDGER_RUN_INDEXED] && pos[LEDGER_RUN_RECENT] < end[LEDGER_RUN_RECENT])
+        {
+          LedgerKey indexed_key, recent_key;
+
+          check_ledger_run_key (ledger, LEDGER_RUN_RECENT, index, pos[LEDGER_RUN_RECENT], &recent_key);
+
+          if (check_ledger_run_key (ledger, LEDGER_RUN_INDEXED, index, pos[LEDGER_RUN_INDEXED], &indexed_key)
+              && ledger_key_compare (index, &recent_key, &indexed_key) < 0)
+            {
+              run = LEDGER_RUN_RECENT;
+            }
+        }
+
+      offset = check_ledger_run_offset (ledger, run, index, pos[run]++);
+
+      if (check_journal_file_read (ledger->journal, &offset, &record))
+        {
+          ++n_found;
+
+          if (!func (&record, user_data))
+            {
+              break;
+            }
+        }
+    }
+
+  return n_found;
+}
+
+/**
+ * Lookups
+ *
+ * Bounds that are NULL are open. Each returns how many checks it passed to
+ * `func`, which can stop the lookup by returning FALSE.
+ */
+
+static void
+ledger_key_init_first (LedgerKey *key)
+{
+  memset (key, 0, sizeof (LedgerKey));
+  key->number = key->payee = "";
+}
+
+static void
+ledger_key_init_last (LedgerKey *key)
+{
+  ledger_key_init_first (key);
+  key->number_len = G_MAXSIZE;
+  key->date = G_MAXUINT32;
+  key->sequence = G_MAXUINT64;
+}
+
+/* Checks numbered from `first` to `last`, in number order */
+guint64
+check_ledger_find_number (const CheckLedger *ledger,
+                          const char *first,
+                          const char *last,
+                          CheckJournalFunc func,
+                          gpointer user_data)
+{
+  LedgerKey first_key, last_key;
+
+  g_return_val_if_fail (ledger != NULL, 0);
+  g_return_val_if_fail (func != NULL, 0);
+
+  ledger_key_init_first (&first_key);
+  ledger_key_init_last (&last_key);
+
+  if (first)
+    {
+      ledger_key_set_number (&first_key, first, strlen (first));
+    }
+
+  if (last)
+    {
+      ledger_key_set_number (&last_key, last, strlen (last));
+    }
+
+  return check_ledger_find (ledger, CHECK_LEDGER_BY_NUMBER, &first_key, &last_key, func, user_data);
+}
+
+/* Checks to `payee` (ignoring ASCII case) dated in a period, by date */
+guint64
+check_ledger_find_payee (const CheckLedger *ledger,
+                         const char *payee,
+                         const char *first_date,
+                         const char *last_date,
+                         CheckJournalFunc func,
+                         gpointer user_data)
+{
+  LedgerKey first_key, last_key;
+
+  g_return_val_if_fail (ledger != NULL, 0);
+  g_return_val_if_fail (payee != NULL, 0);
+  g_return_val_if_fail (func != NULL, 0);
+
+  ledger_key_init_first (&first_key);
+  ledger_key_init_last (&last_key);
+
+  first_key.payee = last_key.payee = payee;
+  first_key.payee_len = last_key.payee_len = strlen (payee);
+
+  if (first_date)
+    {
+      first_key.date = check_ledger_parse_date (first_date, strlen (first_date));
+    }
+
+  if (last_date)
+    {
+      last_key.date = check_ledger_parse_date (last_date, strlen (last_date));
+    }
+
+  return check_ledger_find (ledger, CHECK_LEDGER_BY_PAYEE, &first_key, &last_key, func, user_data);
+}
+
+/* Checks dated from `first_date` to `last_date`, by date */
+guint64
+check_ledger_find_date (const CheckLedger *ledger,
+                        const char *first_date,
+                        const char *last_date,
+                        CheckJournalFunc func,
+                        gpointer user_data)
+{
+  LedgerKey first_key, last_key;
+
+  g_return_val_if_fail (ledger != NULL, 0);
+  g_return_val_if_fail (func != NULL, 0);
+
+  ledger_key_init_first (&first_key);
+  ledger_key_init_last (&last_key);
+
+  if (first_date)
+    {
+      first_key.date = check_ledger_parse_date (first_date, strlen (first_date));
+    }
+
+  if (last_date)
+    {
+      last_key.date = check_ledger_parse_date (last_date, strlen (last_date));
+    }
+
+  return check_ledger_find (ledger, CHECK_LEDGER_BY_DATE, &first_key, &last_key, func, user_data);
+}
+
+/**
+ * Loading
+ */
+
+static void
+check_ledger_unload (CheckLedger *ledger)
+{
+  g_clear_pointer (&ledger->index_file, g_mapped_file_unref);
+  memset (ledger->indexed, 0, sizeof (ledger->indexed));
+  ledger->n_indexed = 0;
+  ledger->indexed_end = 0;
+
+  g_clear_pointer (&ledger->recent_keys, g_free);
+  g_clear_pointer (&ledger->recent_offsets, g_free);
+
+  for (int i = 0; i < CHECK_LEDGER_N_INDEXES; ++i)
+    {
+      g_clear_pointer (&ledger->recent[i], g_free);
+    }
+
+  ledger->n_recent = 0;
+}
+
+/* Map the index file as the first run, if it matches the journal */
+static void
+check_ledger_map_index (CheckLedger *ledger)
+{
+  g_autoptr (GError) error = NULL;
+  LedgerFileHeader header;
+  CheckJournalRecord record;
+  const char *data = NULL;
+  guint64 offset = 0;
+  gsize length;
+
+  memset (&header, 0, sizeof (LedgerFileHeader));
+  ledger->index_file = g_mapped_file_new (ledger->index_path, FALSE, &error);
+
+  if (!ledger->index_file)
+    {
+      g_debug ("%s: No index: %s", __func__, error->message);
+      return;
+    }
+
+  data = g_mapped_file_get_contents (ledger->index_file);
+  length = g_mapped_file_get_length (ledger->index_file);
+
+  if (length >= sizeof (LedgerFileHeader))
+    {
+      memcpy (&header, data, sizeof (LedgerFileHeader));
+      offset = header.last_offset;
+    }
+
+  if (length < sizeof (LedgerFileHeader)
+      || memcmp (header.magic, LEDGER_FILE_MAGIC, sizeof (header.magic)) != 0
+      || header.version != LEDGER_FILE_VERSION
+      || header.n_checks == 0
+      || header.n_checks > ((length - sizeof (LedgerFileHeader)) / (CHECK_LEDGER_N_INDEXES * sizeof (guint64)))
+      || length != sizeof (LedgerFileHeader) + (header.n_checks * CHECK_LEDGER_N_INDEXES * sizeof (guint64))
+      || !check_journal_file_read (ledger->journal, &offset, &record)
+      || record.sequence != header.n_checks - 1
+      || record.issued_at != header.last_issued_at
+      || offset != header.journal_end)
+    {
+      g_debug ("%s: %s does not match the journal, rebuilding it", __func__, ledger->index_path);
+      g_clear_pointer (&ledger->index_file, g_mapped_file_unref);
+      return;
+    }
+
+  for (int i = 0; i < CHECK_LEDGER_N_INDEXES; ++i)
+    {
+      ledger->indexed[i] = (const guint64 *) (data + sizeof (LedgerFileHeader)) + (i * header.n_checks);
+    }
+
+  ledger->n_indexed = header.n_checks;
+  ledger->indexed_end = header.journal_end;
+}
+
+typedef struct
+{
+  const LedgerKey *keys;
+  CheckLedgerIndex index;
+} LedgerSortContext;
+
+static int
+check_ledger_compare_recent (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  const LedgerSortContext *context = user_data;
+
+  return ledger_key_compare (context->index,
+                             &context->keys[*(const guint32 *) a],
+                             &context->keys[*(const guint32 *) b]);
+}
+
+/* Read and sort the checks past the first run as the second run */
+static void
+check_ledger_load_recent (CheckLedger *ledger)
+{
+  GArray *keys = g_array_new (FALSE, FALSE, sizeof (LedgerKey));
+  GArray *offsets = g_array_new (FALSE, FALSE, sizeof (guint64));
+  CheckJournalRecord record;
+  guint64 offset = ledger->indexed_end;
+
+  while (keys->len < G_MAXUINT32
+         && check_journal_file_read (ledger->journal, &offset, &record)
+         && record.sequence == ledger->n_indexed + keys->len)
+    {
+      LedgerKey key;
+
+      ledger_key_init (&key, &record);
+      g_array_append_val (keys, key);
+      g_array_append_val (offsets, record.offset);
+    }
+
+  ledger->n_recent = keys->len;
+  ledger->recent_keys = (LedgerKey *) g_array_free (keys, FALSE);
+  ledger->recent_offsets = (guint64 *) g_array_free (offsets, FALSE);
+
+  for (int i = 0; i < CHECK_LEDGER_N_INDEXES; ++i)
+    {
+      LedgerSortContext context = { ledger->recent_keys, i };
+
+      ledger->recent[i] = g_new (guint32, MAX (ledger->n_recent, 1));
+
+      for (guint32 j = 0; j < ledger->n_recent; ++j)
+        {
+          ledger->recent[i][j] = j;
+        }
+
+      g_qsort_with_data (ledger->recent[i], ledger->n_recent, sizeof (guint32),
+                         check_ledger_compare_recent, &context);
+    }
+}
+
+/* Merge both runs into a new index file */
+static gboolean
+check_ledger_write_index (const CheckLedger *ledger, GError **error)
+{
+  guint64 n_checks = ledger->n_indexed + ledger->n_recent;
+  gsize size = sizeof (LedgerFileHeader) + (n_checks * CHECK_LEDGER_N_INDEXES * sizeof (guint64));
+  guint64 last = ledger->recent_offsets[ledger->n_recent - 1];
+  g_autofree char *contents = g_malloc (size);
+  LedgerFileHeader *header = (LedgerFileHeader *) contents;
+  guint64 *out = (guint64 *) (contents + sizeof (LedgerFileHeader));
+  CheckJournalRecord record;
+
+  if (!check_journal_file_read (ledger->journal, &last, &record))
+    {
+      g_set_error (error, CHECK_JOURNAL_ERROR, CHECK_JOURNAL_ERROR_FORMAT,
+                   "The journal changed while indexing it");
+      return FALSE;
+    }
+
+  memset (header, 0, sizeof (LedgerFileHeader));
+  memcpy (header->magic, LEDGER_FILE_MAGIC, sizeof (header->magic));
+  header->version = LEDGER_FILE_VERSION;
+  header->n_checks = n_checks;
+  header->last_offset = record.offset;
+  header->last_issued_at = record.issued_at;
+  header->journal_end = last;
+
+  for (int index = 0; index < CHECK_LEDGER_N_INDEXES; ++index)
+    {
+      guint64 i = 0, j = 0;
+
+      while (i < ledger->n_indexed || j < ledger->n_recent)
+        {
+          LedgerKey key;
+          bool take_recent = (i == ledger->n_indexed);
+
+          if (!take_recent && j < ledger->n_recent)
+            {
+              take_recent = check_ledger_run_key (ledger, LEDGER_RUN_INDEXED, index, i, &key)
+                            && ledger_key_compare (index, &ledger->recent_keys[ledger->recent[index][j]], &key) < 0;
+            }
+
+          *out++ = take_recent ? check_ledger_run_offset (ledger, LEDGER_RUN_RECENT, index, j++)
+                               : ledger->indexed[index][i++];
+        }
+    }
+
+  return g_file_set_contents_full (ledger->index_path, contents, size,
+                                   G_FILE_SET_CONTENTS_CONSISTENT, 0600, error);
+}
+
+static void
+check_ledger_load (CheckLedger *ledger)
+{
+  check_ledger_unload (ledger);
+  check_ledger_map_index (ledger);
+  check_ledger_load_recent (ledger);
+}
+
+/*
+ * Open the ledger of the journal at `journal_path`, or of the default
+ * journal when NULL. The index file is `journal_path` with ".index"
+ * appended. A journal that does not exist yet has no checks.
+ */
+CheckLedger *
+check_ledger_open (const char *journal_path, GError **error)
+{
+  g_autoptr (CheckLedger) ledger = NULL;
+  g_autofree char *default_path = NULL;
+
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (!journal_path)
+    {
+      journal_path = default_path = check_journal_get_default_path ();
+    }
+
+  ledger = g_new0 (CheckLedger, 1);
+  ledger->index_path = g_strconcat (journal_path, ".index", NULL);
+  ledger->journal = check_journal_file_open (journal_path, error);
+
+  if (!ledger->journal)
+    {
+      return NULL;
+    }
+
+  check_ledger_load (ledger);
+
+  if (ledger->n_recent > MAX (LEDGER_MERGE_MIN, ledger->n_indexed / 8))
+    {
+      g_autoptr (GError) local_error = NULL;
+
+      /* Without a new index file, the runs work as they are */
+      if (check_ledger_write_index (ledger, &local_error))
+        {
+          check_ledger_load (ledger);
+        }
+      else
+        {
+          g_warning ("Could not write the ledger index: %s", local_error->message);
+        }
+    }
+
+  g_debug ("%s: %" G_GUINT64_FORMAT " indexed and %u recent checks", __func__,
+           ledger->n_indexed, ledger->n_recent);
+
+  return g_steal_pointer (&ledger);
+}
+
+void
+check_ledger_free (CheckLedger *ledger)
+{
+  if (!ledger)
+    {
+      return;
+    }
+
+  check_ledger_unload (ledger);
+  g_clear_pointer (&ledger->journal, check_journal_file_free);
+  g_free (ledger->index_path);
+  g_free (ledger);
+}
+
+guint64
+check_ledger_get_n_checks (const CheckLedger *ledger)
+{
+  g_return_val_if_fail (ledger != NULL, 0);
+
+  return ledger->n_indexed + ledger->n_recent;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef CHECKWRITER_CHECK_LEDGER_H_
+#define CHECKWRITER_CHECK_LEDGER_H_
+
+#include "check-journal.h"
+
+#include <glib.h>
+
+/*
+ * The ledger looks up issued checks in the journal (see check-journal.h) by
+ * check number, payee or date, without reading the whole journal.
+ *
+ * Each index is an array of journal offsets, sorted by:
+ *
+ *   number  the check number as a whole number: leading zeros are ignored
+ *           and shorter numbers come first
+ *   payee   the payee ignoring ASCII case, like the payee directory, then
+ *           the date, so the checks to a payee in a period are consecutive
+ *   date    the date, see check_ledger_parse_date ()
+ *
+ * and then by position in the journal. The indexes are kept in two sorted
+ * runs. The first one is mapped from an index file next to the journal, and
+ * covers the journal up to when that file was written. The second one holds
+ * the checks journaled since, sorted when the ledger is opened. A lookup is
+ * two binary searches per run, and its results are merged from both runs.
+ *
+ * When the second run grows past an eighth of the first, opening the ledger
+ * merges them into a new index file. Each check is then rewritten a bounded
+ * number of times however large the journal grows, and the second run stays
+ * small enough to sort quickly. The index file holds nothing that is not in
+ * the journal: it is rebuilt when missing, or when it no longer matches the
+ * journal.
+ *
+ * A ledger is a snapshot of the journal when it was opened.
+ */
+
+typedef enum
+{
+  CHECK_LEDGER_BY_NUMBER,
+  CHECK_LEDGER_BY_PAYEE,
+  CHECK_LEDGER_BY_DATE,
+  CHECK_LEDGER_N_INDEXES,
+} CheckLedgerIndex;
+
+typedef struct check_ledger CheckLedger;
+
+guint32 check_ledger_parse_date (const char *date,
+                                 gsize length);
+
+CheckLedger *check_ledger_open (const char *journal_path,
+                                GError **error);
+
+void check_ledger_free (CheckLedger *ledger);
+
+guint64 check_ledger_get_n_checks (const CheckLedger *ledger);
+
+guint64 check_ledger_find_number (const CheckLedger *ledger,
+                                  const char *first,
+                                  const char *last,
+                                  CheckJournalFunc func,
+                                  gpointer user_data);
+
+guint64 check_ledger_find_payee (const CheckLedger *ledger,
+                                 const char *payee,
+                                 const char *first_date,
+                                 const char *last_date,
+                                 CheckJournalFunc func,
+                                 gpointer user_data);
+
+guint64 check_ledger_find_date (const CheckLedger *ledger,
+                                const char *first_date,
+                                const char *last_date,
+                                CheckJournalFunc func,
+                                gpointer user_data);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (CheckLedger, check_ledger_free)
+
+#endif /* CHECKWRITER_CHECK_LEDGER_H_ */
@@ -0,0 +1,420 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include "check-micr.h"
+
+#include <string.h>
+
+/* Fields of the line, as the position of their rightmost character */
+#define MICR_ON_US_LAST (14)
+#define MICR_ON_US_LEN (18)
+#define MICR_TRANSIT_LAST (33)
+#define MICR_ROUTING_LEN (9)
+
+/* Glyphs are drawn on a grid of GLYPH_WIDTH x GLYPH_HEIGHT design units */
+#define GLYPH_WIDTH (7)
+#define GLYPH_HEIGHT (9)
+#define N_GLYPHS (14)
+
+/*
+ * Outlines of the E-13B characters on the design grid, top row first: the
+ * ten digits, then the transit, amount, on-us and dash symbols.
+ */
+static const char *const MICR_GLYPHS[N_GLYPHS][GLYPH_HEIGHT] = {
+  { ".#####.", ".#...#.", ".#...#.", ".#...#.", "##...##", "##...##", "##...##", "##...##", "#######" },
+  { "..###..", "...##..", "...##..", "...##..", "...##..", "..####.", "..####.", "..####.", "..####." },
+  { ".#####.", ".....#.", ".....#.", ".#####.", ".##....", ".##....", ".##....", ".######", ".######" },
+  { ".####..", "....#..", "....#..", ".#####.", "....##.", "....##.", "....##.", ".######", ".######" },
+  { ".#.....", ".#.....", ".#.....", ".#..#..", ".#..#..", "#######", "#######", "....##.", "....##." },
+  { ".#####.", ".#.....", ".#.....", ".#####.", "....##.", "....##.", "....##.", "######.", "######." },
+  { ".##....", ".#.....", ".#.....", ".#####.", "##...#.", "##...#.", "##...#.", "#######", "#######" },
+  { "#######", ".....#.", ".....#.", "....#..", "...##..", "...##..", "...##..", "...##..", "...##.." },
+  { ".#####.", ".#...#.", ".#...#.", ".#####.", "##...##", "##...##", "##...##", "#######", "#######" },
+  { ".#####.", ".#...#.", ".#...#.", ".######", "....##.", "....##.", "....##.", "....##.", "....##." },
+  { "##..##.", "##..##.", "##.....", "##.....", "##.....", "##.....", "##.....", "##..##.", "##..##." },
+  { "##.....", "##.....", "##.##..", "##.##..", "...##..", "...##..", "##.##..", "##.....", "##....." },
+  { "##.##..", "##.##..", "##.##..", "##.##..", ".......", ".......", "##.##..", "##.##..", "##.##.." },
+  { ".......", ".......", ".......", "##.##.#", "##.##.#", "##.##.#", ".......", ".......", "......." },
+};
+
+static cairo_path_t *MICR_GLYPH_PATHS[N_GLYPHS];
+
+static inline bool
+check_micr_is_digit (char ch)
+{
+  return ch >= '0' && ch <= '9';
+}
+
+static int
+check_micr_glyph_index (char ch)
+{
+  if (check_micr_is_digit (ch))
+    {
+      return ch - '0';
+    }
+
+  if (ch >= CHECK_MICR_TRANSIT && ch <= CHECK_MICR_DASH)
+    {
+      return 10 + (ch - CHECK_MICR_TRANSIT);
+    }
+
+  return -1;
+}
+
+/* Whether row `row` of a glyph has a run of ink exactly from `x0` to `x1` */
+static bool
+check_micr_glyph_has_run (const char *const *rows, int row, int x0, int x1)
+{
+  const char *cells = NULL;
+
+  if (row < 0 || row >= GLYPH_HEIGHT)
+    {
+      return false;
+    }
+
+  cells = rows[row];
+
+  if ((x0 > 0 && cells[x0 - 1] == '#') || (x1 < GLYPH_WIDTH && cells[x1] == '#'))
+    {
+      return false;
+    }
+
+  for (int x = x0; x < x1; ++x)
+    {
+      if (cells[x] != '#')
+        {
+          return false;
+        }
+    }
+
+  return true;
+}
+
+/*
+ * Trace a glyph as rectangles in design units, with the baseline at y = 0.
+ * Runs of ink repeated on consecutive rows become one rectangle.
+ */
+static void
+check_micr_trace_glyph (cairo_t *cr, const char *const *rows)
+{
+  for (int row = 0; row < GLYPH_HEIGHT; ++row)
+    {
+      const char *cells = rows[row];
+      int x = 0;
+
+      while (x < GLYPH_WIDTH)
+        {
+          int x0, height;
+
+          if (cells[x] != '#')
+            {
+              ++x;
+              continue;
+            }
+
+          x0 = x;
+
+          while (x < GLYPH_WIDTH && cells[x] == '#')
+            {
+              ++x;
+            }
+
+          /* Already part of the rectangle started on the row above */
+          if (check_micr_glyph_has_run (rows, row - 1, x0, x))
+            {
+              continue;
+            }
+
+          height = 1;
+
+          while (check_micr_glyph_has_run (rows, row + height, x0, x))
+            {
+              ++height;
+            }
+
+          cairo_rectangle (cr, x0, row - GLYPH_HEIGHT, x - x0, height);
+        }
+    }
+}
+
+/* Build the path of every glyph once; the table is read-only afterwards */
+static void
+check_micr_ensure_glyphs (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+    {
+      cairo_surface_t *surface = cairo_image_surface_create (CAIRO_FORMAT_A8, 1, 1);
+      cairo_t *cr = cairo_create (surface);
+
+      for (int i = 0; i < N_GLYPHS; ++i)
+        {
+          cairo_new_path (cr);
+          check_micr_trace_glyph (cr, MICR_GLYPHS[i]);
+          MICR_GLYPH_PATHS[i] = cairo_copy_path_flat (cr);
+        }
+
+      cairo_destroy (cr);
+      cairo_surface_destroy (surface);
+
+      g_once_init_leave (&initialized, 1);
+    }
+}
+
+/*
+ * ABA routing numbers are nine digits whose weighted sum, with the weights
+ * 3, 7, 1 repeated, is a multiple of ten.
+ */
+bool
+check_micr_routing_is_valid (const char *routing)
+{
+  static const int weights[MICR_ROUTING_LEN] = { 3, 7, 1, 3, 7, 1, 3, 7, 1 };
+  int sum = 0;
+
+  if (!routing)
+    {
+      return false;
+    }
+
+  for (int i = 0; i < MICR_ROUTING_LEN; ++i)
+    {
+      if (!check_micr_is_digit (routing[i]))
+        {
+          return false;
+        }
+
+      sum += weights[i] * (routing[i] - '0');
+    }
+
+  return routing[MICR_ROUTING_LEN] == '\0' && (sum % 10) == 0;
+}
+
+/* Copy `text` to `dst` ending in position `last` */
+static void
+check_micr_place (char *line, int last, const char *text, gsize len)
+{
+  memcpy (line + (CHECK_MICR_LINE_POSITIONS - last) - (len - 1), text, len);
+}
+
+/*
+ * Lay out a MICR line in `dst`, which must hold CHECK_MICR_LINE_LEN bytes.
+ * The account number may contain spaces and dashes, the check number only
+ * digits. With all three fields empty, `dst` is set to an empty string: the
+ * check has no MICR line.
+ */
+CheckMicrStatus
+check_micr_format_line (char *dst,
+                        gsize len,
+                        const char *check_number,
+                        const char *routing,
+                        const char *account)
+{
+  char transit[MICR_ROUTING_LEN + 2];
+  char on_us[MICR_ON_US_LEN + 1];
+  gsize on_us_len = 0;
+
+  g_return_val_if_fail (dst != NULL, CHECK_MICR_ERROR_TOO_LONG);
+  g_return_val_if_fail (len >= CHECK_MICR_LINE_LEN, CHECK_MICR_ERROR_TOO_LONG);
+
+  check_number = check_number ? check_number : "";
+  routing = routing ? routing : "";
+  account = account ? account : "";
+  dst[0] = '\0';
+
+  if (!*check_number && !*routing && !*account)
+    {
+      return CHECK_MICR_OK;
+    }
+
+  if (strlen (routing) != MICR_ROUTING_LEN || strspn (routing, "0123456789") != MICR_ROUTING_LEN)
+    {
+      return CHECK_MICR_ERROR_ROUTING;
+    }
+
+  if (!check_micr_routing_is_valid (routing))
+    {
+      return CHECK_MICR_ERROR_CHECKSUM;
+    }
+
+  if (strspn (account, "0123456789 -") != strlen (account))
+    {
+      return CHECK_MICR_ERROR_ACCOUNT;
+    }
+
+  if (strspn (check_number, "0123456789") != strlen (check_number))
+    {
+      return CHECK_MICR_ERROR_CHECK_NUMBER;
+    }
+
+  /* Account number and on-us symbol, then a space and the check number */
+  if ((*account ? strlen (account) + 1 : 0) + (*account && *check_number ? 1 : 0)
+      + strlen (check_number) > MICR_ON_US_LEN)
+    {
+      return CHECK_MICR_ERROR_TOO_LONG;
+    }
+
+  for (const char *cur = account; *cur; ++cur)
+    {
+      on_us[on_us_len++] = (*cur == '-') ? CHECK_MICR_DASH : *cur;
+    }
+
+  if (on_us_len > 0)
+    {
+      on_us[on_us_len++] = CHECK_MICR_ON_US;
+
+      if (*check_number)
+        {
+          on_us[on_us_len++] = ' ';
+        }
+    }
+
+  for (const char *cur = check_number; *cur; ++cur)
+    {
+      on_us[on_us_len++] = *cur;
+    }
+
+  transit[0] = CHECK_MICR_TRANSIT;
+  memcpy (transit + 1, routing, MICR_ROUTING_LEN);
+  transit[MICR_ROUTING_LEN + 1] = CHECK_MICR_TRANSIT;
+
+  memset (dst, ' ', CHECK_MICR_LINE_POSITIONS);
+  dst[CHECK_MICR_LINE_POSITIONS] = '\0';
+
+  check_micr_place (dst, MICR_TRANSIT_LAST, transit, sizeof (transit));
+
+  if (on_us_len > 0)
+    {
+      check_micr_place (dst, MICR_ON_US_LAST, on_us, on_us_len);
+    }
+
+  return CHECK_MICR_OK;
+}
+
+const char *
+check_micr_status_to_string (CheckMicrStatus status)
+{
+  switch (status)
+    {
+    case CHECK_MICR_OK:
+      return "Valid MICR line";
+    case CHECK_MICR_ERROR_ROUTING:
+      return "Routing numbers have nine digits";
+    case CHECK_MICR_ERROR_CHECKSUM:
+      return "Routing number checksum does not match";
+    case CHECK_MICR_ERROR_ACCOUNT:
+      return "Account numbers may only have digits, spaces and dashes";
+    case CHECK_MICR_ERROR_CHECK_NUMBER:
+      return "Check numbers may only have digits";
+    case CHECK_MICR_ERROR_TOO_LONG:
+      return "Account and check number do not fit the on-us field";
+    default:
+      return "Invalid MICR line";
+    }
+}
+
+/*
+ * Where the MICR line goes on a check of the given size: from the left of
+ * position 43 to the right of position 1, on the bottom of the characters.
+ */
+void
+check_micr_get_standard_position (double check_width,
+                                  double check_height,
+                                  FieldProperties *micr)
+{
+  g_return_if_fail (micr != NULL);
+
+  micr->width = CHECK_MICR_LINE_POSITIONS * CHECK_MICR_PITCH_MM;
+  micr->x_pos = check_width - CHECK_MICR_RIGHT_MM - micr->width;
+  micr->y_pos = check_height - CHECK_MICR_BOTTOM_MM;
+}
+
+/*
+ * Append the glyphs of a formatted line to the current path, right aligned
+ * to `x_right` with their bottom on `baseline`. The caller fills the path.
+ */
+void
+check_micr_append_path (cairo_t *cr,
+                        const char *line,
+                        double x_right,
+                        double baseline,
+                        double x_px_per_mm,
+                        double y_px_per_mm)
+{
+  const double pitch = CHECK_MICR_PITCH_MM * x_px_per_mm;
+  const double margin = ((CHECK_MICR_PITCH_MM - (GLYPH_WIDTH * CHECK_MICR_UNIT_MM)) / 2.0) * x_px_per_mm;
+  gsize n;
+
+  if (!cr || !line)
+    {
+      return;
+    }
+
+  check_micr_ensure_glyphs ();
+  n = strlen (line);
+
+  for (gsize i = 0; i < n; ++i)
+    {
+      int glyph = check_micr_glyph_index (line[i]);
+
+      if (glyph < 0)
+        {
+          continue;
+        }
+
+      /* Character i is in position n - i */
+      cairo_save (cr);
+      cairo_translate (cr, x_right - ((double) (n - i) * pitch) + margin, baseline);
+      cairo_scale (cr, CHECK_MICR_UNIT_MM * x_px_per_mm, CHECK_MICR_UNIT_MM * y_px_per_mm);
+      cairo_append_path (cr, MICR_GLYPH_PATHS[glyph]);
+      cairo_restore (cr);
+    }
+}
+
+/*
+ * Store the MICR fields in `check_data` and lay out its MICR line. On
+ * failure the fields are still stored, but the line is left empty.
+ */
+CheckMicrStatus
+check_data_set_micr (CheckData *check_data,
+                     const char *check_number,
+                     const char *routing,
+                     const char *account)
+{
+  CheckMicrStatus status;
+
+  g_return_val_if_fail (check_data != NULL, CHECK_MICR_ERROR_TOO_LONG);
+
+  g_strlcpy (check_data->check_number, check_number ? check_number : "", STRING_LEN);
+  g_strlcpy (check_data->routing, routing ? routing : "", STRING_LEN);
+  g_strlcpy (check_data->account, account ? account : "", STRING_LEN);
+
+  status = check_micr_format_line (check_data->micr, STRING_LEN,
+                                   check_data->check_number, check_data->routing,
+                                   check_data->account);
+
+  if (status != CHECK_MICR_OK)
+    {
+      check_data->micr[0] = '\0';
+    }
+
+  return status;
+}
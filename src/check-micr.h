@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef CHECKWRITER_CHECK_MICR_H_
+#define CHECKWRITER_CHECK_MICR_H_
+
+#include "check-properties.h"
+
+#include <cairo.h>
+#include <glib.h>
+
+/*
+ * The MICR line along the bottom of a check, in the E-13B character set.
+ *
+ * Characters sit in fixed positions of 0.125" each, numbered from the right
+ * edge of the line. Position 1 ends 5/16" from the right edge of the check
+ * and the bottom of the characters is 3/16" above its bottom edge. The line
+ * is laid out like a personal check:
+ *
+ *   positions 43-33  transit field: routing number between transit symbols
+ *   positions 31-14  on-us field: account number, on-us symbol, check number
+ *   positions 12-1   amount field, left blank for the bank of first deposit
+ *
+ * A formatted line is a string of CHECK_MICR_LINE_POSITIONS characters, the
+ * first one in position 43. It holds digits, spaces and the four E-13B
+ * symbols, written with the letters used by most MICR fonts.
+ *
+ * Glyphs are drawn from outlines on the 0.013" E-13B design grid. They are
+ * turned into cairo paths once per process and appended from that table for
+ * every check. Banks only read MICR lines printed with magnetic toner, so
+ * test a printed check with the bank before relying on blank stock.
+ */
+
+#define CHECK_MICR_PITCH_MM (3.175)  /* 0.125" per character */
+#define CHECK_MICR_UNIT_MM (0.3302)  /* E-13B design grid, 0.013" */
+#define CHECK_MICR_RIGHT_MM (7.9375) /* Position 1 to the right edge, 5/16" */
+#define CHECK_MICR_BOTTOM_MM (4.7625) /* Characters to the bottom edge, 3/16" */
+
+#define CHECK_MICR_LINE_POSITIONS (43)
+#define CHECK_MICR_LINE_LEN (CHECK_MICR_LINE_POSITIONS + 1)
+
+#define CHECK_MICR_TRANSIT ('A')
+#define CHECK_MICR_AMOUNT ('B')
+#define CHECK_MICR_ON_US ('C')
+#define CHECK_MICR_DASH ('D')
+
+typedef enum
+{
+  CHECK_MICR_OK,
+  CHECK_MICR_ERROR_ROUTING,
+  CHECK_MICR_ERROR_CHECKSUM,
+  CHECK_MICR_ERROR_ACCOUNT,
+  CHECK_MICR_ERROR_CHECK_NUMBER,
+  CHECK_MICR_ERROR_TOO_LONG,
+} CheckMicrStatus;
+
+bool check_micr_routing_is_valid (const char *routing);
+
+CheckMicrStatus check_micr_format_line (char *dst,
+                                        gsize len,
+                                        const char *check_number,
+                                        const char *routing,
+                                        const char *account);
+
+const char *check_micr_status_to_string (CheckMicrStatus status);
+
+void check_micr_get_standard_position (double check_width,
+                                       double check_height,
+                                       FieldProperties *micr);
+
+void check_micr_append_path (cairo_t *cr,
+                             const char *line,
+                             double x_right,
+                             double baseline,
+                             double x_px_per_mm,
+                             double y_px_per_mm);
+
+CheckMicrStatus check_data_set_micr (CheckData *check_data,
+                                     const char *check_number,
+                                     const char *routing,
+                                     const char *account);
+
+#endif /* CHECKWRITER_CHECK_MICR_H_ */
@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include "check-payees.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+/* One line of the mapped file */
+typedef struct check_payee_entry
+{
+  guint32 offset;
+  guint32 length;
+} CheckPayeeEntry;
+
+struct check_payee_directory
+{
+  char *path;
+
+  /* NULL while the file does not exist or is empty */
+  GMappedFile *file;
+  const char *data;
+
+  /* Sorted by check_payee_compare () */
+  CheckPayeeEntry *entries;
+  guint n_entries;
+};
+
+G_DEFINE_QUARK (check-payees-error-quark, check_payees_error)
+
+char *
+check_payee_directory_get_default_path (void)
+{
+  return g_build_filename (g_get_user_data_dir (), "checkwriter", "payees.txt", NULL);
+}
+
+static int
+check_payee_compare_entries (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  const CheckPayeeEntry *entry_a = a;
+  const CheckPayeeEntry *entry_b = b;
+  const char *data = user_data;
+
+  return check_payee_compare (data + entry_a->offset, entry_a->length,
+                              data + entry_b->offset, entry_b->length);
+}
+
+/* Compare only the first `prefix_len` bytes of an entry with `prefix` */
+static inline int
+check_payee_compare_prefix (const CheckPayeeDirectory *directory,
+                            const CheckPayeeEntry *entry,
+                            const char *prefix,
+                            gsize prefix_len)
+{
+  return check_payee_compare (directory->data + entry->offset, MIN (entry->length, prefix_len),
+                              prefix, prefix_len);
+}
+
+static void
+check_payee_directory_index (CheckPayeeDirectory *directory, gsize length)
+{
+  const char *cur = directory->data;
+  const char *end = directory->data + length;
+  GArray *entries = NULL;
+  bool sorted = true;
+
+  /* Names average well over 16 bytes, so this rarely grows */
+  entries = g_array_sized_new (FALSE, FALSE, sizeof (CheckPayeeEntry), (guint) (length / 16) + 1);
+
+  while (cur < end)
+    {
+      const char *eol = memchr (cur, '\n', end - cur);
+      const char *next = eol ? (eol + 1) : end;
+      CheckPayeeEntry entry;
+
+      if (!eol)
+        {
+          eol = end;
+        }
+
+      /* Tolerate DOS line endings */
+      if (eol > cur && eol[-1] == '\r')
+        {
+          --eol;
+        }
+
+      if (eol > cur)
+        {
+          entry.offset = (guint32) (cur - directory->data);
+          entry.length = (guint32) (eol - cur);
+
+          if (sorted && entries->len > 0)
+            {
+              const CheckPayeeEntry *last = &g_array_index (entries, CheckPayeeEntry, entries->len - 1);
+
+              sorted = check_payee_compare_entries (last, &entry, (gpointer) directory->data) <= 0;
+            }
+
+          g_array_append_val (entries, entry);
+        }
+
+      cur = next;
+    }
+
+  if (!sorted)
+    {
+      g_debug ("%s: %s is not sorted, sorting %u payees", __func__, directory->path, entries->len);
+      g_qsort_with_data (entries->data, entries->len, sizeof (CheckPayeeEntry),
+                         check_payee_compare_entries, (gpointer) directory->data);
+    }
+
+  directory->n_entries = entries->len;
+  directory->entries = (CheckPayeeEntry *) g_array_free (entries, FALSE);
+}
+
+CheckPayeeDirectory *
+check_payee_directory_open (const char *path, GError **error)
+{
+  CheckPayeeDirectory *directory = NULL;
+  GError *local_error = NULL;
+  gsize length;
+
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  directory = g_new0 (CheckPayeeDirectory, 1);
+  directory->path = path ? g_strdup (path) : check_payee_directory_get_default_path ();
+  directory->file = g_mapped_file_new (directory->path, FALSE, &local_error);
+
+  if (!directory->file)
+    {
+      /* No directory, no suggestions */
+      if (g_error_matches (local_error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        {
+          g_error_free (local_error);
+          return directory;
+        }
+
+      g_propagate_error (error, local_error);
+      check_payee_directory_free (directory);
+      return NULL;
+    }
+
+  length = g_mapped_file_get_length (directory->file);
+
+  if (length > G_MAXUINT32)
+    {
+      g_set_error (error, CHECK_PAYEES_ERROR, CHECK_PAYEES_ERROR_TOO_LARGE,
+                   "%s: Payee directories are limited to 4 GiB", directory->path);
+      check_payee_directory_free (directory);
+      return NULL;
+    }
+
+  if (length == 0)
+    {
+      g_clear_pointer (&directory->file, g_mapped_file_unref);
+      return directory;
+    }
+
+  directory->data = g_mapped_file_get_contents (directory->file);
+  check_payee_directory_index (directory, length);
+
+  g_debug ("%s: Indexed %u payees from %s", __func__, directory->n_entries, directory->path);
+
+  return directory;
+}
+
+void
+check_payee_directory_free (CheckPayeeDirectory *directory)
+{
+  if (!directory)
+    {
+      return;
+    }
+
+  g_free (directory->entries);
+  g_clear_pointer (&directory->file, g_mapped_file_unref);
+  g_free (directory->path);
+  g_free (directory);
+}
+
+guint
+check_payee_directory_get_n_payees (const CheckPayeeDirectory *directory)
+{
+  g_return_val_if_fail (directory != NULL, 0);
+
+  return directory->n_entries;
+}
+
+/*
+ * Name of payee `index` in sorted order. The name points into the mapped
+ * file and is not NUL terminated; its length is stored in `length`.
+ */
+const char *
+check_payee_directory_get_name (const CheckPayeeDirectory *directory,
+                                guint index,
+                                gsize *length)
+{
+  const CheckPayeeEntry *entry = NULL;
+
+  g_return_val_if_fail (directory != NULL, NULL);
+  g_return_val_if_fail (length != NULL, NULL);
+
+  if (index >= directory->n_entries)
+    {
+      *length = 0;
+      return NULL;
+    }
+
+  entry = &directory->entries[index];
+  *length = entry->length;
+
+  return directory->data + entry->offset;
+}
+
+/*
+ * Find the payees whose names start with `prefix`, ignoring ASCII case.
+ * They are consecutive in sorted order: returns how many there are, and
+ * the index of the first one in `first`.
+ */
+guint
+check_payee_directory_find_prefix (const CheckPayeeDirectory *directory,
+                                   const char *prefix,
+                                   guint *first)
+{
+  gsize prefix_len;
+  guint lo, hi, start;
+
+  g_return_val_if_fail (directory != NULL, 0);
+  g_return_val_if_fail (prefix != NULL, 0);
+  g_return_val_if_fail (first != NULL, 0);
+
+  prefix_len = strlen (prefix);
+
+  /* First entry not before the prefix */
+  lo = 0;
+  hi = directory->n_entries;
+
+  while (lo < hi)
+    {
+      guint mid = lo + ((hi - lo) / 2);
+
+      if (check_payee_compare_prefix (directory, &directory->entries[mid], prefix, prefix_len) < 0)
+        {
+          lo = mid + 1;
+        }
+      else
+        {
+          hi = mid;
+        }
+    }
+
+  start = lo;
+
+  /* First entry past the prefix */
+  hi = directory->n_entries;
+
+  while (lo < hi)
+    {
+      guint mid = lo + ((hi - lo) / 2);
+
+      if (check_payee_compare_prefix (directory, &directory->entries[mid], prefix, prefix_len) <= 0)
+        {
+          lo = mid + 1;
+        }
+      else
+        {
+          hi = mid;
+        }
+    }
+
+  *first = start;
+
+  return lo - start;
+}
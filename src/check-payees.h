@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef CHECKWRITER_CHECK_PAYEES_H_
+#define CHECKWRITER_CHECK_PAYEES_H_
+
+#include <glib.h>
+
+/*
+ * A payee directory is a text file with one payee name per line. The file
+ * is memory mapped and indexed by a sorted array of line references, so
+ * every payee starting with a prefix (ignoring ASCII case) is found with
+ * two binary searches, however large the directory is.
+ *
+ * A file that is already sorted (e.g. with `LC_ALL=C sort -f`) is indexed in
+ * a single pass over its lines; any other file is sorted when opened. Empty
+ * lines are ignored and DOS line endings are accepted.
+ *
+ * The default directory is $XDG_DATA_HOME/checkwriter/payees.txt.
+ */
+
+#define CHECK_PAYEES_ERROR (check_payees_error_quark ())
+
+typedef enum
+{
+  CHECK_PAYEES_ERROR_TOO_LARGE,
+} CheckPayeesError;
+
+typedef struct check_payee_directory CheckPayeeDirectory;
+
+/* Order names like `LC_ALL=C sort -f`: bytes with ASCII letters upper cased */
+static inline int
+check_payee_compare (const char *a, gsize a_len, const char *b, gsize b_len)
+{
+  gsize n = MIN (a_len, b_len);
+
+  for (gsize i = 0; i < n; ++i)
+    {
+      int ca = (guchar) g_ascii_toupper (a[i]);
+      int cb = (guchar) g_ascii_toupper (b[i]);
+
+      if (ca != cb)
+        {
+          return ca - cb;
+        }
+    }
+
+  return (a_len > b_len) - (a_len < b_len);
+}
+
+GQuark check_payees_error_quark (void);
+
+char *check_payee_directory_get_default_path (void);
+
+CheckPayeeDirectory *check_payee_directory_open (const char *path,
+                                                 GError **error);
+
+void check_payee_directory_free (CheckPayeeDirectory *directory);
+
+guint check_payee_directory_get_n_payees (const CheckPayeeDirectory *directory);
+
+const char *check_payee_directory_get_name (const CheckPayeeDirectory *directory,
+                                            guint index,
+                                            gsize *length);
+
+guint check_payee_directory_find_prefix (const CheckPayeeDirectory *directory,
+                                         const char *prefix,
+                                         guint *first);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (CheckPayeeDirectory, check_payee_directory_free)
+
+#endif /* CHECKWRITER_CHECK_PAYEES_H_ */
@@ -0,0 +1,534 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include "check-positive-pay.h"
+#include "check-amount.h"
+#include "check-ledger.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#define POSITIVE_PAY_ACCOUNT_WIDTH (17)
+#define POSITIVE_PAY_NUMBER_WIDTH (10)
+#define POSITIVE_PAY_AMOUNT_WIDTH (12)
+#define POSITIVE_PAY_PAYEE_WIDTH (50)
+#define POSITIVE_PAY_ISSUE_CODE ('I')
+
+#define POSITIVE_PAY_CSV_HEADER ("Account,Check Number,Amount,Issue Date,Payee\r\n")
+
+#define POSITIVE_PAY_BUFFER_SIZE (64 * 1024)
+
+/* Longest line of either layout: a CSV line with every quote doubled */
+#define POSITIVE_PAY_LINE_MAX (6 * STRING_LEN)
+
+G_STATIC_ASSERT (POSITIVE_PAY_LINE_MAX < POSITIVE_PAY_BUFFER_SIZE);
+G_STATIC_ASSERT (POSITIVE_PAY_AMOUNT_WIDTH >= 12); /* CHECK_AMOUNT_MAX_CENTS */
+
+typedef struct positive_pay_writer
+{
+  const char *path;
+  int fd;
+  gsize length;
+  char buffer[POSITIVE_PAY_BUFFER_SIZE];
+} PositivePayWriter;
+
+/* A check of the range, with the digits it is written and matched with */
+typedef struct positive_pay_check
+{
+  const CheckJournalRecord *record;
+  guint32 date;
+  char account[POSITIVE_PAY_ACCOUNT_WIDTH];
+  char number[POSITIVE_PAY_NUMBER_WIDTH + 1]; /* NUL terminated for the ledger */
+  guint8 n_account;
+  guint8 n_number;
+  gboolean superseded; /* By a later entry with the same account and number */
+} PositivePayCheck;
+
+typedef struct positive_pay_export
+{
+  const CheckLedger *ledger;
+  PositivePayWriter *writer; /* NULL while the checks are validated */
+  CheckPositivePayFormat format;
+  guint64 n_checks;
+  GError *error;
+} PositivePayExport;
+
+G_DEFINE_QUARK (check-positive-pay-error-quark, check_positive_pay_error)
+
+/* `.csv` files get the CSV layout, anything else the fixed width one */
+CheckPositivePayFormat
+check_positive_pay_format_from_path (const char *path)
+{
+  const char *ext = path ? strrchr (path, '.') : NULL;
+
+  if (ext && g_ascii_strcasecmp (ext, ".csv") == 0)
+    {
+      return CHECK_POSITIVE_PAY_CSV;
+    }
+
+  return CHECK_POSITIVE_PAY_FIXED;
+}
+
+static gboolean
+positive_pay_writer_flush (PositivePayWriter *writer, GError **error)
+{
+  const char *data = writer->buffer;
+  gsize len = writer->length;
+
+  while (len > 0)
+    {
+      gssize written = write (writer->fd, data, len);
+
+      if (written < 0)
+        {
+          int saved_errno = errno;
+
+          if (saved_errno == EINTR)
+            {
+              continue;
+            }
+
+          g_set_error (error, CHECK_POSITIVE_PAY_ERROR, CHECK_POSITIVE_PAY_ERROR_IO,
+                       "%s: %s", writer->path, g_strerror (saved_errno));
+          return FALSE;
+        }
+
+      data += written;
+      len -= written;
+    }
+
+  writer->length = 0;
+
+  return TRUE;
+}
+
+/* Room for one line at the end of the buffer, flushing it when full */
+static char *
+positive_pay_writer_reserve (PositivePayWriter *writer, GError **error)
+{
+  if (writer->length + POSITIVE_PAY_LINE_MAX > POSITIVE_PAY_BUFFER_SIZE
+      && !positive_pay_writer_flush (writer, error))
+    {
+      return NULL;
+    }
+
+  return writer->buffer + writer->length;
+}
+
+/*
+ * Copy the digits of `src` to `dst`, skipping the characters of `skip` and
+ * leading zeros. Returns the number of digits, or -1 on any other character
+ * or when there are more than `width`.
+ */
+static int
+positive_pay_copy_digits (char *dst,
+                          const char *src,
+                          gsize length,
+                          const char *skip,
+                          int width)
+{
+  int n = 0;
+
+  for (gsize i = 0; i < length; ++i)
+    {
+      if (g_ascii_isdigit (src[i]))
+        {
+          if (n == 0 && src[i] == '0')
+            {
+              continue;
+            }
+
+          if (n == width)
+            {
+              return -1;
+            }
+
+          dst[n++] = src[i];
+        }
+      else if (!strchr (skip, src[i]))
+        {
+          return -1;
+        }
+    }
+
+  return n;
+}
+
+/* Right align `n` digits in a zero filled field of `width` */
+static char *
+positive_pay_put_number (char *cur, const char *digits, int n, int width)
+{
+  memset (cur, '0', width - n);
+  memcpy (cur + width - n, digits, n);
+
+  return cur + width;
+}
+
+/*
+ * Write the payee in ASCII: each other character, however many bytes it
+ * takes in UTF-8, becomes one '?', and control characters become spaces.
+ * Returns the number of characters, which stops at `width`.
+ */
+static int
+positive_pay_put_payee (char *dst, const char *payee, gsize length, int width, bool csv)
+{
+  char *cur = dst;
+  int n = 0;
+
+  for (gsize i = 0; i < length && n < width; ++i)
+    {
+      guchar c = payee[i];
+
+      if ((c & 0xc0) == 0x80)
+        {
+          continue; /* UTF-8 continuation byte */
+        }
+
+      if (c >= 0x80)
+        {
+          c = '?';
+        }
+      else if (c < 0x20 || c == 0x7f)
+        {
+          c = ' ';
+        }
+
+      if (csv && c == '"')
+        {
+          *cur++ = '"';
+        }
+
+      *cur++ = c;
+      ++n;
+    }
+
+  return (int) (cur - dst);
+}
+
+static gboolean
+positive_pay_fail (PositivePayExport *export,
+                   const CheckJournalRecord *record,
+                   const char *reason)
+{
+  char check_number[STRING_LEN];
+
+  check_journal_record_get_string (record, CHECK_JOURNAL_CHECK_NUMBER, check_number, STRING_LEN);
+  g_set_error (&export->error, CHECK_POSITIVE_PAY_ERROR, CHECK_POSITIVE_PAY_ERROR_CHECK,
+               "Check \"%s\" (entry %" G_GUINT64_FORMAT " of the journal): %s",
+               check_number, record->sequence + 1, reason);
+
+  return FALSE;
+}
+
+/* The digits and date of `record`, or FALSE if the layout cannot hold it */
+static gboolean
+positive_pay_parse_check (PositivePayExport *export,
+                          const CheckJournalRecord *record,
+                          PositivePayCheck *check)
+{
+  int n_account, n_number;
+
+  n_account = positive_pay_copy_digits (check->account, record->strings[CHECK_JOURNAL_ACCOUNT],
+                                        record->lengths[CHECK_JOURNAL_ACCOUNT], " -",
+                                        POSITIVE_PAY_ACCOUNT_WIDTH);
+  n_number = positive_pay_copy_digits (check->number, record->strings[CHECK_JOURNAL_CHECK_NUMBER],
+                                       record->lengths[CHECK_JOURNAL_CHECK_NUMBER], "",
+                                       POSITIVE_PAY_NUMBER_WIDTH);
+
+  if (n_account <= 0)
+    {
+      return positive_pay_fail (export, record, "No account number, or one the bank cannot read");
+    }
+
+  if (n_number <= 0)
+    {
+      return positive_pay_fail (export, record, "The check number is not a number of up to 10 digits");
+    }
+
+  if (record->cents < 0)
+    {
+      return positive_pay_fail (export, record, "The amount was not valid when printed");
+    }
+
+  check->date = check_ledger_parse_date (record->strings[CHECK_JOURNAL_DATE], record->lengths[CHECK_JOURNAL_DATE]);
+
+  if (check->date == 0)
+    {
+      return positive_pay_fail (export, record, "The date is not MM/DD/YYYY or YYYY-MM-DD");
+    }
+
+  check->record = record;
+  check->number[n_number] = '\0';
+  check->n_account = (guint8) n_account;
+  check->n_number = (guint8) n_number;
+  check->superseded = FALSE;
+
+  return TRUE;
+}
+
+/* First pass: every check of the range can be written */
+static gboolean
+positive_pay_validate_record (const CheckJournalRecord *record, gpointer user_data)
+{
+  PositivePayCheck check;
+
+  return positive_pay_parse_check (user_data, record, &check);
+}
+
+/* Stop at a later entry with the number and account of `user_data` */
+static gboolean
+positive_pay_find_reprint (const CheckJournalRecord *record, gpointer user_data)
+{
+  PositivePayCheck *check = user_data;
+  char account[POSITIVE_PAY_ACCOUNT_WIDTH];
+  int n_account;
+
+  if (record->sequence <= check->record->sequence)
+    {
+      return TRUE;
+    }
+
+  n_account = positive_pay_copy_digits (account, record->strings[CHECK_JOURNAL_ACCOUNT],
+                                        record->lengths[CHECK_JOURNAL_ACCOUNT], " -",
+                                        POSITIVE_PAY_ACCOUNT_WIDTH);
+  check->superseded = (n_account == check->n_account && memcmp (account, check->account, n_account) == 0);
+
+  return !check->superseded;
+}
+
+static gboolean
+positive_pay_write_check (PositivePayExport *export, const PositivePayCheck *check)
+{
+  const CheckJournalRecord *record = check->record;
+  guint32 date = check->date;
+  char amount[32];
+  char *line, *cur;
+  int n;
+
+  line = positive_pay_writer_reserve (export->writer, &export->error);
+
+  if (!line)
+    {
+      return FALSE;
+    }
+
+  cur = line;
+
+  switch (export->format)
+    {
+    case CHECK_POSITIVE_PAY_FIXED:
+      cur = positive_pay_put_number (cur, check->account, check->n_account, POSITIVE_PAY_ACCOUNT_WIDTH);
+      cur = positive_pay_put_number (cur, check->number, check->n_number, POSITIVE_PAY_NUMBER_WIDTH);
+      cur += g_snprintf (cur, POSITIVE_PAY_AMOUNT_WIDTH + 1, "%0*" G_GINT64_FORMAT,
+                         POSITIVE_PAY_AMOUNT_WIDTH, record->cents);
+      cur += g_snprintf (cur, 9, "%02u%02u%04u", (date / 100) % 100, date % 100, date / 10000);
+      *cur++ = POSITIVE_PAY_ISSUE_CODE;
+
+      n = positive_pay_put_payee (cur, record->strings[CHECK_JOURNAL_PAYEE],
+                                  record->lengths[CHECK_JOURNAL_PAYEE], POSITIVE_PAY_PAYEE_WIDTH, false);
+      memset (cur + n, ' ', POSITIVE_PAY_PAYEE_WIDTH - n);
+      cur += POSITIVE_PAY_PAYEE_WIDTH;
+      break;
+
+    case CHECK_POSITIVE_PAY_CSV:
+      memcpy (cur, check->account, check->n_account);
+      cur += check->n_account;
+      *cur++ = ',';
+      memcpy (cur, check->number, check->n_number);
+      cur += check->n_number;
+      *cur++ = ',';
+
+      /* "1,234.56" as on the check, without the separators */
+      check_amount_format (amount, sizeof (amount), record->cents);
+
+      for (const char *src = amount; *src; ++src)
+        {
+          if (*src != ',')
+            {
+              *cur++ = *src;
+            }
+        }
+
+      cur += g_snprintf (cur, 13, ",%02u/%02u/%04u,", (date / 100) % 100, date % 100, date / 10000);
+      *cur++ = '"';
+      cur += positive_pay_put_payee (cur, record->strings[CHECK_JOURNAL_PAYEE],
+                                     record->lengths[CHECK_JOURNAL_PAYEE], STRING_LEN, true);
+      *cur++ = '"';
+      break;
+
+    default:
+      g_assert_not_reached ();
+    }
+
+  *cur++ = '\r';
+  *cur++ = '\n';
+
+  export->writer->length += cur - line;
+
+  return TRUE;
+}
+
+/*
+ * Second pass: write each check of the range, unless it was printed again,
+ * say after a misprint. Only the latest entry of a check is issued, and the
+ * ledger finds it by number whatever its date.
+ */
+static gboolean
+positive_pay_write_record (const CheckJournalRecord *record, gpointer user_data)
+{
+  PositivePayExport *export = user_data;
+  PositivePayCheck check;
+
+  if (!positive_pay_parse_check (export, record, &check))
+    {
+      return FALSE;
+    }
+
+  check_ledger_find_number (export->ledger, check.number, check.number, positive_pay_find_reprint, &check);
+
+  if (check.superseded)
+    {
+      return TRUE;
+    }
+
+  ++export->n_checks;
+
+  return positive_pay_write_check (export, &check);
+}
+
+/*
+ * Write the checks of the journal at `journal_path` dated from `first_date`
+ * to `last_date`, either of which may be NULL, to `path`. Dates are parsed
+ * with check_ledger_parse_date (). `n_checks`, when not NULL, receives the
+ * number of checks written.
+ */
+gboolean
+check_positive_pay_export (const char *journal_path,
+                           const char *path,
+                           CheckPositivePayFormat format,
+                           const char *first_date,
+                           const char *last_date,
+                           guint64 *n_checks,
+                           GError **error)
+{
+  g_autofree PositivePayWriter *writer = NULL;
+  g_autoptr (CheckLedger) ledger = NULL;
+  PositivePayExport export = { 0 };
+  const char *invalid_date = NULL;
+  gboolean ok = TRUE;
+
+  g_return_val_if_fail (journal_path != NULL, FALSE);
+  g_return_val_if_fail (path != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (first_date && check_ledger_parse_date (first_date, strlen (first_date)) == 0)
+    {
+      invalid_date = first_date;
+    }
+  else if (last_date && check_ledger_parse_date (last_date, strlen (last_date)) == 0)
+    {
+      invalid_date = last_date;
+    }
+
+  if (invalid_date)
+    {
+      g_set_error (error, CHECK_POSITIVE_PAY_ERROR, CHECK_POSITIVE_PAY_ERROR_CHECK,
+                   "Invalid date \"%s\" (expected MM/DD/YYYY or YYYY-MM-DD)", invalid_date);
+      return FALSE;
+    }
+
+  ledger = check_ledger_open (journal_path, error);
+
+  if (!ledger)
+    {
+      return FALSE;
+    }
+
+  export.ledger = ledger;
+  export.format = format;
+
+  /* Read the range twice rather than keep it, so a large day takes no more memory */
+  check_ledger_find_date (ledger, first_date, last_date, positive_pay_validate_record, &export);
+
+  if (export.error)
+    {
+      g_propagate_error (error, g_steal_pointer (&export.error));
+      return FALSE;
+    }
+
+  writer = g_new (PositivePayWriter, 1);
+  writer->path = path;
+  writer->length = 0;
+  writer->fd = g_open (path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+  if (writer->fd < 0)
+    {
+      int saved_errno = errno;
+
+      g_set_error (error, CHECK_POSITIVE_PAY_ERROR, CHECK_POSITIVE_PAY_ERROR_IO,
+                   "%s: %s", path, g_strerror (saved_errno));
+      return FALSE;
+    }
+
+  export.writer = writer;
+
+  if (format == CHECK_POSITIVE_PAY_CSV)
+    {
+      writer->length = strlen (POSITIVE_PAY_CSV_HEADER);
+      memcpy (writer->buffer, POSITIVE_PAY_CSV_HEADER, writer->length);
+    }
+
+  check_ledger_find_date (ledger, first_date, last_date, positive_pay_write_record, &export);
+
+  if (export.error)
+    {
+      g_propagate_error (error, g_steal_pointer (&export.error));
+      ok = FALSE;
+    }
+
+  ok = ok && positive_pay_writer_flush (writer, error);
+
+  if (close (writer->fd) < 0 && ok)
+    {
+      int saved_errno = errno;
+
+      g_set_error (error, CHECK_POSITIVE_PAY_ERROR, CHECK_POSITIVE_PAY_ERROR_IO,
+                   "%s: %s", path, g_strerror (saved_errno));
+      ok = FALSE;
+    }
+
+  if (!ok)
+    {
+      g_unlink (path);
+      return FALSE;
+    }
+
+  if (n_checks)
+    {
+      *n_checks = export.n_checks;
+    }
+
+  return TRUE;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef CHECKWRITER_CHECK_POSITIVE_PAY_H_
+#define CHECKWRITER_CHECK_POSITIVE_PAY_H_
+
+#include "check-journal.h"
+
+#include <glib.h>
+
+/*
+ * Positive Pay issue files, listing the checks of the journal (see
+ * check-journal.h) dated within a range, for the bank to match against the
+ * checks presented for payment. Two common layouts are written, one line per
+ * check, ending in CR LF:
+ *
+ *   fixed  account number   17  digits, right aligned and zero filled
+ *          check number     10  digits, right aligned and zero filled
+ *          amount           12  cents, right aligned and zero filled
+ *          issue date        8  MMDDYYYY
+ *          issue code        1  'I', issued
+ *          payee            50  left aligned and space filled, cut to fit
+ *
+ *   CSV    Account,Check Number,Amount,Issue Date,Payee, with a header line.
+ *          The amount is written like CheckData.amount without thousands
+ *          separators ("1234.56"), the date as MM/DD/YYYY and the payee
+ *          always quoted.
+ *
+ * Spaces and dashes are dropped from account numbers. Payees are written in
+ * ASCII, other characters become '?'. Checks are found through the date
+ * index of the ledger (see check-ledger.h) and written by date, then in
+ * journal order. A check number journaled more than once for an account,
+ * as when a misprinted check is printed again, is written once, from its
+ * latest entry, and not at all when that entry is dated outside the range.
+ * A check that cannot be written in the layout, say without an account
+ * number, fails the export before the file is created.
+ *
+ * The range is read twice, once to validate it and once to write it, and
+ * each check asks the number index for a later entry, so an export takes
+ * the same memory however many checks it writes.
+ */
+
+#define CHECK_POSITIVE_PAY_ERROR (check_positive_pay_error_quark ())
+
+typedef enum
+{
+  CHECK_POSITIVE_PAY_ERROR_IO,
+  CHECK_POSITIVE_PAY_ERROR_CHECK,
+} CheckPositivePayError;
+
+typedef enum
+{
+  CHECK_POSITIVE_PAY_FIXED,
+  CHECK_POSITIVE_PAY_CSV,
+} CheckPositivePayFormat;
+
+GQuark check_positive_pay_error_quark (void);
+
+CheckPositivePayFormat check_positive_pay_format_from_path (const char *path);
+
+gboolean check_positive_pay_export (const char *journal_path,
+                                    const char *path,
+                                    CheckPositivePayFormat format,
+                                    const char *first_date,
+                                    const char *last_date,
+                                    guint64 *n_checks,
+                                    GError **error);
+
+#endif /* CHECKWRITER_CHECK_POSITIVE_PAY_H_ */
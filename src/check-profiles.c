@@ -0,0 +1,371 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include "check-profiles.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define PROFILE_FILE_MAGIC ("CWPROF1")
+#define PROFILE_FILE_VERSION (1)
+#define PROFILE_FONT_LEN (64)
+
+typedef struct profile_file_header
+{
+  char magic[8]; /* PROFILE_FILE_MAGIC, NUL terminated */
+  guint32 version;
+  guint32 record_size;
+  guint32 n_records;
+  guint32 reserved;
+} ProfileFileHeader;
+
+/* One layout on disk; all lengths are in millimeters like CheckProperties */
+typedef struct profile_file_record
+{
+  char name[CHECK_PROFILE_NAME_LEN];
+  char check_font[PROFILE_FONT_LEN];
+  gint32 check_font_height;
+  guint32 words_locale; /* NumWordsLocale, 0 (en_US) in older files */
+
+  double width;
+  double height;
+  double x_pad;
+  double y_pad;
+
+  FieldProperties date;
+  FieldProperties payee;
+  FieldProperties amount;
+  FieldProperties amount_in_words;
+  FieldProperties memo;
+  FieldProperties micr;
+} ProfileFileRecord;
+
+/* Records start right after the header and stay 8-byte aligned */
+G_STATIC_ASSERT (sizeof (ProfileFileHeader) % 8 == 0);
+G_STATIC_ASSERT (sizeof (ProfileFileRecord) % 8 == 0);
+
+struct check_profile_store
+{
+  char *path;
+
+  /* NULL while the file does not exist yet */
+  GMappedFile *file;
+  const ProfileFileRecord *records;
+  guint n_records;
+
+  /* Profile name -> index + 1 */
+  GHashTable *index;
+};
+
+G_DEFINE_QUARK (check-profiles-error-quark, check_profiles_error)
+
+char *
+check_profile_store_get_default_path (void)
+{
+  return g_build_filename (g_get_user_data_dir (), "checkwriter", "profiles.bin", NULL);
+}
+
+static void
+check_profile_store_unmap (CheckProfileStore *store)
+{
+  g_hash_table_remove_all (store->index);
+  g_clear_pointer (&store->file, g_mapped_file_unref);
+  store->records = NULL;
+  store->n_records = 0;
+}
+
+static gboolean
+check_profile_store_map (CheckProfileStore *store, GError **error)
+{
+  const ProfileFileHeader *header = NULL;
+  GError *local_error = NULL;
+  const char *data = NULL;
+  gsize length;
+
+  check_profile_store_unmap (store);
+
+  store->file = g_mapped_file_new (store->path, FALSE, &local_error);
+
+  if (!store->file)
+    {
+      /* No profiles saved yet */
+      if (g_error_matches (local_error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        {
+          g_error_free (local_error);
+          return TRUE;
+        }
+
+      g_propagate_error (error, local_error);
+      return FALSE;
+    }
+
+  data = g_mapped_file_get_contents (store->file);
+  length = g_mapped_file_get_length (store->file);
+  header = (const ProfileFileHeader *) data;
+
+  if (length < sizeof (ProfileFileHeader)
+      || memcmp (header->magic, PROFILE_FILE_MAGIC, sizeof (header->magic)) != 0
+      || header->version != PROFILE_FILE_VERSION
+      || header->record_size != sizeof (ProfileFileRecord)
+      || header->n_records > ((length - sizeof (ProfileFileHeader)) / sizeof (ProfileFileRecord)))
+    {
+      g_set_error (error, CHECK_PROFILES_ERROR, CHECK_PROFILES_ERROR_FORMAT,
+                   "%s: Not a check profile file, or an unsupported version", store->path);
+      check_profile_store_unmap (store);
+      return FALSE;
+    }
+
+  store->records = (const ProfileFileRecord *) (data + sizeof (ProfileFileHeader));
+  store->n_records = header->n_records;
+
+  for (guint i = 0; i < store->n_records; ++i)
+    {
+      const ProfileFileRecord *record = &store->records[i];
+
+      if (!memchr (record->name, '\0', sizeof (record->name))
+          || !memchr (record->check_font, '\0', sizeof (record->check_font))
+          || record->words_locale >= NUM_WORDS_N_LOCALES)
+        {
+          g_set_error (error, CHECK_PROFILES_ERROR, CHECK_PROFILES_ERROR_FORMAT,
+                       "%s: Profile %u is corrupt", store->path, i);
+          check_profile_store_unmap (store);
+          return FALSE;
+        }
+
+      g_hash_table_insert (store->index, (gpointer) record->name, GUINT_TO_POINTER (i + 1));
+    }
+
+  g_debug ("%s: Mapped %u profiles from %s", __func__, store->n_records, store->path);
+
+  return TRUE;
+}
+
+CheckProfileStore *
+check_profile_store_open (const char *path, GError **error)
+{
+  CheckProfileStore *store = NULL;
+
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  store = g_new0 (CheckProfileStore, 1);
+  store->path = path ? g_strdup (path) : check_profile_store_get_default_path ();
+  store->index = g_hash_table_new (g_str_hash, g_str_equal);
+
+  if (!check_profile_store_map (store, error))
+    {
+      check_profile_store_free (store);
+      return NULL;
+    }
+
+  return store;
+}
+
+void
+check_profile_store_free (CheckProfileStore *store)
+{
+  if (!store)
+    {
+      return;
+    }
+
+  check_profile_store_unmap (store);
+  g_hash_table_unref (store->index);
+  g_free (store->path);
+  g_free (store);
+}
+
+guint
+check_profile_store_get_n_profiles (const CheckProfileStore *store)
+{
+  g_return_val_if_fail (store != NULL, 0);
+
+  return store->n_records;
+}
+
+const char *
+check_profile_store_get_name (const CheckProfileStore *store, guint index)
+{
+  g_return_val_if_fail (store != NULL, NULL);
+
+  if (index >= store->n_records)
+    {
+      return NULL;
+    }
+
+  return store->records[index].name;
+}
+
+/* Index of the profile called `name`, or -1 */
+int
+check_profile_store_lookup (const CheckProfileStore *store, const char *name)
+{
+  g_return_val_if_fail (store != NULL, -1);
+
+  if (!name)
+    {
+      return -1;
+    }
+
+  return GPOINTER_TO_INT (g_hash_table_lookup (store->index, name)) - 1;
+}
+
+bool
+check_profile_store_get (const CheckProfileStore *store,
+                         guint index,
+                         CheckProperties *p)
+{
+  const ProfileFileRecord *record = NULL;
+
+  g_return_val_if_fail (store != NULL, false);
+  g_return_val_if_fail (p != NULL, false);
+
+  if (index >= store->n_records)
+    {
+      return false;
+    }
+
+  record = &store->records[index];
+
+  memset (p, 0, sizeof (CheckProperties));
+  g_strlcpy (p->check_font, record->check_font, STRING_LEN);
+  p->check_font_height = record->check_font_height;
+  p->words_locale = (NumWordsLocale) record->words_locale;
+
+  p->width = record->width;
+  p->height = record->height;
+  p->x_pad = record->x_pad;
+  p->y_pad = record->y_pad;
+
+  p->date = record->date;
+  p->name = record->payee;
+  p->amount = record->amount;
+  p->amount_in_words = record->amount_in_words;
+  p->memo = record->memo;
+  p->micr = record->micr;
+
+  p->magic = CHECK_PROPERTIES_MAGIC;
+
+  return true;
+}
+
+static void
+check_profile_record_encode (ProfileFileRecord *record,
+                             const char *name,
+                             const CheckProperties *p)
+{
+  memset (record, 0, sizeof (ProfileFileRecord));
+  g_strlcpy (record->name, name, sizeof (record->name));
+  g_strlcpy (record->check_font, p->check_font, sizeof (record->check_font));
+  record->check_font_height = p->check_font_height;
+  record->words_locale = p->words_locale;
+
+  record->width = p->width;
+  record->height = p->height;
+  record->x_pad = p->x_pad;
+  record->y_pad = p->y_pad;
+
+  record->date = p->date;
+  record->payee = p->name;
+  record->amount = p->amount;
+  record->amount_in_words = p->amount_in_words;
+  record->memo = p->memo;
+  record->micr = p->micr;
+}
+
+/*
+ * Add a profile, or replace the one with the same name. The whole file is
+ * rewritten atomically and mapped again, so names and indexes returned
+ * earlier are no longer valid.
+ */
+gboolean
+check_profile_store_put (CheckProfileStore *store,
+                         const char *name,
+                         const CheckProperties *p,
+                         GError **error)
+{
+  g_autofree char *dir = NULL;
+  g_autofree char *contents = NULL;
+  ProfileFileHeader *header = NULL;
+  ProfileFileRecord *records = NULL;
+  guint n_records;
+  gsize length;
+  int index;
+
+  g_return_val_if_fail (store != NULL, FALSE);
+  g_return_val_if_fail (p != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (!name || name[0] == '\0' || strlen (name) >= CHECK_PROFILE_NAME_LEN)
+    {
+      g_set_error (error, CHECK_PROFILES_ERROR, CHECK_PROFILES_ERROR_NAME,
+                   "Profile names must have 1 to %d bytes", CHECK_PROFILE_NAME_LEN - 1);
+      return FALSE;
+    }
+
+  if (strlen (p->check_font) >= PROFILE_FONT_LEN)
+    {
+      g_set_error (error, CHECK_PROFILES_ERROR, CHECK_PROFILES_ERROR_FORMAT,
+                   "Font names in profiles are limited to %d bytes", PROFILE_FONT_LEN - 1);
+      return FALSE;
+    }
+
+  index = check_profile_store_lookup (store, name);
+  n_records = store->n_records + (index < 0 ? 1 : 0);
+  length = sizeof (ProfileFileHeader) + (n_records * sizeof (ProfileFileRecord));
+
+  contents = g_malloc0 (length);
+  header = (ProfileFileHeader *) contents;
+  records = (ProfileFileRecord *) (contents + sizeof (ProfileFileHeader));
+
+  memcpy (header->magic, PROFILE_FILE_MAGIC, sizeof (header->magic));
+  header->version = PROFILE_FILE_VERSION;
+  header->record_size = sizeof (ProfileFileRecord);
+  header->n_records = n_records;
+
+  if (store->n_records > 0)
+    {
+      memcpy (records, store->records, store->n_records * sizeof (ProfileFileRecord));
+    }
+
+  check_profile_record_encode (&records[index < 0 ? store->n_records : (guint) index], name, p);
+
+  dir = g_path_get_dirname (store->path);
+
+  if (g_mkdir_with_parents (dir, 0700) < 0)
+    {
+      int saved_errno = errno;
+
+      g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (saved_errno),
+                   "%s: %s", dir, g_strerror (saved_errno));
+      return FALSE;
+    }
+
+  /* Unmap first, the file is replaced underneath */
+  check_profile_store_unmap (store);
+
+  if (!g_file_set_contents (store->path, contents, length, error))
+    {
+      check_profile_store_map (store, NULL);
+      return FALSE;
+    }
+
+  return check_profile_store_map (store, error);
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef CHECKWRITER_CHECK_PROFILES_H_
+#define CHECKWRITER_CHECK_PROFILES_H_
+
+#include "check-properties.h"
+
+#include <glib.h>
+
+/*
+ * A profile store keeps any number of named layouts, one per check stock,
+ * in a single binary file that is memory mapped when opened. The file is a
+ * small header followed by fixed size records, so a profile is found by
+ * index (or by name through a hash table built when the file is opened) and
+ * decoded with a single copy.
+ *
+ * The default store lives in $XDG_DATA_HOME/checkwriter/profiles.bin. The
+ * file uses the host's byte order and is not meant to be shared between
+ * machines.
+ */
+
+#define CHECK_PROFILE_NAME_LEN (64)
+
+#define CHECK_PROFILES_ERROR (check_profiles_error_quark ())
+
+typedef enum
+{
+  CHECK_PROFILES_ERROR_FORMAT,
+  CHECK_PROFILES_ERROR_NOT_FOUND,
+  CHECK_PROFILES_ERROR_NAME,
+} CheckProfilesError;
+
+typedef struct check_profile_store CheckProfileStore;
+
+GQuark check_profiles_error_quark (void);
+
+char *check_profile_store_get_default_path (void);
+
+CheckProfileStore *check_profile_store_open (const char *path,
+                                             GError **error);
+
+void check_profile_store_free (CheckProfileStore *store);
+
+guint check_profile_store_get_n_profiles (const CheckProfileStore *store);
+
+const char *check_profile_store_get_name (const CheckProfileStore *store,
+                                          guint index);
+
+int check_profile_store_lookup (const CheckProfileStore *store,
+                                const char *name);
+
+bool check_profile_store_get (const CheckProfileStore *store,
+                              guint index,
+                              CheckProperties *p);
+
+gboolean check_profile_store_put (CheckProfileStore *store,
+                                  const char *name,
+                                  const CheckProperties *p,
+                                  GError **error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (CheckProfileStore, check_profile_store_free)
+
+#endif /* CHECKWRITER_CHECK_PROFILES_H_ */
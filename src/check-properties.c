@@ -20,18 +20,19 @@
 #include "config.h"
 
 #include "check-properties.h"
+#include "check-amount.h"
+#include "check-micr.h"
 
 #define CHECKWRITER_GSETTINGS_URI (PACKAGE_URI)
 
 #include <math.h>
+#include <stdio.h>
 #include <string.h>
 
 #define ENABLE_SCALING(flags) ((flags) & 0x02)
 #define ENABLE_LINES(flags) ((flags) & 0x01)
 #define PATTERN_SIZE 4 /* Width and height of the tile */
 
-static volatile guint CHECK_PROPERTIES_CHANGED = 0;
-
 static bool
 check_properties_initialized (const CheckProperties *p)
 {
@@ -45,147 +46,471 @@ check_properties_initialized (const CheckProperties *p)
     }
 }
 
+/* Keys of all millimeter valued properties, shared by GSettings and layout files */
+static const struct
+{
+  const char *key;
+  gsize offset;
+} CHECK_PROPERTIES_MM_KEYS[] = {
+  { "check-width-mm", G_STRUCT_OFFSET (CheckProperties, width) },
+  { "check-height-mm", G_STRUCT_OFFSET (CheckProperties, height) },
+  { "check-pad-x-mm", G_STRUCT_OFFSET (CheckProperties, x_pad) },
+  { "check-pad-y-mm", G_STRUCT_OFFSET (CheckProperties, y_pad) },
+  { "check-date-pos-x-mm", G_STRUCT_OFFSET (CheckProperties, date.x_pos) },
+  { "check-date-pos-y-mm", G_STRUCT_OFFSET (CheckProperties, date.y_pos) },
+  { "check-date-width-mm", G_STRUCT_OFFSET (CheckProperties, date.width) },
+  { "check-name-pos-x-mm", G_STRUCT_OFFSET (CheckProperties, name.x_pos) },
+  { "check-name-pos-y-mm", G_STRUCT_OFFSET (CheckProperties, name.y_pos) },
+  { "check-name-width-mm", G_STRUCT_OFFSET (CheckProperties, name.width) },
+  { "check-amount-pos-x-mm", G_STRUCT_OFFSET (CheckProperties, amount.x_pos) },
+  { "check-amount-pos-y-mm", G_STRUCT_OFFSET (CheckProperties, amount.y_pos) },
+  { "check-amount-width-mm", G_STRUCT_OFFSET (CheckProperties, amount.width) },
+  { "check-amount-in-words-pos-x-mm", G_STRUCT_OFFSET (CheckProperties, amount_in_words.x_pos) },
+  { "check-amount-in-words-pos-y-mm", G_STRUCT_OFFSET (CheckProperties, amount_in_words.y_pos) },
+  { "check-amount-in-words-width-mm", G_STRUCT_OFFSET (CheckProperties, amount_in_words.width) },
+  { "check-memo-pos-x-mm", G_STRUCT_OFFSET (CheckProperties, memo.x_pos) },
+  { "check-memo-pos-y-mm", G_STRUCT_OFFSET (CheckProperties, memo.y_pos) },
+  { "check-memo-width-mm", G_STRUCT_OFFSET (CheckProperties, memo.width) },
+  { "check-micr-pos-x-mm", G_STRUCT_OFFSET (CheckProperties, micr.x_pos) },
+  { "check-micr-pos-y-mm", G_STRUCT_OFFSET (CheckProperties, micr.y_pos) },
+  { "check-micr-width-mm", G_STRUCT_OFFSET (CheckProperties, micr.width) },
+};
+
+/**
+ * Layout snapshots
+ *
+ * A CheckLayout is never modified after check_layout_new () returns it, so
+ * any number of windows and render threads can hold a reference to the same
+ * one. Every snapshot gets a new version, which consumers compare to find
+ * out whether they are still current.
+ */
+
+static guint CHECK_LAYOUT_VERSION = 0;
+
+const CheckLayout *
+check_layout_new (const CheckProperties *p)
+{
+  CheckLayout *layout = NULL;
+
+  g_return_val_if_fail (p != NULL, NULL);
+
+  layout = g_atomic_rc_box_new0 (CheckLayout);
+  layout->version = (guint) g_atomic_int_add (&CHECK_LAYOUT_VERSION, 1) + 1;
+  memcpy (&layout->properties, p, sizeof (CheckProperties));
+
+  return layout;
+}
+
+const CheckLayout *
+check_layout_ref (const CheckLayout *layout)
+{
+  g_return_val_if_fail (layout != NULL, NULL);
+
+  return g_atomic_rc_box_acquire ((gpointer) layout);
+}
+
+void
+check_layout_unref (const CheckLayout *layout)
+{
+  if (layout)
+    {
+      g_atomic_rc_box_release ((gpointer) layout);
+    }
+}
+
+/**
+ * Settings
+ *
+ * One GSettings object is kept for the life of the process. The properties
+ * are read from it once into a layout snapshot. Its "changed" signal then
+ * derives a new snapshot with just that key re-read and swaps it in, so
+ * loading the layout never goes back to dconf. The settings object itself
+ * is only used from the main thread; the current snapshot may be taken from
+ * any thread.
+ */
+
+static GSettings *CHECK_SETTINGS = NULL;
+static const CheckLayout *CHECK_SETTINGS_LAYOUT = NULL;
+
+G_LOCK_DEFINE_STATIC (CHECK_SETTINGS_LAYOUT);
+
+/* Copy one key into `p`; returns false for keys that are not properties */
+static bool
+check_properties_read_key (GSettings *settings,
+                           const char *key,
+                           CheckProperties *p)
+{
+  if (strcmp (key, "check-font") == 0)
+    {
+      g_autofree char *font = g_settings_get_string (settings, key);
+
+      g_strlcpy (p->check_font, font, STRING_LEN);
+      return true;
+    }
+
+  if (strcmp (key, "check-font-height") == 0)
+    {
+      p->check_font_height = g_settings_get_int (settings, key);
+      return true;
+    }
+
+  if (strcmp (key, "check-amount-in-words-locale") == 0)
+    {
+      g_autofree char *name = g_settings_get_string (settings, key);
+
+      if (!num_words_locale_from_name (name, &p->words_locale))
+        {
+          p->words_locale = NUM_WORDS_EN_US;
+        }
+
+      return true;
+    }
+
+  for (gsize i = 0; i < G_N_ELEMENTS (CHECK_PROPERTIES_MM_KEYS); ++i)
+    {
+      if (strcmp (key, CHECK_PROPERTIES_MM_KEYS[i].key) == 0)
+        {
+          double *field = G_STRUCT_MEMBER_P (p, CHECK_PROPERTIES_MM_KEYS[i].offset);
+
+          *field = g_settings_get_double (settings, key);
+          return true;
+        }
+    }
+
+  return false;
+}
+
+/* Publish a new current layout, taking ownership of `layout` */
+static void
+check_properties_set_current_layout (const CheckLayout *layout)
+{
+  const CheckLayout *old_layout = NULL;
+
+  G_LOCK (CHECK_SETTINGS_LAYOUT);
+  old_layout = CHECK_SETTINGS_LAYOUT;
+  CHECK_SETTINGS_LAYOUT = layout;
+  G_UNLOCK (CHECK_SETTINGS_LAYOUT);
+
+  check_layout_unref (old_layout);
+}
+
+static void
+check_properties_on_settings_changed (GSettings *settings,
+                                      const char *key,
+                                      gpointer user_data)
+{
+  const CheckLayout *current = check_layout_get_current ();
+  CheckProperties p;
+
+  (void) user_data;
+
+  memcpy (&p, &current->properties, sizeof (CheckProperties));
+  check_layout_unref (current);
+
+  if (check_properties_read_key (settings, key, &p))
+    {
+      const CheckLayout *layout = check_layout_new (&p);
+
+      g_debug ("%s: Updated \"%s\", layout version %u", __func__, key, layout->version);
+      check_properties_set_current_layout (layout);
+    }
+}
+
+/*
+ * The process-wide settings object. Connect to its "changed" signal to
+ * follow layout changes; by the time handlers run, check_layout_get_current ()
+ * already returns the new layout.
+ */
+GSettings *
+check_properties_get_settings (void)
+{
+  if (!CHECK_SETTINGS)
+    {
+      CheckProperties p;
+
+      CHECK_SETTINGS = g_settings_new (CHECKWRITER_GSETTINGS_URI);
+
+      memset (&p, 0, sizeof (CheckProperties));
+      check_properties_read_key (CHECK_SETTINGS, "check-font", &p);
+      check_properties_read_key (CHECK_SETTINGS, "check-font-height", &p);
+      check_properties_read_key (CHECK_SETTINGS, "check-amount-in-words-locale", &p);
+
+      for (gsize i = 0; i < G_N_ELEMENTS (CHECK_PROPERTIES_MM_KEYS); ++i)
+        {
+          check_properties_read_key (CHECK_SETTINGS, CHECK_PROPERTIES_MM_KEYS[i].key, &p);
+        }
+
+      p.magic = CHECK_PROPERTIES_MAGIC;
+      check_properties_set_current_layout (check_layout_new (&p));
+
+      g_signal_connect (CHECK_SETTINGS, "changed", G_CALLBACK (check_properties_on_settings_changed), NULL);
+    }
+
+  return CHECK_SETTINGS;
+}
+
+/* A new reference to the layout stored in GSettings */
+const CheckLayout *
+check_layout_get_current (void)
+{
+  const CheckLayout *layout = NULL;
+
+  /* The first call has to come from the main thread */
+  check_properties_get_settings ();
+
+  G_LOCK (CHECK_SETTINGS_LAYOUT);
+  layout = check_layout_ref (CHECK_SETTINGS_LAYOUT);
+  G_UNLOCK (CHECK_SETTINGS_LAYOUT);
+
+  return layout;
+}
+
 /* Load configuration from GSettings */
 int
 check_properties_load (CheckProperties *p)
 {
+  const CheckLayout *layout = NULL;
+
   if (!p)
     {
       return -1;
     }
 
-  GSettings *settings = NULL;
+  if (!check_properties_get_settings ())
+    {
+      return -2;
+    }
 
-  settings = g_settings_new (CHECKWRITER_GSETTINGS_URI);
+  layout = check_layout_get_current ();
+  memcpy (p, &layout->properties, sizeof (CheckProperties));
+  check_layout_unref (layout);
 
-  if (!settings)
+  return 0;
+}
+
+bool
+check_properties_settings_available (void)
+{
+  GSettingsSchemaSource *source = g_settings_schema_source_get_default ();
+  GSettingsSchema *schema = NULL;
+
+  if (!source)
+    {
+      return false;
+    }
+
+  schema = g_settings_schema_source_lookup (source, CHECKWRITER_GSETTINGS_URI, TRUE);
+
+  if (!schema)
+    {
+      return false;
+    }
+
+  g_settings_schema_unref (schema);
+  return true;
+}
+
+static bool
+check_properties_key_file_has_key (GKeyFile *key_file,
+                                   const char *path,
+                                   const char *key,
+                                   GError **error)
+{
+  if (g_key_file_has_key (key_file, CHECK_LAYOUT_GROUP, key, NULL))
+    {
+      return true;
+    }
+
+  g_set_error (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND,
+               "%s: Missing key \"%s\"", path, key);
+  return false;
+}
+
+/*
+ * Load configuration from a key file. The [Layout] group uses the same key
+ * names as the GSettings schema. Keys missing from the file are taken from
+ * GSettings when the schema is installed, and are an error otherwise. The
+ * MICR line keys are optional either way: without GSettings, the line goes
+ * to its standard place on the check. So is the language of the amount in
+ * words, which is then en_US.
+ */
+int
+check_properties_load_from_file (CheckProperties *p,
+                                 const char *path,
+                                 GError **error)
+{
+  g_autoptr (GKeyFile) key_file = NULL;
+  GError **missing_error = NULL;
+  GError *local_error = NULL;
+  bool micr_missing = false;
+
+  if (!p || !path)
+    {
+      return -1;
+    }
+
+  key_file = g_key_file_new ();
+
+  if (!g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, error))
     {
       return -2;
     }
 
-  /* General properties */
-  g_strlcpy (p->check_font, g_settings_get_string (settings, "check-font"), STRING_LEN);
-  p->check_font_height = g_settings_get_int (settings, "check-font-height");
+  /* Missing keys are only an error without GSettings defaults */
+  if (check_properties_settings_available ())
+    {
+      check_properties_load (p);
+    }
+  else
+    {
+      missing_error = error;
+    }
 
-  p->width = g_settings_get_double (settings, "check-width-mm");
-  p->height = g_settings_get_double (settings, "check-height-mm");
-  p->x_pad = g_settings_get_double (settings, "check-pad-x-mm");
-  p->y_pad = g_settings_get_double (settings, "check-pad-y-mm");
+  if (check_properties_key_file_has_key (key_file, path, "check-font", missing_error))
+    {
+      g_autofree char *font = g_key_file_get_string (key_file, CHECK_LAYOUT_GROUP, "check-font", error);
 
-  /* Date properties */
-  p->date.x_pos = g_settings_get_double (settings, "check-date-pos-x-mm");
-  p->date.y_pos = g_settings_get_double (settings, "check-date-pos-y-mm");
-  p->date.width = g_settings_get_double (settings, "check-date-width-mm");
+      if (!font)
+        {
+          return -3;
+        }
 
-  /* Name properties */
-  p->name.x_pos = g_settings_get_double (settings, "check-name-pos-x-mm");
-  p->name.y_pos = g_settings_get_double (settings, "check-name-pos-y-mm");
-  p->name.width = g_settings_get_double (settings, "check-name-width-mm");
+      g_strlcpy (p->check_font, font, STRING_LEN);
+    }
+  else if (missing_error)
+    {
+      return -3;
+    }
 
-  /* Amount properties */
-  p->amount.x_pos = g_settings_get_double (settings, "check-amount-pos-x-mm");
-  p->amount.y_pos = g_settings_get_double (settings, "check-amount-pos-y-mm");
-  p->amount.width = g_settings_get_double (settings, "check-amount-width-mm");
+  if (check_properties_key_file_has_key (key_file, path, "check-font-height", missing_error))
+    {
+      int height = g_key_file_get_integer (key_file, CHECK_LAYOUT_GROUP, "check-font-height", &local_error);
 
-  /* Amount in words properties */
-  p->amount_in_words.x_pos = g_settings_get_double (settings, "check-amount-in-words-pos-x-mm");
-  p->amount_in_words.y_pos = g_settings_get_double (settings, "check-amount-in-words-pos-y-mm");
-  p->amount_in_words.width = g_settings_get_double (settings, "check-amount-in-words-width-mm");
+      if (local_error)
+        {
+          g_propagate_error (error, local_error);
+          return -3;
+        }
 
-  /* Memo properties */
-  p->memo.x_pos = g_settings_get_double (settings, "check-memo-pos-x-mm");
-  p->memo.y_pos = g_settings_get_double (settings, "check-memo-pos-y-mm");
-  p->memo.width = g_settings_get_double (settings, "check-memo-width-mm");
+      p->check_font_height = height;
+    }
+  else if (missing_error)
+    {
+      return -3;
+    }
 
-  p->magic = CHECK_PROPERTIES_MAGIC;
+  for (gsize i = 0; i < G_N_ELEMENTS (CHECK_PROPERTIES_MM_KEYS); ++i)
+    {
+      const char *key = CHECK_PROPERTIES_MM_KEYS[i].key;
+      double *field = G_STRUCT_MEMBER_P (p, CHECK_PROPERTIES_MM_KEYS[i].offset);
+      double value;
 
-  /* Free GSettings object */
-  g_object_unref (settings);
+      /* Layout files written before the MICR line do not have these */
+      if (missing_error && g_str_has_prefix (key, "check-micr-")
+          && !g_key_file_has_key (key_file, CHECK_LAYOUT_GROUP, key, NULL))
+        {
+          micr_missing = true;
+          continue;
+        }
 
-  /* Mark reload to false */
-  CHECK_PROPERTIES_CHANGED = false;
+      if (!check_properties_key_file_has_key (key_file, path, key, missing_error))
+        {
+          if (missing_error)
+            {
+              return -3;
+            }
 
-  return 0;
-}
+          continue;
+        }
 
-void
-check_properties_mark_settings_changed (void)
-{
-  g_debug ("%s: Marking properties changed", __func__);
+      value = g_key_file_get_double (key_file, CHECK_LAYOUT_GROUP, key, &local_error);
 
-  g_atomic_int_set (&CHECK_PROPERTIES_CHANGED, 1);
-}
+      if (local_error)
+        {
+          g_propagate_error (error, local_error);
+          return -3;
+        }
 
-bool
-check_properties_settings_changed (void)
-{
-  guint status = g_atomic_int_get (&CHECK_PROPERTIES_CHANGED);
+      *field = value;
+    }
+
+  if (micr_missing)
+    {
+      check_micr_get_standard_position (p->width, p->height, &p->micr);
+    }
 
-  g_debug ("%s: status = %u", __func__, status);
+  if (g_key_file_has_key (key_file, CHECK_LAYOUT_GROUP, "check-amount-in-words-locale", NULL))
+    {
+      g_autofree char *name = g_key_file_get_string (key_file, CHECK_LAYOUT_GROUP,
+                                                     "check-amount-in-words-locale", error);
+
+      if (!name)
+        {
+          return -3;
+        }
+
+      if (!num_words_locale_from_name (name, &p->words_locale))
+        {
+          g_set_error (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_INVALID_VALUE,
+                       "%s: No amount in words for \"%s\"", path, name);
+          return -3;
+        }
+    }
+  else if (missing_error)
+    {
+      p->words_locale = NUM_WORDS_EN_US;
+    }
+
+  p->magic = CHECK_PROPERTIES_MAGIC;
 
-  return status != 0;
+  return 0;
 }
 
+/* Store the millimeter valued properties as a single change set */
 int
 check_properties_store (CheckProperties *p)
 {
+  const CheckLayout *current = NULL;
+  GSettings *settings = NULL;
+
   if (!p)
     {
       return -1;
     }
 
-  GSettings *settings = NULL;
-
-  settings = g_settings_new (CHECKWRITER_GSETTINGS_URI);
+  settings = check_properties_get_settings ();
 
   if (!settings)
     {
       return -2;
     }
 
-#define g_settings_set_double_chk(settings, key, value)  \
-  do                                                     \
-    {                                                    \
-      if (!g_settings_set_double (settings, key, value)) \
-        {                                                \
-          return -3;                                     \
-        }                                                \
-    }                                                    \
-  while (0)
-
-  g_settings_set_double_chk (settings, "check-width-mm", p->width);
-  g_settings_set_double_chk (settings, "check-height-mm", p->height);
-  g_settings_set_double_chk (settings, "check-pad-x-mm", p->x_pad);
-  g_settings_set_double_chk (settings, "check-pad-y-mm", p->y_pad);
-
-  /* Date properties */
-  g_settings_set_double_chk (settings, "check-date-pos-x-mm", p->date.x_pos);
-  g_settings_set_double_chk (settings, "check-date-pos-y-mm", p->date.y_pos);
-  g_settings_set_double_chk (settings, "check-date-width-mm", p->date.width);
-
-  /* Name properties */
-  g_settings_set_double_chk (settings, "check-name-pos-x-mm", p->name.x_pos);
-  g_settings_set_double_chk (settings, "check-name-pos-y-mm", p->name.y_pos);
-  g_settings_set_double_chk (settings, "check-name-width-mm", p->name.width);
-
-  /* Amount properties */
-  g_settings_set_double_chk (settings, "check-amount-pos-x-mm", p->amount.x_pos);
-  g_settings_set_double_chk (settings, "check-amount-pos-y-mm", p->amount.y_pos);
-  g_settings_set_double_chk (settings, "check-amount-width-mm", p->amount.width);
-
-  /* Amount in words properties */
-  g_settings_set_double_chk (settings, "check-amount-in-words-pos-x-mm", p->amount_in_words.x_pos);
-  g_settings_set_double_chk (settings, "check-amount-in-words-pos-y-mm", p->amount_in_words.y_pos);
-  g_settings_set_double_chk (settings, "check-amount-in-words-width-mm", p->amount_in_words.width);
-
-  /* Memo properties */
-  g_settings_set_double_chk (settings, "check-memo-pos-x-mm", p->memo.x_pos);
-  g_settings_set_double_chk (settings, "check-memo-pos-y-mm", p->memo.y_pos);
-  g_settings_set_double_chk (settings, "check-memo-width-mm", p->memo.width);
-
-#undef g_settings_set_double_chk
-  /* Free GSettings object */
-  g_object_unref (settings);
+  current = check_layout_get_current ();
+  g_settings_delay (settings);
+
+  for (gsize i = 0; i < G_N_ELEMENTS (CHECK_PROPERTIES_MM_KEYS); ++i)
+    {
+      const char *key = CHECK_PROPERTIES_MM_KEYS[i].key;
+      gsize offset = CHECK_PROPERTIES_MM_KEYS[i].offset;
+      double value = G_STRUCT_MEMBER (double, p, offset);
+
+      /* Leave unchanged keys alone */
+      if (value == G_STRUCT_MEMBER (double, &current->properties, offset))
+        {
+          continue;
+        }
+
+      if (!g_settings_set_double (settings, key, value))
+        {
+          g_settings_revert (settings);
+          check_layout_unref (current);
+          return -3;
+        }
+    }
+
+  g_settings_apply (settings);
+  check_layout_unref (current);
+
   return 0;
 }
 
@@ -216,7 +541,68 @@ check_data_set_sample (CheckData *check_data)
       setcharx (check_data->amount, 'X', 10);
       setcharx (check_data->amount_in_words, 'X', 52);
       setcharx (check_data->memo, 'X', 26);
+      check_data_set_micr (check_data, "1001", "011000015", "123456789");
+    }
+}
+
+/* Fill in the amount, and the amount in words in the language of `locale`, from a number of cents */
+int
+check_data_set_amount_cents (CheckData *check_data, gint64 cents, NumWordsLocale locale)
+{
+  gchar *dst = NULL;
+  gint written = 0;
+
+  if (!check_data)
+    {
+      return -1;
     }
+
+  /* Write the dollar amount */
+  if (check_amount_format (check_data->amount, STRING_LEN, cents) < 0)
+    {
+      return -2;
+    }
+
+  /* Write the amount in words */
+  dst = check_data->amount_in_words;
+  written = num_to_words_locale (dst, STRING_LEN, (uint32_t) (cents / 100), locale);
+
+  if (written < 0)
+    {
+      return -2;
+    }
+
+  dst[0] = g_ascii_toupper (dst[0]);
+
+  /* Write cents */
+  g_snprintf (dst + written, STRING_LEN - written, " %s %02u/100",
+              num_words_locale_get_conjunction (locale), (guint) (cents % 100));
+
+  return 0;
+}
+
+/*
+ * Parse `text` with check_amount_parse (). On failure the amount and the
+ * amount in words are left empty.
+ */
+int
+check_data_set_amount (CheckData *check_data, const char *text, NumWordsLocale locale)
+{
+  gint64 cents = 0;
+
+  if (!check_data || !text)
+    {
+      return -1;
+    }
+
+  if (check_amount_parse (text, &cents, NULL) != CHECK_AMOUNT_OK)
+    {
+      check_data->amount[0] = '\0';
+      check_data->amount_in_words[0] = '\0';
+      return -3;
+    }
+
+  return check_data_set_amount_cents (check_data, cents, locale);
 }
 
 static double
@@ -231,357 +617,600 @@ pts_to_px (double pts, double dpi)
   return (pts * dpi) / POINTS_PER_INCH;
 }
 
+/**
+ * Font cache
+ *
+ * Looking up a font face by name goes through fontconfig, which is far too
+ * slow to repeat for every field of every frame. The cache keeps the resolved
+ * faces and ready scaled fonts for the check font and the label font, and
+ * only rebuilds them when the font, its size, the DPI or the transform they
+ * are drawn with change.
+ */
+
+static cairo_scaled_font_t *
+check_font_cache_create_font (cairo_font_face_t *face,
+                              double size,
+                              const cairo_matrix_t *ctm,
+                              const cairo_font_options_t *options)
+{
+  cairo_matrix_t font_matrix;
+
+  cairo_matrix_init_scale (&font_matrix, size, size);
+
+  return cairo_scaled_font_create (face, &font_matrix, ctm, options);
+}
+
 void
-render_check (cairo_t *cr,
-              const DisplayProperties *display_prop,
-              const CheckProperties *check_prop,
-              const CheckData *check_data,
-              int flags)
+check_font_cache_clear (CheckFontCache *cache)
 {
-  if (!check_properties_initialized (check_prop))
+  if (!cache)
     {
       return;
     }
 
-  const double width = display_prop->width;
-  const double height = display_prop->height;
-  const double x_dpi = display_prop->x_dpi;
-  const double y_dpi = display_prop->y_dpi;
-  const double x_pad = mm_to_px (check_prop->x_pad, x_dpi);
-  const double y_pad = mm_to_px (check_prop->y_pad, y_dpi);
+  g_clear_pointer (&cache->field_font, cairo_scaled_font_destroy);
+  g_clear_pointer (&cache->label_font, cairo_scaled_font_destroy);
+  g_clear_pointer (&cache->small_label_font, cairo_scaled_font_destroy);
 
-  const char *check_font = check_prop->check_font;
-  const int check_font_height = check_prop->check_font_height;
+  memset (cache, 0, sizeof (CheckFontCache));
+}
 
-  /* Convert check dimensions from mm to pixels */
-  const double check_width_px = mm_to_px (check_prop->width, x_dpi);
-  const double check_height_px = mm_to_px (check_prop->height, y_dpi);
+bool
+check_font_cache_update (CheckFontCache *cache,
+                         cairo_t *cr,
+                         const char *check_font,
+                         int check_font_height,
+                         double x_dpi,
+                         double y_dpi)
+{
+  cairo_font_face_t *field_face = NULL;
+  cairo_font_face_t *label_face = NULL;
+  cairo_font_options_t *options = NULL;
+  cairo_matrix_t ctm;
 
-  const char *date = check_data->date;
-  const char *name = check_data->name;
-  const char *amount = check_data->amount;
-  const char *amount_in_words = check_data->amount_in_words;
-  const char *memo = check_data->memo;
+  cairo_get_matrix (cr, &ctm);
 
-  double scale = 1.0, scale_x = 1.0, scale_y = 1.0;
-  /* Calculate offsets to center the check */
-  double x_offset = fmax ((width - check_width_px) / 2.0, 0.0);
-  double y_offset = fmax ((height - check_height_px) / 2.0, 0.0);
+  /* Fonts only depend on the linear part of the transform */
+  ctm.x0 = 0;
+  ctm.y0 = 0;
 
-  /* Apply scaling to the canvas */
-  if (ENABLE_SCALING (flags))
+  if (cache->field_font && cache->check_font_height == check_font_height
+      && cache->x_dpi == x_dpi && cache->y_dpi == y_dpi
+      && memcmp (&cache->ctm, &ctm, sizeof (cairo_matrix_t)) == 0
+      && strcmp (cache->check_font, check_font) == 0)
     {
-      /* Calculate scale factors for X and Y axes based on the available width and */
-      /* height */
-      scale_x = width / check_width_px;
-      scale_y = height / check_height_px;
-      scale = fmin (scale_x, scale_y);
-      x_offset = 0;
-      y_offset = 0;
-      cairo_scale (cr, scale, scale);
+      return false;
     }
 
-  /* Set the background color to white and fill the area */
-  cairo_set_source_rgb (cr, 1, 1, 1); /* White background */
-  cairo_paint (cr);
+  check_font_cache_clear (cache);
 
-  /* Draw tiled greyscale pattern from an array */
-  if (ENABLE_LINES (flags))
-    {
-      /* Define a small greyscale pattern (1 byte per pixel) */
-      static uint8_t pattern_data[PATTERN_SIZE * PATTERN_SIZE] = {
-        0x20, 0x00, 0x00, 0x10,
-        0x00, 0x20, 0x10, 0x00,
-        0x00, 0x10, 0x20, 0x00,
-        0x10, 0x00, 0x00, 0x20
-      };
+  g_strlcpy (cache->check_font, check_font, STRING_LEN);
+  cache->check_font_height = check_font_height;
+  cache->x_dpi = x_dpi;
+  cache->y_dpi = y_dpi;
+  cache->ctm = ctm;
 
-      /* Create a surface for the greyscale pattern */
-      cairo_surface_t *pattern_surface = cairo_image_surface_create_for_data (
-          pattern_data,
-          CAIRO_FORMAT_A8, /* Grayscale format */
-          PATTERN_SIZE,
-          PATTERN_SIZE,
-          PATTERN_SIZE /* Stride (bytes per row) */
-      );
+  options = cairo_font_options_create ();
+  cairo_get_font_options (cr, options);
 
-      /* Create a Cairo pattern from the surface */
-      cairo_pattern_t *pattern = cairo_pattern_create_for_surface (pattern_surface);
-      cairo_pattern_set_extend (pattern, CAIRO_EXTEND_REPEAT);
+  field_face = cairo_toy_font_face_create (check_font, CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+  label_face = cairo_toy_font_face_create (CHECK_VIEW_FONT, CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
 
-      /* Fill the check area with the tiled pattern */
-      cairo_set_source (cr, pattern);
-      cairo_rectangle (cr, x_offset, y_offset, check_width_px, check_height_px);
-      cairo_fill (cr);
+  cache->field_font = check_font_cache_create_font (field_face, check_font_height, &ctm, options);
+  cache->label_font = check_font_cache_create_font (label_face, CHECK_VIEW_FONT_HEIGHT, &ctm, options);
+  cache->small_label_font = check_font_cache_create_font (label_face, CHECK_VIEW_FONT_HEIGHT - 2, &ctm, options);
 
-      /* Cleanup */
-      cairo_pattern_destroy (pattern);
-      cairo_surface_destroy (pattern_surface);
+  /* The scaled fonts hold their own references to the faces */
+  cairo_font_face_destroy (field_face);
+  cairo_font_face_destroy (label_face);
+  cairo_font_options_destroy (options);
 
-      /* Reset the color for subsequent drawing */
-      cairo_set_source_rgb (cr, 0, 0, 0);
-    }
+  g_debug ("%s: Resolved fonts \"%s\" %d pt and \"%s\"", __func__,
+           check_font, check_font_height, CHECK_VIEW_FONT);
 
-  /* Draw the check border rectangle with padding */
-  if (ENABLE_LINES (flags))
+  return true;
+}
+
+/**
+ * Render plan
+ *
+ * Everything render_check () derives from the layout and the display (pixel
+ * positions, offsets, the scale transform and label placement) is compiled
+ * once into a CheckRenderPlan, and only recompiled when one of its inputs
+ * changes. Drawing a check then only measures and draws the field text.
+ */
+
+static void
+check_render_plan_compile_field (CheckFieldPlan *field,
+                                 const FieldProperties *prop,
+                                 const DisplayProperties *display,
+                                 double x_offset,
+                                 double y_offset)
+{
+  field->x = x_offset + mm_to_px (prop->x_pos, display->x_dpi);
+  field->y = y_offset + mm_to_px (prop->y_pos, display->y_dpi);
+  field->width = mm_to_px (prop->width, display->x_dpi);
+}
+
+/* Place a label so it ends just before the start of its underline */
+static void
+check_render_plan_compile_label (CheckLabelPlan *label,
+                                 const CheckRenderPlan *plan,
+                                 const CheckFieldPlan *field,
+                                 const char *text,
+                                 cairo_scaled_font_t *font)
+{
+  cairo_text_extents_t extents;
+
+  cairo_scaled_font_text_extents (font, text, &extents);
+
+  label->text = text;
+  label->font = font;
+  label->x = field->x - plan->x_pad - extents.width;
+  label->y = field->y - plan->y_pad;
+}
+
+void
+check_render_plan_init (CheckRenderPlan *plan)
+{
+  if (plan)
     {
-      cairo_set_source_rgb (cr, 1, 0, 0); /* Red border */
-      cairo_rectangle (cr, x_offset, y_offset, check_width_px, check_height_px);
-      cairo_set_line_width (cr, 1);
-      cairo_stroke (cr); /* Draw the border */
+      memset (plan, 0, sizeof (CheckRenderPlan));
     }
+}
 
-  /* Draw Date */
-  double date_x = mm_to_px (check_prop->date.x_pos, x_dpi);
-  double date_y = mm_to_px (check_prop->date.y_pos, y_dpi);
-
-  if (date)
+void
+check_render_plan_clear (CheckRenderPlan *plan)
+{
+  if (plan)
     {
-      cairo_set_source_rgb (cr, 0, 0, 0); /* Black text */
-      cairo_select_font_face (cr, check_font, CAIRO_FONT_SLANT_NORMAL,
-                              CAIRO_FONT_WEIGHT_NORMAL);
-      cairo_set_font_size (cr, check_font_height);
+      check_font_cache_clear (&plan->fonts);
+      check_render_plan_init (plan);
+    }
+}
 
-      cairo_text_extents_t extents;
-      cairo_text_extents (cr, date, &extents);
-      cairo_move_to (cr, x_offset + x_pad + date_x + (extents.width / 2.0),
-                     y_offset + date_y - y_pad);
-      cairo_show_text (cr, date);
+bool
+check_render_plan_update (CheckRenderPlan *plan,
+                          cairo_t *cr,
+                          const DisplayProperties *display_prop,
+                          const CheckProperties *check_prop,
+                          int flags)
+{
+  if (!plan || !check_properties_initialized (check_prop))
+    {
+      return false;
     }
 
-  /* Draw underline for date */
-  if (ENABLE_LINES (flags))
+  /* Nothing to do if the plan was compiled for the same inputs */
+  if (plan->valid && plan->flags == flags
+      && memcmp (&plan->display, display_prop, sizeof (DisplayProperties)) == 0
+      && memcmp (&plan->check_prop, check_prop, sizeof (CheckProperties)) == 0)
     {
-      cairo_set_source_rgb (cr, 0, 0, 1);
-      double date_width_px = mm_to_px (check_prop->date.width, x_dpi);
-      cairo_move_to (cr, x_offset + date_x, y_offset + date_y);
-      cairo_line_to (cr, x_offset + date_x + date_width_px, y_offset + date_y);
-      cairo_stroke (cr);
+      return false;
+    }
 
-      /* Set font and text color for the label */
-      cairo_set_source_rgb (cr, 0, 0, 0);
-      cairo_select_font_face (cr, CHECK_VIEW_FONT, CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
-      cairo_set_font_size (cr, CHECK_VIEW_FONT_HEIGHT);
+  const double width = display_prop->width;
+  const double height = display_prop->height;
+  const double x_dpi = display_prop->x_dpi;
+  const double y_dpi = display_prop->y_dpi;
 
-      /* Calculate the position for "Date" so it ends before the underline */
-      cairo_text_extents_t text_extents;
-      cairo_text_extents (cr, "Date", &text_extents);
+  memcpy (&plan->display, display_prop, sizeof (DisplayProperties));
+  memcpy (&plan->check_prop, check_prop, sizeof (CheckProperties));
+  plan->flags = flags;
 
-      /* Calculate the starting X position for "Date" */
-      double text_x = x_offset + date_x - x_pad - text_extents.width;
-      double text_y = y_offset + date_y - y_pad;
+  plan->x_pad = mm_to_px (check_prop->x_pad, x_dpi);
+  plan->y_pad = mm_to_px (check_prop->y_pad, y_dpi);
 
-      /* Draw "Date" */
-      cairo_move_to (cr, text_x, text_y);
-      cairo_show_text (cr, "Date");
-    }
+  /* Convert check dimensions from mm to pixels */
+  plan->check_width = mm_to_px (check_prop->width, x_dpi);
+  plan->check_height = mm_to_px (check_prop->height, y_dpi);
 
-  /* Draw Name */
-  double name_x = mm_to_px (check_prop->name.x_pos, x_dpi);
-  double name_y = mm_to_px (check_prop->name.y_pos, y_dpi);
+  /* Calculate offsets to center the check */
+  plan->x_offset = fmax ((width - plan->check_width) / 2.0, 0.0);
+  plan->y_offset = fmax ((height - plan->check_height) / 2.0, 0.0);
+  plan->scale = 1.0;
 
-  if (name)
+  /* Fit the check into the canvas */
+  if (ENABLE_SCALING (flags))
     {
-      /* Calculate text offset */
-      double text_start_x = x_offset + name_x + x_pad;
-      double text_start_y = y_offset + name_y - y_pad;
+      /* Calculate scale factors for X and Y axes based on the available width and */
+      /* height */
+      plan->scale = fmin (width / plan->check_width, height / plan->check_height);
+      plan->x_offset = 0;
+      plan->y_offset = 0;
+    }
 
-      cairo_set_source_rgb (cr, 0, 0, 0); /* Black text */
-      cairo_select_font_face (cr, check_font, CAIRO_FONT_SLANT_NORMAL,
-                              CAIRO_FONT_WEIGHT_NORMAL);
-      cairo_set_font_size (cr, check_font_height);
+  check_render_plan_compile_field (&plan->date, &check_prop->date, display_prop, plan->x_offset, plan->y_offset);
+  check_render_plan_compile_field (&plan->name, &check_prop->name, display_prop, plan->x_offset, plan->y_offset);
+  check_render_plan_compile_field (&plan->amount, &check_prop->amount, display_prop, plan->x_offset, plan->y_offset);
+  check_render_plan_compile_field (&plan->amount_in_words, &check_prop->amount_in_words, display_prop, plan->x_offset, plan->y_offset);
+  check_render_plan_compile_field (&plan->memo, &check_prop->memo, display_prop, plan->x_offset, plan->y_offset);
+  check_render_plan_compile_field (&plan->micr, &check_prop->micr, display_prop, plan->x_offset, plan->y_offset);
+
+  /* Dotted line after the amount in words sits at half the font height */
+  plan->text_height = pts_to_px (check_prop->check_font_height, y_dpi);
+  plan->words_line_dy = (plan->text_height / 2.0) - plan->y_pad;
+
+  /* Fonts are resolved for the scaled user space they are drawn in */
+  cairo_save (cr);
+  cairo_scale (cr, plan->scale, plan->scale);
+  check_font_cache_update (&plan->fonts, cr, check_prop->check_font, check_prop->check_font_height, x_dpi, y_dpi);
+  cairo_restore (cr);
+
+  check_render_plan_compile_label (&plan->date_label, plan, &plan->date, "Date", plan->fonts.label_font);
+  check_render_plan_compile_label (&plan->name_label, plan, &plan->name, "Pay To", plan->fonts.label_font);
+  check_render_plan_compile_label (&plan->amount_label, plan, &plan->amount, "$", plan->fonts.label_font);
+  check_render_plan_compile_label (&plan->memo_label, plan, &plan->memo, "Memo", plan->fonts.small_label_font);
+
+  /* "Dollars" follows the end of its underline */
+  plan->words_label.text = "Dollars";
+  plan->words_label.font = plan->fonts.label_font;
+  plan->words_label.x = plan->amount_in_words.x + plan->amount_in_words.width + plan->x_pad;
+  plan->words_label.y = plan->amount_in_words.y - plan->y_pad;
+
+  plan->valid = true;
+
+  return true;
+}
 
-      cairo_move_to (cr, text_start_x, text_start_y);
-      cairo_show_text (cr, name);
+void
+check_render_plan_invalidate (CheckRenderPlan *plan)
+{
+  if (plan)
+    {
+      plan->valid = false;
     }
+}
 
-  /* Draw underline for name */
-  if (ENABLE_LINES (flags))
-    {
-      double name_width_px = mm_to_px (check_prop->name.width, x_dpi);
+static void
+render_check_set_field_font (cairo_t *cr, const CheckRenderPlan *plan)
+{
+  cairo_set_source_rgb (cr, 0, 0, 0); /* Black text */
+  cairo_set_scaled_font (cr, plan->fonts.field_font);
+}
 
-      double line_start_x = x_offset + name_x;
-      double line_end_x = line_start_x + name_width_px;
-      double line_y = y_offset + name_y;
+static void
+render_check_underline (cairo_t *cr,
+                        const CheckFieldPlan *field,
+                        const CheckLabelPlan *label)
+{
+  cairo_set_source_rgb (cr, 0, 0, 1);
+  cairo_move_to (cr, field->x, field->y);
+  cairo_line_to (cr, field->x + field->width, field->y);
+  cairo_stroke (cr);
 
-      cairo_set_source_rgb (cr, 0, 0, 1);
-      cairo_move_to (cr, line_start_x, line_y);
-      cairo_line_to (cr, line_end_x, line_y);
-      cairo_stroke (cr);
+  /* Set font and text color for the label */
+  cairo_set_source_rgb (cr, 0, 0, 0);
+  cairo_set_scaled_font (cr, label->font);
 
-      /* Set font and text color for the label */
-      cairo_set_source_rgb (cr, 0, 0, 0);
-      cairo_select_font_face (cr, CHECK_VIEW_FONT, CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
-      cairo_set_font_size (cr, CHECK_VIEW_FONT_HEIGHT);
+  cairo_move_to (cr, label->x, label->y);
+  cairo_show_text (cr, label->text);
+}
 
-      /* Calculate the position for "Pay To" so it ends before the underline */
-      cairo_text_extents_t text_extents;
-      cairo_text_extents (cr, "Pay To", &text_extents);
+/* Draw tiled greyscale pattern from an array */
+static void
+render_check_pattern (cairo_t *cr, const CheckRenderPlan *plan)
+{
+  /* Define a small greyscale pattern (1 byte per pixel) */
+  static uint8_t pattern_data[PATTERN_SIZE * PATTERN_SIZE] = {
+    0x20, 0x00, 0x00, 0x10,
+    0x00, 0x20, 0x10, 0x00,
+    0x00, 0x10, 0x20, 0x00,
+    0x10, 0x00, 0x00, 0x20
+  };
+
+  /* Create a surface for the greyscale pattern */
+  cairo_surface_t *pattern_surface = cairo_image_surface_create_for_data (
+      pattern_data,
+      CAIRO_FORMAT_A8, /* Grayscale format */
+      PATTERN_SIZE,
+      PATTERN_SIZE,
+      PATTERN_SIZE /* Stride (bytes per row) */
+  );
+
+  /* Create a Cairo pattern from the surface */
+  cairo_pattern_t *pattern = cairo_pattern_create_for_surface (pattern_surface);
+  cairo_pattern_set_extend (pattern, CAIRO_EXTEND_REPEAT);
+
+  /* Fill the check area with the tiled pattern */
+  cairo_set_source (cr, pattern);
+  cairo_rectangle (cr, plan->x_offset, plan->y_offset, plan->check_width, plan->check_height);
+  cairo_fill (cr);
+
+  /* Cleanup */
+  cairo_pattern_destroy (pattern);
+  cairo_surface_destroy (pattern_surface);
+}
 
-      /* Calculate the starting X position for "Pay To" */
-      double text_x = x_offset + name_x - x_pad - text_extents.width;
-      double text_y = y_offset + name_y - y_pad;
+/* Draw everything that does not depend on CheckData */
+static void
+render_check_background (cairo_t *cr, const CheckRenderPlan *plan)
+{
+  const int flags = plan->flags;
+
+  /* Set the background color to white and fill the area */
+  cairo_set_source_rgb (cr, 1, 1, 1); /* White background */
+  cairo_paint (cr);
 
-      /* Draw "Pay To" */
-      cairo_move_to (cr, text_x, text_y);
-      cairo_show_text (cr, "Pay To");
+  if (!ENABLE_LINES (flags))
+    {
+      return;
     }
 
-  /* Draw Amount */
-  double amount_x = mm_to_px (check_prop->amount.x_pos, x_dpi);
-  double amount_y = mm_to_px (check_prop->amount.y_pos, y_dpi);
+  render_check_pattern (cr, plan);
 
-  if (amount)
-    {
-      cairo_set_source_rgb (cr, 0, 0, 0); /* Black text */
-      cairo_select_font_face (cr, check_font, CAIRO_FONT_SLANT_NORMAL,
-                              CAIRO_FONT_WEIGHT_NORMAL);
-      cairo_set_font_size (cr, check_font_height);
+  /* Draw the check border rectangle with padding */
+  cairo_set_source_rgb (cr, 1, 0, 0); /* Red border */
+  cairo_rectangle (cr, plan->x_offset, plan->y_offset, plan->check_width, plan->check_height);
+  cairo_set_line_width (cr, 1);
+  cairo_stroke (cr); /* Draw the border */
+
+  /* Draw underlines and labels */
+  render_check_underline (cr, &plan->date, &plan->date_label);
+  render_check_underline (cr, &plan->name, &plan->name_label);
+  render_check_underline (cr, &plan->amount, &plan->amount_label);
+  render_check_underline (cr, &plan->amount_in_words, &plan->words_label);
+  render_check_underline (cr, &plan->memo, &plan->memo_label);
+}
 
-      cairo_move_to (cr, x_offset + amount_x + x_pad, y_offset + amount_y - y_pad);
-      cairo_show_text (cr, amount);
+static const CheckFieldPlan *
+check_render_plan_get_field (const CheckRenderPlan *plan, CheckField field)
+{
+  switch (field)
+    {
+    case CHECK_FIELD_DATE:
+      return &plan->date;
+    case CHECK_FIELD_NAME:
+      return &plan->name;
+    case CHECK_FIELD_AMOUNT:
+      return &plan->amount;
+    case CHECK_FIELD_AMOUNT_IN_WORDS:
+      return &plan->amount_in_words;
+    case CHECK_FIELD_MEMO:
+      return &plan->memo;
+    case CHECK_FIELD_MICR:
+      return &plan->micr;
+    default:
+      return NULL;
     }
+}
+
+/* Draw the amount in words, followed by a dotted line to the end of the field */
+static void
+render_check_amount_in_words (cairo_t *cr,
+                              const CheckRenderPlan *plan,
+                              const char *amount_in_words)
+{
+  const double x_pad = plan->x_pad;
+  const double y_pad = plan->y_pad;
+
+  /* Calculate text offset */
+  double text_start_x = plan->amount_in_words.x + x_pad;
+  double text_start_y = plan->amount_in_words.y - y_pad;
+  cairo_text_extents_t extents;
+
+  cairo_text_extents (cr, amount_in_words, &extents);
+
+  cairo_move_to (cr, text_start_x, text_start_y);
+  cairo_show_text (cr, amount_in_words);
+
+  /* Calculate where the dotted line should start (aligned with the end of the text) */
+  double line_start_x = text_start_x + extents.width + x_pad;
+  double line_end_x = line_start_x + (plan->amount_in_words.width - extents.width) - (2 * x_pad);
+  double line_y = text_start_y - plan->words_line_dy;
 
-  /* Draw underline for amount */
-  if (ENABLE_LINES (flags))
+  /* Only draw this line if within the border */
+  if (line_end_x > line_start_x)
     {
-      double amount_width_px = mm_to_px (check_prop->amount.width, x_dpi);
-      double line_start_x = x_offset + amount_x;
-      double line_end_x = line_start_x + amount_width_px;
-      double line_y = y_offset + amount_y;
+      /* Set the dash pattern for dotted line (5 pixels on, 3 pixels off) */
+      double dashes[] = { 3.0, 3.0 };
+      cairo_set_dash (cr, dashes, 2, 0); /* Set dash pattern */
 
-      cairo_set_source_rgb (cr, 0, 0, 1);
+      /* Strokes match the border width of the template */
+      if (ENABLE_LINES (plan->flags))
+        {
+          cairo_set_line_width (cr, 1);
+        }
+
+      /* Draw the dotted line */
       cairo_move_to (cr, line_start_x, line_y);
       cairo_line_to (cr, line_end_x, line_y);
-      cairo_stroke (cr);
+      cairo_stroke (cr); /* Render the dotted line */
 
-      /* Set font and text color for the label */
-      cairo_set_source_rgb (cr, 0, 0, 0);
-      cairo_select_font_face (cr, CHECK_VIEW_FONT, CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
-      cairo_set_font_size (cr, CHECK_VIEW_FONT_HEIGHT);
+      /* Reset the dash pattern to solid line for future strokes */
+      cairo_set_dash (cr, NULL, 0, 0);
+    }
+}
 
-      /* Calculate the position for "$" so it ends before the underline */
-      cairo_text_extents_t text_extents;
-      cairo_text_extents (cr, "$", &text_extents);
+/* Draw the text of one field, in the scaled user space of the plan */
+static void
+render_check_field (cairo_t *cr,
+                    const CheckRenderPlan *plan,
+                    CheckField field,
+                    const CheckData *check_data)
+{
+  const double x_pad = plan->x_pad;
+  const double y_pad = plan->y_pad;
 
-      /* Calculate the starting X position for "$" */
-      double text_x = x_offset + amount_x - x_pad - text_extents.width;
-      double text_y = y_offset + amount_y - y_pad;
+  render_check_set_field_font (cr, plan);
 
-      /* Draw "$" */
-      cairo_move_to (cr, text_x, text_y);
-      cairo_show_text (cr, "$");
+  switch (field)
+    {
+    case CHECK_FIELD_DATE:
+      {
+        cairo_text_extents_t extents;
+
+        cairo_text_extents (cr, check_data->date, &extents);
+        cairo_move_to (cr, plan->date.x + x_pad + (extents.width / 2.0), plan->date.y - y_pad);
+        cairo_show_text (cr, check_data->date);
+      }
+      break;
+
+    case CHECK_FIELD_NAME:
+      cairo_move_to (cr, plan->name.x + x_pad, plan->name.y - y_pad);
+      cairo_show_text (cr, check_data->name);
+      break;
+
+    case CHECK_FIELD_AMOUNT:
+      cairo_move_to (cr, plan->amount.x + x_pad, plan->amount.y - y_pad);
+      cairo_show_text (cr, check_data->amount);
+      break;
+
+    case CHECK_FIELD_AMOUNT_IN_WORDS:
+      if (strlen (check_data->amount_in_words) > 0)
+        {
+          render_check_amount_in_words (cr, plan, check_data->amount_in_words);
+        }
+      break;
+
+    case CHECK_FIELD_MEMO:
+      cairo_move_to (cr, plan->memo.x + x_pad, plan->memo.y - y_pad);
+      cairo_show_text (cr, check_data->memo);
+      break;
+
+    case CHECK_FIELD_MICR:
+      /* Glyphs from the cached path table, filled at once */
+      if (check_data->micr[0] != '\0')
+        {
+          cairo_new_path (cr);
+          check_micr_append_path (cr, check_data->micr, plan->micr.x + plan->micr.width, plan->micr.y,
+                                  mm_to_px (1.0, plan->display.x_dpi), mm_to_px (1.0, plan->display.y_dpi));
+          cairo_fill (cr);
+        }
+      break;
+
+    default:
+      break;
     }
+}
 
-  /* Draw Amount in Words */
-  double amount_words_x = mm_to_px (check_prop->amount_in_words.x_pos, x_dpi);
-  double amount_words_y = mm_to_px (check_prop->amount_in_words.y_pos, y_dpi);
-  double amount_words_width_px = mm_to_px (check_prop->amount_in_words.width, x_dpi);
+void
+render_check_plan (cairo_t *cr,
+                   const CheckRenderPlan *plan,
+                   const CheckData *check_data)
+{
+  if (!plan || !plan->valid)
+    {
+      return;
+    }
 
-  if (strlen (amount_in_words) > 0)
+  /* Apply scaling to the canvas */
+  if (ENABLE_SCALING (plan->flags))
     {
-      /* Calculate text offset */
-      double text_start_x = x_offset + amount_words_x + x_pad;
-      double text_start_y = y_offset + amount_words_y - y_pad;
-      cairo_text_extents_t extents;
+      cairo_scale (cr, plan->scale, plan->scale);
+    }
 
-      cairo_set_source_rgb (cr, 0, 0, 0); /* Black text */
-      cairo_select_font_face (cr, check_font, CAIRO_FONT_SLANT_NORMAL,
-                              CAIRO_FONT_WEIGHT_NORMAL);
-      cairo_set_font_size (cr, check_font_height);
-      cairo_text_extents (cr, amount_in_words, &extents);
+  render_check_background (cr, plan);
 
-      cairo_move_to (cr, text_start_x, text_start_y);
-      cairo_show_text (cr, amount_in_words);
+  for (int field = 0; field < CHECK_N_FIELDS; ++field)
+    {
+      render_check_field (cr, plan, field, check_data);
+    }
+}
 
-      /* Calculate where the dotted line should start (aligned with the end of the text) */
-      double line_start_x = text_start_x + extents.width + x_pad;
-      double line_end_x = line_start_x + (amount_words_width_px - extents.width) - (2 * x_pad);
-      double line_y = text_start_y - (pts_to_px (check_font_height, y_dpi) / 2.0) + y_pad;
+/*
+ * Draw the static layer of a check on its own, for callers that retain it
+ * (e.g. as a render node). Like render_check_plan (), the plan's scale is
+ * applied on top of the current transform.
+ */
+void
+render_check_plan_background (cairo_t *cr, const CheckRenderPlan *plan)
+{
+  if (!plan || !plan->valid)
+    {
+      return;
+    }
 
-      /* Only draw this line if within the border */
-      if (line_end_x > line_start_x)
-        {
-          /* Set the dash pattern for dotted line (5 pixels on, 3 pixels off) */
-          double dashes[] = { 3.0, 3.0 };
-          cairo_set_dash (cr, dashes, 2, 0); /* Set dash pattern */
+  cairo_save (cr);
 
-          /* Draw the dotted line */
-          cairo_move_to (cr, line_start_x, line_y);
-          cairo_line_to (cr, line_end_x, line_y);
-          cairo_stroke (cr); /* Render the dotted line */
+  if (ENABLE_SCALING (plan->flags))
+    {
+      cairo_scale (cr, plan->scale, plan->scale);
+    }
 
-          /* Reset the dash pattern to solid line for future strokes */
-          cairo_set_dash (cr, NULL, 0, 0);
-        }
+  render_check_background (cr, plan);
+  cairo_restore (cr);
+}
+
+/* Draw the text of a single field, without the background */
+void
+render_check_plan_field (cairo_t *cr,
+                         const CheckRenderPlan *plan,
+                         CheckField field,
+                         const CheckData *check_data)
+{
+  if (!plan || !plan->valid || !check_data)
+    {
+      return;
     }
 
-  /* Draw underline for amount in words */
-  if (ENABLE_LINES (flags))
+  cairo_save (cr);
+
+  if (ENABLE_SCALING (plan->flags))
     {
-      double line_start_x = x_offset + amount_words_x;
-      double line_end_x = line_start_x + amount_words_width_px;
-      double line_y = y_offset + amount_words_y;
+      cairo_scale (cr, plan->scale, plan->scale);
+    }
 
-      cairo_set_source_rgb (cr, 0, 0, 1);
-      cairo_move_to (cr, line_start_x, line_y);
-      cairo_line_to (cr, line_end_x, line_y);
-      cairo_stroke (cr);
+  render_check_field (cr, plan, field, check_data);
+  cairo_restore (cr);
+}
 
-      /* Set font and text color for the label */
-      cairo_set_source_rgb (cr, 0, 0, 0);
-      cairo_select_font_face (cr, CHECK_VIEW_FONT, CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
-      cairo_set_font_size (cr, CHECK_VIEW_FONT_HEIGHT);
+/*
+ * Area a field's text may cover, in the unscaled coordinates of the canvas
+ * the plan was compiled for. It spans from the start of the underline to the
+ * right edge of the canvas, and from above the font's ascent to below its
+ * descent.
+ */
+void
+check_render_plan_get_field_bounds (const CheckRenderPlan *plan,
+                                    CheckField field,
+                                    cairo_rectangle_t *bounds)
+{
+  const CheckFieldPlan *field_plan = NULL;
+  double scale = 1.0;
+  double top, bottom;
 
-      cairo_move_to (cr, line_end_x + x_pad, line_y - y_pad);
-      cairo_show_text (cr, "Dollars");
+  if (!bounds)
+    {
+      return;
     }
 
-  /* Draw Memo */
-  double memo_x = mm_to_px (check_prop->memo.x_pos, x_dpi);
-  double memo_y = mm_to_px (check_prop->memo.y_pos, y_dpi);
+  memset (bounds, 0, sizeof (cairo_rectangle_t));
 
-  if (memo)
+  if (!plan || !plan->valid || !(field_plan = check_render_plan_get_field (plan, field)))
     {
-      double text_start_x = x_offset + memo_x + x_pad;
-      double text_start_y = y_offset + memo_y - y_pad;
-      cairo_set_source_rgb (cr, 0, 0, 0); /* Black text */
-      cairo_select_font_face (cr, check_font, CAIRO_FONT_SLANT_NORMAL,
-                              CAIRO_FONT_WEIGHT_NORMAL);
-      cairo_set_font_size (cr, check_font_height);
-      cairo_move_to (cr, text_start_x, text_start_y);
-      cairo_show_text (cr, memo);
+      return;
     }
 
-  /* Draw underline for memo */
-  if (ENABLE_LINES (flags))
+  if (ENABLE_SCALING (plan->flags))
     {
-      double memo_width_px = mm_to_px (check_prop->memo.width, x_dpi);
-      double line_start_x = x_offset + memo_x;
-      double line_end_x = line_start_x + memo_width_px;
-      double line_y = y_offset + memo_y;
+      scale = plan->scale;
+    }
 
-      cairo_set_source_rgb (cr, 0, 0, 1);
-      cairo_move_to (cr, line_start_x, line_y);
-      cairo_line_to (cr, line_end_x, line_y);
-      cairo_stroke (cr);
-      cairo_set_source_rgb (cr, 0, 0, 0);
+  top = field_plan->y - plan->y_pad - (1.5 * plan->text_height);
+  bottom = field_plan->y + (0.5 * plan->text_height);
 
-      /* Set font and text color for the label */
-      cairo_set_source_rgb (cr, 0, 0, 0);
-      cairo_select_font_face (cr, CHECK_VIEW_FONT, CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
-      cairo_set_font_size (cr, CHECK_VIEW_FONT_HEIGHT - 2);
+  bounds->x = field_plan->x * scale;
+  bounds->y = fmax (top * scale, 0.0);
+  bounds->width = fmax (plan->display.width - bounds->x, 0.0);
+  bounds->height = fmax ((bottom * scale) - bounds->y, 0.0);
+}
 
-      /* Calculate the position for "Memo" so it ends before the underline */
-      cairo_text_extents_t text_extents;
-      cairo_text_extents (cr, "Memo", &text_extents);
+void
+render_check (cairo_t *cr,
+              const DisplayProperties *display_prop,
+              const CheckProperties *check_prop,
+              const CheckData *check_data,
+              int flags)
+{
+  CheckRenderPlan plan;
 
-      /* Calculate the starting X position for "Memo" */
-      double text_x = x_offset + memo_x - x_pad - text_extents.width;
-      double text_y = y_offset + memo_y - y_pad;
+  check_render_plan_init (&plan);
 
-      /* Draw "Memo" */
-      cairo_move_to (cr, text_x, text_y);
-      cairo_show_text (cr, "Memo");
+  if (check_render_plan_update (&plan, cr, display_prop, check_prop, flags))
+    {
+      render_check_plan (cr, &plan, check_data);
     }
+
+  check_render_plan_clear (&plan);
 }
@@ -38,6 +38,7 @@
 #define CHECK_VIEW_FONT_HEIGHT (9)
 
 #define STRING_LEN (256)
+#define CHECK_LAYOUT_GROUP ("Layout")
 #define CHECK_PROPERTIES_MAGIC (0xFE55AACC)
 
 /* Check view flags */
@@ -52,6 +53,17 @@ typedef struct check_field_propperties
   double width; /* Width in mm */
 } FieldProperties;
 
+/* Languages num_to_words_locale () writes, see gen-num-to-words.py */
+typedef enum
+{
+  NUM_WORDS_EN_US,
+  NUM_WORDS_EN_GB,
+  NUM_WORDS_ES,
+  NUM_WORDS_FR,
+  NUM_WORDS_DE,
+  NUM_WORDS_N_LOCALES,
+} NumWordsLocale;
+
 /* All fields are in millimeters */
 typedef struct check_properties
 {
@@ -60,6 +72,7 @@ typedef struct check_properties
   FieldProperties amount;
   FieldProperties amount_in_words;
   FieldProperties memo;
+  FieldProperties micr; /* MICR line, y_pos is the bottom of the characters */
 
   char check_font[STRING_LEN]; /* Fonts for check fields */
   int check_font_height;       /* Font height in points */
@@ -69,6 +82,8 @@ typedef struct check_properties
   double x_pad;  /* Horizontal padding in fields */
   double y_pad;  /* Vertical padding */
 
+  NumWordsLocale words_locale; /* Language of the amount in words */
+
   uint32_t magic; /* Magic value to signal initialized */
 } CheckProperties;
 
@@ -79,8 +94,34 @@ typedef struct check_data
   char amount[STRING_LEN];
   char amount_in_words[STRING_LEN];
   char memo[STRING_LEN];
+  char check_number[STRING_LEN];
+  char routing[STRING_LEN];
+  char account[STRING_LEN];
+  char micr[STRING_LEN]; /* Laid out by check_data_set_micr () */
 } CheckData;
 
+/* The fields written on a check, in drawing order */
+typedef enum
+{
+  CHECK_FIELD_DATE,
+  CHECK_FIELD_NAME,
+  CHECK_FIELD_AMOUNT,
+  CHECK_FIELD_AMOUNT_IN_WORDS,
+  CHECK_FIELD_MEMO,
+  CHECK_FIELD_MICR,
+  CHECK_N_FIELDS,
+} CheckField;
+
+/*
+ * Immutable, reference counted snapshot of a layout. Holders compare the
+ * version to tell layouts apart instead of comparing the properties.
+ */
+typedef struct check_layout
+{
+  guint version; /* Unique and increasing within the process */
+  CheckProperties properties;
+} CheckLayout;
+
 typedef struct display_properties
 {
   double width;
@@ -89,11 +130,87 @@ typedef struct display_properties
   double y_dpi;
 } DisplayProperties;
 
+typedef struct check_field_plan
+{
+  double x;     /* Start of the underline in pixels */
+  double y;     /* Baseline of the underline in pixels */
+  double width; /* Width of the underline in pixels */
+} CheckFieldPlan;
+
+typedef struct check_label_plan
+{
+  const char *text;
+  cairo_scaled_font_t *font; /* Owned by the plan's font cache */
+  double x;
+  double y;
+} CheckLabelPlan;
+
+/* Resolved fonts, reused for as long as the font, size, DPI and transform match */
+typedef struct check_font_cache
+{
+  char check_font[STRING_LEN];
+  int check_font_height;
+  double x_dpi;
+  double y_dpi;
+  cairo_matrix_t ctm;
+
+  cairo_scaled_font_t *field_font;       /* check_font at check_font_height */
+  cairo_scaled_font_t *label_font;       /* CHECK_VIEW_FONT at CHECK_VIEW_FONT_HEIGHT */
+  cairo_scaled_font_t *small_label_font; /* CHECK_VIEW_FONT for the memo label */
+} CheckFontCache;
+
+/* Pixel-space layout of a check, compiled from the properties and display */
+typedef struct check_render_plan
+{
+  /* Inputs the plan was compiled for */
+  DisplayProperties display;
+  CheckProperties check_prop;
+  int flags;
+  bool valid;
+
+  double scale; /* Uniform scale applied to the canvas */
+  double x_offset;
+  double y_offset;
+  double check_width;
+  double check_height;
+  double x_pad;
+  double y_pad;
+  double words_line_dy; /* Dotted line offset above the amount in words */
+  double text_height;   /* Height of the check font in pixels */
+
+  CheckFieldPlan date;
+  CheckFieldPlan name;
+  CheckFieldPlan amount;
+  CheckFieldPlan amount_in_words;
+  CheckFieldPlan memo;
+  CheckFieldPlan micr; /* `y` is the bottom of the characters */
+
+  CheckLabelPlan date_label;
+  CheckLabelPlan name_label;
+  CheckLabelPlan amount_label;
+  CheckLabelPlan words_label;
+  CheckLabelPlan memo_label;
+
+  CheckFontCache fonts;
+} CheckRenderPlan;
+
+const CheckLayout *check_layout_new (const CheckProperties *p);
+
+const CheckLayout *check_layout_ref (const CheckLayout *layout);
+
+void check_layout_unref (const CheckLayout *layout);
+
+const CheckLayout *check_layout_get_current (void);
+
+GSettings *check_properties_get_settings (void);
+
 int check_properties_load (CheckProperties *p);
 
-void check_properties_mark_settings_changed (void);
+bool check_properties_settings_available (void);
 
-bool check_properties_settings_changed (void);
+int check_properties_load_from_file (CheckProperties *p,
+                                     const char *path,
+                                     GError **error);
 
 int check_properties_store (CheckProperties *p);
 
@@ -103,12 +220,69 @@ int num_to_words (char *dst,
                   size_t len,
                   uint32_t num);
 
+int num_to_words_locale (char *dst,
+                         size_t len,
+                         uint32_t num,
+                         NumWordsLocale locale);
+
+bool num_words_locale_from_name (const char *name,
+                                 NumWordsLocale *locale);
+
+const char *num_words_locale_to_name (NumWordsLocale locale);
+
+const char *num_words_locale_get_conjunction (NumWordsLocale locale);
+
 void render_check (cairo_t *cr,
                    const DisplayProperties *dprop,
                    const CheckProperties *cprop,
                    const CheckData *cdata,
                    int flags);
 
+bool check_font_cache_update (CheckFontCache *cache,
+                              cairo_t *cr,
+                              const char *check_font,
+                              int check_font_height,
+                              double x_dpi,
+                              double y_dpi);
+
+void check_font_cache_clear (CheckFontCache *cache);
+
+void check_render_plan_init (CheckRenderPlan *plan);
+
+void check_render_plan_clear (CheckRenderPlan *plan);
+
+bool check_render_plan_update (CheckRenderPlan *plan,
+                               cairo_t *cr,
+                               const DisplayProperties *dprop,
+                               const CheckProperties *cprop,
+                               int flags);
+
+void check_render_plan_invalidate (CheckRenderPlan *plan);
+
+void render_check_plan (cairo_t *cr,
+                        const CheckRenderPlan *plan,
+                        const CheckData *cdata);
+
+void render_check_plan_background (cairo_t *cr,
+                                   const CheckRenderPlan *plan);
+
+void render_check_plan_field (cairo_t *cr,
+                              const CheckRenderPlan *plan,
+                              CheckField field,
+                              const CheckData *cdata);
+
+void check_render_plan_get_field_bounds (const CheckRenderPlan *plan,
+                                         CheckField field,
+                                         cairo_rectangle_t *bounds);
+
 void check_data_set_sample (CheckData *check_data);
 
+int check_data_set_amount (CheckData *check_data,
+                           const char *text,
+                           NumWordsLocale locale);
+
+int check_data_set_amount_cents (CheckData *check_data,
+                                 gint64 cents,
+                                 NumWordsLocale locale);
+
 #endif /* CHECKWRITER_CEHCK_PROPERTIES_H_ */
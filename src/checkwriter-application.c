@@ -24,6 +24,15 @@
 #include "checkwriter-preferences.h"
 #include "checkwriter-window.h"
 
+#include "check-batch.h"
+#include "check-export.h"
+#include "check-ledger.h"
+#include "check-positive-pay.h"
+#include "check-profiles.h"
+
+#include <stdlib.h>
+#include <string.h>
+
 struct _CheckwriterApplication
 {
   AdwApplication parent_instance;
@@ -59,12 +68,361 @@ checkwriter_application_activate (GApplication *app)
   gtk_window_present (window);
 }
 
+/**
+ * Headless rendering
+ *
+ * `checkwriter --render job.csv --output checks.pdf` renders a batch without
+ * ever creating a window, so neither GTK nor libadwaita get initialized.
+ */
+
+/*
+ * Resolve the layout from --profile, --layout or GSettings, in that order,
+ * then let --locale pick the language of the amount in words
+ */
+static gboolean
+checkwriter_application_load_layout (GVariantDict *options, CheckProperties *p)
+{
+  const char *layout_path = NULL;
+  const char *profile_name = NULL;
+  const char *locale_name = NULL;
+  g_autoptr (GError) error = NULL;
+
+  g_variant_dict_lookup (options, "layout", "^&ay", &layout_path);
+  g_variant_dict_lookup (options, "profile", "&s", &profile_name);
+  g_variant_dict_lookup (options, "locale", "&s", &locale_name);
+
+  memset (p, 0, sizeof (CheckProperties));
+
+  if (profile_name)
+    {
+      g_autoptr (CheckProfileStore) store = check_profile_store_open (NULL, &error);
+      int index = store ? check_profile_store_lookup (store, profile_name) : -1;
+
+      if (!store)
+        {
+          g_printerr ("Could not open profiles: %s\n", error->message);
+          return FALSE;
+        }
+
+      if (index < 0 || !check_profile_store_get (store, index, p))
+        {
+          g_printerr ("No such profile: %s\n", profile_name);
+          return FALSE;
+        }
+    }
+  else if (layout_path)
+    {
+      if (check_properties_load_from_file (p, layout_path, &error) < 0)
+        {
+          g_printerr ("Could not load layout: %s\n", error ? error->message : layout_path);
+          return FALSE;
+        }
+    }
+  else if (!check_properties_settings_available () || check_properties_load (p) < 0)
+    {
+      g_printerr ("No layout available: install the GSettings schema or pass --layout\n");
+      return FALSE;
+    }
+
+  if (locale_name && !num_words_locale_from_name (locale_name, &p->words_locale))
+    {
+      g_printerr ("No amount in words for locale: %s\n", locale_name);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* `checkwriter --layout stock.ini --save-profile "Stock"` */
+static int
+checkwriter_application_save_profile (GVariantDict *options)
+{
+  const char *name = NULL;
+  g_autoptr (CheckProfileStore) store = NULL;
+  g_autoptr (GError) error = NULL;
+  CheckProperties check_properties;
+
+  g_variant_dict_lookup (options, "save-profile", "&s", &name);
+
+  if (!checkwriter_application_load_layout (options, &check_properties))
+    {
+      return EXIT_FAILURE;
+    }
+
+  store = check_profile_store_open (NULL, &error);
+
+  if (!store || !check_profile_store_put (store, name, &check_properties, &error))
+    {
+      g_printerr ("Could not save profile: %s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+static int
+checkwriter_application_list_profiles (void)
+{
+  g_autoptr (CheckProfileStore) store = NULL;
+  g_autoptr (GError) error = NULL;
+
+  store = check_profile_store_open (NULL, &error);
+
+  if (!store)
+    {
+      g_printerr ("Could not open profiles: %s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  for (guint i = 0; i < check_profile_store_get_n_profiles (store); ++i)
+    {
+      g_print ("%s\n", check_profile_store_get_name (store, i));
+    }
+
+  return EXIT_SUCCESS;
+}
+
+/* `checkwriter --positive-pay issue.csv --issue-date 03/14/2024` */
+static int
+checkwriter_application_positive_pay (GVariantDict *options)
+{
+  const char *output_path = NULL;
+  const char *issue_date = NULL;
+  g_autofree char *journal_path = check_journal_get_default_path ();
+  g_autofree char *today = NULL;
+  g_autoptr (GError) error = NULL;
+  guint64 n_checks = 0;
+
+  g_variant_dict_lookup (options, "positive-pay", "^&ay", &output_path);
+  g_variant_dict_lookup (options, "issue-date", "&s", &issue_date);
+
+  if (!issue_date)
+    {
+      g_autoptr (GDateTime) now = g_date_time_new_now_local ();
+
+      today = g_date_time_format (now, "%m/%d/%Y");
+      issue_date = today;
+    }
+
+  if (!check_positive_pay_export (journal_path, output_path,
+                                  check_positive_pay_format_from_path (output_path),
+                                  issue_date, issue_date, &n_checks, &error))
+    {
+      g_printerr ("Could not write the Positive Pay file: %s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  g_printerr ("%" G_GUINT64_FORMAT " checks dated %s written to %s\n", n_checks, issue_date, output_path);
+
+  return EXIT_SUCCESS;
+}
+
+/*
+ * List the checks of `batch` that look like a payment made twice, within the
+ * batch or with a check already printed. Returns FALSE if there are any and
+ * they are not allowed.
+ */
+static gboolean
+checkwriter_application_check_duplicates (CheckBatch *batch,
+                                          const char *path,
+                                          gboolean allow_duplicates)
+{
+  g_autoptr (CheckLedger) ledger = NULL;
+  g_autoptr (GError) error = NULL;
+  guint n_flagged;
+
+  ledger = check_ledger_open (NULL, &error);
+
+  if (!ledger)
+    {
+      g_printerr ("Not checking against issued checks: %s\n", error->message);
+    }
+
+  n_flagged = check_batch_find_duplicates (batch, ledger);
+
+  if (n_flagged == 0)
+    {
+      return TRUE;
+    }
+
+  for (guint i = 0; i < check_batch_get_n_checks (batch); ++i)
+    {
+      CheckBatchFlags flags = check_batch_get_flags (batch, i);
+      CheckData check_data;
+
+      /* The amount in words is not listed, its language does not matter */
+      if (flags == 0 || !check_batch_get (batch, i, NUM_WORDS_EN_US, &check_data))
+        {
+          continue;
+        }
+
+      g_printerr ("%s: Check %u to %s for %s dated %s %s\n", path, i + 1, check_data.name,
+                  check_data.amount, check_data.date,
+                  (flags & CHECK_BATCH_ISSUED) ? "was already issued" : "repeats an earlier check");
+    }
+
+  if (!allow_duplicates)
+    {
+      g_printerr ("%u checks may pay twice; pass --allow-duplicates to render them anyway\n", n_flagged);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static int
+checkwriter_application_render (GVariantDict *options)
+{
+  const char *render_path = NULL;
+  const char *output_path = NULL;
+  double dpi = EXPORT_DEFAULT_DPI;
+  gint n_jobs = 0;
+  gboolean template = FALSE;
+  gboolean allow_duplicates = FALSE;
+  gboolean no_journal = FALSE;
+  g_autoptr (GError) error = NULL;
+  g_autoptr (CheckBatch) batch = NULL;
+  g_autoptr (CheckJournal) journal = NULL;
+  CheckExportFormat format;
+  CheckProperties check_properties;
+  int flags = CHECK_WRITE;
+  gboolean ok = FALSE;
+
+  g_variant_dict_lookup (options, "render", "^&ay", &render_path);
+  g_variant_dict_lookup (options, "output", "^&ay", &output_path);
+  g_variant_dict_lookup (options, "dpi", "d", &dpi);
+  g_variant_dict_lookup (options, "template", "b", &template);
+  g_variant_dict_lookup (options, "jobs", "i", &n_jobs);
+  g_variant_dict_lookup (options, "allow-duplicates", "b", &allow_duplicates);
+  g_variant_dict_lookup (options, "no-journal", "b", &no_journal);
+
+  if (!output_path)
+    {
+      g_printerr ("--render requires --output\n");
+      return EXIT_FAILURE;
+    }
+
+  format = check_export_format_from_path (output_path);
+
+  if (format == CHECK_EXPORT_FORMAT_UNKNOWN)
+    {
+      g_printerr ("Unknown output format: %s (expected .pdf or .png)\n", output_path);
+      return EXIT_FAILURE;
+    }
+
+  if (dpi <= 0)
+    {
+      g_printerr ("Invalid resolution: %g\n", dpi);
+      return EXIT_FAILURE;
+    }
+
+  if (n_jobs < 0)
+    {
+      g_printerr ("Invalid number of jobs: %d\n", n_jobs);
+      return EXIT_FAILURE;
+    }
+
+  if (template)
+    {
+      flags = CHECK_TEMPLATE;
+    }
+
+  /* Load layout */
+  if (!checkwriter_application_load_layout (options, &check_properties))
+    {
+      return EXIT_FAILURE;
+    }
+
+  /* Load checks */
+  batch = check_batch_load_csv (render_path, &error);
+
+  if (!batch)
+    {
+      g_printerr ("Could not load checks: %s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  if (!checkwriter_application_check_duplicates (batch, render_path, allow_duplicates))
+    {
+      return EXIT_FAILURE;
+    }
+
+  /* Record the checks as issued before rendering them; templates have none */
+  if (!template && !no_journal)
+    {
+      journal = check_journal_open (NULL, CHECK_JOURNAL_GROUP_SIZE, &error);
+
+      if (!journal || !check_export_journal (journal, &check_properties, batch, &error))
+        {
+          g_printerr ("Not rendering without a journal of issued checks: %s\n", error->message);
+          return EXIT_FAILURE;
+        }
+
+      /* The checks are synced, let windows print while the pages render */
+      g_clear_pointer (&journal, check_journal_free);
+    }
+
+  switch (format)
+    {
+    case CHECK_EXPORT_FORMAT_PDF:
+      ok = check_export_pdf (output_path, &check_properties, batch,
+                             flags, n_jobs, &error);
+      break;
+
+    case CHECK_EXPORT_FORMAT_PNG:
+      ok = check_export_png (output_path, &check_properties, batch,
+                             dpi, flags, n_jobs, &error);
+      break;
+
+    case CHECK_EXPORT_FORMAT_UNKNOWN:
+    default:
+      g_assert_not_reached ();
+    }
+
+  if (!ok)
+    {
+      g_printerr ("Could not render checks: %s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+static int
+checkwriter_application_handle_local_options (GApplication *app,
+                                              GVariantDict *options)
+{
+  if (g_variant_dict_contains (options, "list-profiles"))
+    {
+      return checkwriter_application_list_profiles ();
+    }
+
+  if (g_variant_dict_contains (options, "save-profile"))
+    {
+      return checkwriter_application_save_profile (options);
+    }
+
+  if (g_variant_dict_contains (options, "positive-pay"))
+    {
+      return checkwriter_application_positive_pay (options);
+    }
+
+  if (g_variant_dict_contains (options, "render"))
+    {
+      return checkwriter_application_render (options);
+    }
+
+  /* Continue with the default (GUI) processing */
+  return -1;
+}
+
 static void
 checkwriter_application_class_init (CheckwriterApplicationClass *klass)
 {
   GApplicationClass *app_class = G_APPLICATION_CLASS (klass);
 
   app_class->activate = checkwriter_application_activate;
+  app_class->handle_local_options = checkwriter_application_handle_local_options;
 }
 
 static void
@@ -142,6 +500,38 @@ checkwriter_application_preferences_action (GSimpleAction *action,
   gtk_window_present (preferences_window);
 }
 
+static const GOptionEntry app_options[] = {
+  { "render", 'r', G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, NULL,
+    "Render checks from a CSV file without opening a window", "CSV" },
+  { "output", 'o', G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, NULL,
+    "Output file for --render (.pdf or .png)", "FILE" },
+  { "layout", 'l', G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, NULL,
+    "Layout key file for --render (defaults to GSettings)", "FILE" },
+  { "dpi", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_DOUBLE, NULL,
+    "Resolution of PNG output (default: 300)", "DPI" },
+  { "jobs", 'j', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, NULL,
+    "Number of render threads for --render (default: one per processor)", "N" },
+  { "template", 't', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, NULL,
+    "Draw the check template (lines and labels) under the fields", NULL },
+  { "locale", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, NULL,
+    "Language of the amount in words (en_US, en_GB, es, fr, de)", "LOCALE" },
+  { "allow-duplicates", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, NULL,
+    "Render checks with the payee, amount and date of another check or of an issued one", NULL },
+  { "no-journal", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, NULL,
+    "Do not record the checks of --render as issued, e.g. for proofs", NULL },
+  { "profile", 'p', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, NULL,
+    "Use a saved layout profile instead of --layout or GSettings", "NAME" },
+  { "save-profile", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, NULL,
+    "Save the layout (from --layout or GSettings) as a profile and exit", "NAME" },
+  { "list-profiles", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, NULL,
+    "List the saved layout profiles and exit", NULL },
+  { "positive-pay", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, NULL,
+    "Write a Positive Pay issue file of the journaled checks (.csv or fixed width) and exit", "FILE" },
+  { "issue-date", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, NULL,
+    "Date of the checks for --positive-pay (default: today)", "MM/DD/YYYY" },
+  { NULL }
+};
+
 static const GActionEntry app_actions[] = {
   { "quit", checkwriter_application_quit_action },
   { "about", checkwriter_application_about_action },
@@ -151,6 +541,8 @@ static const GActionEntry app_actions[] = {
 static void
 checkwriter_application_init (CheckwriterApplication *self)
 {
+  g_application_add_main_option_entries (G_APPLICATION (self), app_options);
+
   g_action_map_add_action_entries (G_ACTION_MAP (self),
                                    app_actions,
                                    G_N_ELEMENTS (app_actions),
@@ -0,0 +1,319 @@
+/* checkwriter-check-preview.c
+ *
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include "checkwriter-check-preview.h"
+
+#include <math.h>
+#include <string.h>
+
+/*
+ * A check preview that keeps the render nodes of its last frame: a new
+ * layout or size drops all of them, while changing the check data only
+ * rebuilds the nodes of the fields that changed.
+ *
+ * Each field is a cairo node, which GSK replays wherever it intersects the
+ * damage of a frame. The static layer (pattern, border, underlines and
+ * labels) covers the whole check, so it is drawn once into an image at the
+ * device scale and kept as a texture node: later frames copy pixels from it
+ * instead of replaying the tiled pattern on every keystroke.
+ */
+
+struct _CheckwriterCheckPreview
+{
+  GtkWidget parent_instance;
+
+  const CheckLayout *layout;
+  CheckData check_data;
+
+  CheckRenderPlan plan;
+
+  /* Context the plan measures fonts with, outside of a frame */
+  cairo_t *measure_cr;
+
+  GskRenderNode *background_node;
+  GskRenderNode *field_nodes[CHECK_N_FIELDS];
+};
+
+G_DEFINE_FINAL_TYPE (CheckwriterCheckPreview, checkwriter_check_preview, GTK_TYPE_WIDGET)
+
+/**
+ * Render nodes
+ */
+
+static const char *
+checkwriter_check_preview_field_text (const CheckData *check_data, CheckField field)
+{
+  switch (field)
+    {
+    case CHECK_FIELD_DATE:
+      return check_data->date;
+    case CHECK_FIELD_NAME:
+      return check_data->name;
+    case CHECK_FIELD_AMOUNT:
+      return check_data->amount;
+    case CHECK_FIELD_AMOUNT_IN_WORDS:
+      return check_data->amount_in_words;
+    case CHECK_FIELD_MEMO:
+      return check_data->memo;
+    case CHECK_FIELD_MICR:
+      return check_data->micr;
+    default:
+      return "";
+    }
+}
+
+static void
+checkwriter_check_preview_clear_nodes (CheckwriterCheckPreview *self)
+{
+  g_clear_pointer (&self->background_node, gsk_render_node_unref);
+
+  for (int field = 0; field < CHECK_N_FIELDS; ++field)
+    {
+      g_clear_pointer (&self->field_nodes[field], gsk_render_node_unref);
+    }
+}
+
+static GskRenderNode *
+checkwriter_check_preview_build_background (CheckwriterCheckPreview *self, int scale_factor)
+{
+  graphene_rect_t bounds;
+  cairo_surface_t *surface = NULL;
+  g_autoptr (GBytes) bytes = NULL;
+  g_autoptr (GdkTexture) texture = NULL;
+  cairo_t *cr = NULL;
+  int width, height;
+
+  width = (int) ceil (self->plan.display.width * scale_factor);
+  height = (int) ceil (self->plan.display.height * scale_factor);
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+  cairo_surface_set_device_scale (surface, scale_factor, scale_factor);
+
+  cr = cairo_create (surface);
+  render_check_plan_background (cr, &self->plan);
+  cairo_destroy (cr);
+  cairo_surface_flush (surface);
+
+  /* GDK_MEMORY_DEFAULT is the layout of CAIRO_FORMAT_ARGB32 */
+  bytes = g_bytes_new_with_free_func (cairo_image_surface_get_data (surface),
+                                      (gsize) cairo_image_surface_get_stride (surface) * height,
+                                      (GDestroyNotify) cairo_surface_destroy, surface);
+  texture = gdk_memory_texture_new (width, height, GDK_MEMORY_DEFAULT, bytes,
+                                    cairo_image_surface_get_stride (surface));
+
+  graphene_rect_init (&bounds, 0, 0, (double) width / scale_factor, (double) height / scale_factor);
+
+  return gsk_texture_node_new (texture, &bounds);
+}
+
+static GskRenderNode *
+checkwriter_check_preview_build_field (CheckwriterCheckPreview *self, CheckField field)
+{
+  cairo_rectangle_t rect;
+  graphene_rect_t bounds;
+  GskRenderNode *node = NULL;
+  cairo_t *cr = NULL;
+
+  check_render_plan_get_field_bounds (&self->plan, field, &rect);
+
+  if (rect.width <= 0 || rect.height <= 0)
+    {
+      return NULL;
+    }
+
+  graphene_rect_init (&bounds, rect.x, rect.y, rect.width, rect.height);
+
+  node = gsk_cairo_node_new (&bounds);
+  cr = gsk_cairo_node_get_draw_context (node);
+  render_check_plan_field (cr, &self->plan, field, &self->check_data);
+  cairo_destroy (cr);
+
+  return node;
+}
+
+/**
+ * Widget implementation
+ */
+
+static void
+checkwriter_check_preview_snapshot (GtkWidget *widget, GtkSnapshot *snapshot)
+{
+  CheckwriterCheckPreview *self = CHECKWRITER_CHECK_PREVIEW (widget);
+  int scale_factor = gtk_widget_get_scale_factor (widget);
+  DisplayProperties display;
+
+  display.width = gtk_widget_get_width (widget);
+  display.height = gtk_widget_get_height (widget);
+  display.x_dpi = DEFAULT_DPI * scale_factor;
+  display.y_dpi = DEFAULT_DPI * scale_factor;
+
+  if (!self->layout || display.width <= 0 || display.height <= 0)
+    {
+      return;
+    }
+
+  /* A new layout, size or scale invalidates every node */
+  if (check_render_plan_update (&self->plan, self->measure_cr, &display,
+                                &self->layout->properties, CHECK_PREVIEW_ONLY))
+    {
+      checkwriter_check_preview_clear_nodes (self);
+    }
+
+  if (!self->plan.valid)
+    {
+      return;
+    }
+
+  if (!self->background_node)
+    {
+      self->background_node = checkwriter_check_preview_build_background (self, scale_factor);
+      g_debug ("%s: Rebuilt background node", __func__);
+    }
+
+  gtk_snapshot_append_node (snapshot, self->background_node);
+
+  for (int field = 0; field < CHECK_N_FIELDS; ++field)
+    {
+      const char *text = checkwriter_check_preview_field_text (&self->check_data, field);
+
+      if (!self->field_nodes[field] && text[0] != '\0')
+        {
+          self->field_nodes[field] = checkwriter_check_preview_build_field (self, field);
+          g_debug ("%s: Rebuilt node for field %d", __func__, field);
+        }
+
+      if (self->field_nodes[field])
+        {
+          gtk_snapshot_append_node (snapshot, self->field_nodes[field]);
+        }
+    }
+}
+
+/**
+ * Public API
+ */
+
+GtkWidget *
+checkwriter_check_preview_new (void)
+{
+  return g_object_new (CHECKWRITER_TYPE_CHECK_PREVIEW, NULL);
+}
+
+void
+checkwriter_check_preview_set_layout (CheckwriterCheckPreview *self,
+                                      const CheckLayout *layout)
+{
+  g_return_if_fail (CHECKWRITER_IS_CHECK_PREVIEW (self));
+  g_return_if_fail (layout != NULL);
+
+  if (self->layout && self->layout->version == layout->version)
+    {
+      return;
+    }
+
+  /* The plan notices the new layout on the next frame */
+  check_layout_unref (self->layout);
+  self->layout = check_layout_ref (layout);
+  gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+void
+checkwriter_check_preview_set_data (CheckwriterCheckPreview *self,
+                                    const CheckData *check_data)
+{
+  bool changed = false;
+
+  g_return_if_fail (CHECKWRITER_IS_CHECK_PREVIEW (self));
+  g_return_if_fail (check_data != NULL);
+
+  for (int field = 0; field < CHECK_N_FIELDS; ++field)
+    {
+      const char *old_text = checkwriter_check_preview_field_text (&self->check_data, field);
+      const char *new_text = checkwriter_check_preview_field_text (check_data, field);
+
+      if (strcmp (old_text, new_text) != 0)
+        {
+          g_clear_pointer (&self->field_nodes[field], gsk_render_node_unref);
+          changed = true;
+        }
+    }
+
+  if (changed)
+    {
+      memcpy (&self->check_data, check_data, sizeof (CheckData));
+      gtk_widget_queue_draw (GTK_WIDGET (self));
+    }
+}
+
+/**
+ * Object Initialization
+ */
+
+static void
+checkwriter_check_preview_dispose (GObject *object)
+{
+  CheckwriterCheckPreview *self = CHECKWRITER_CHECK_PREVIEW (object);
+
+  checkwriter_check_preview_clear_nodes (self);
+
+  G_OBJECT_CLASS (checkwriter_check_preview_parent_class)->dispose (object);
+}
+
+static void
+checkwriter_check_preview_finalize (GObject *object)
+{
+  CheckwriterCheckPreview *self = CHECKWRITER_CHECK_PREVIEW (object);
+
+  check_render_plan_clear (&self->plan);
+  g_clear_pointer (&self->layout, check_layout_unref);
+  g_clear_pointer (&self->measure_cr, cairo_destroy);
+
+  G_OBJECT_CLASS (checkwriter_check_preview_parent_class)->finalize (object);
+}
+
+static void
+checkwriter_check_preview_class_init (CheckwriterCheckPreviewClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+  object_class->dispose = checkwriter_check_preview_dispose;
+  object_class->finalize = checkwriter_check_preview_finalize;
+
+  widget_class->snapshot = checkwriter_check_preview_snapshot;
+
+  gtk_widget_class_set_css_name (widget_class, "checkpreview");
+  gtk_widget_class_set_accessible_role (widget_class, GTK_ACCESSIBLE_ROLE_IMG);
+}
+
+static void
+checkwriter_check_preview_init (CheckwriterCheckPreview *self)
+{
+  cairo_surface_t *surface = NULL;
+
+  check_data_init (&self->check_data);
+  check_render_plan_init (&self->plan);
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 1, 1);
+  self->measure_cr = cairo_create (surface);
+  cairo_surface_destroy (surface);
+}
@@ -0,0 +1,41 @@
+/* checkwriter-check-preview.h
+ *
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+#include "check-properties.h"
+
+G_BEGIN_DECLS
+
+#define CHECKWRITER_TYPE_CHECK_PREVIEW (checkwriter_check_preview_get_type ())
+
+G_DECLARE_FINAL_TYPE (CheckwriterCheckPreview, checkwriter_check_preview, CHECKWRITER, CHECK_PREVIEW, GtkWidget)
+
+GtkWidget *checkwriter_check_preview_new (void);
+
+void checkwriter_check_preview_set_layout (CheckwriterCheckPreview *self,
+                                           const CheckLayout *layout);
+
+void checkwriter_check_preview_set_data (CheckwriterCheckPreview *self,
+                                         const CheckData *check_data);
+
+G_END_DECLS
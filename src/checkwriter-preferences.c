@@ -19,6 +19,8 @@
 
 #include "checkwriter-preferences.h"
 #include "check-properties.h"
+#include "checkwriter-check-preview.h"
+#include "checkwriter-update-scheduler.h"
 
 /**
  * Type definitions
@@ -29,6 +31,9 @@ struct _CheckwriterPreferences
 
   CheckProperties check_properties;
 
+  /* Applies spin button changes to the preview once per frame */
+  CheckwriterUpdateScheduler update_scheduler;
+
   GtkWindow *preferences_window;
 
   GtkButton *apply_button;
@@ -59,7 +64,11 @@ struct _CheckwriterPreferences
   GtkSpinButton *memo_y_spin;
   GtkSpinButton *memo_width_spin;
 
-  GtkWidget *check_preview_area;
+  GtkSpinButton *micr_x_spin;
+  GtkSpinButton *micr_y_spin;
+  GtkSpinButton *micr_width_spin;
+
+  GtkWidget *check_preview;
 };
 
 G_DEFINE_TYPE (CheckwriterPreferences, checkwriter_preferences, GTK_TYPE_WIDGET)
@@ -71,6 +80,8 @@ G_DEFINE_TYPE (CheckwriterPreferences, checkwriter_preferences, GTK_TYPE_WIDGET)
 static void
 checkwriter_preferences_load_settings (CheckwriterPreferences *self)
 {
+  const CheckLayout *layout = NULL;
+
   if (!self)
     {
       g_warning ("Self not initialized, not loading settings");
@@ -103,6 +114,14 @@ checkwriter_preferences_load_settings (CheckwriterPreferences *self)
   gtk_spin_button_set_value (self->memo_x_spin, self->check_properties.memo.x_pos);
   gtk_spin_button_set_value (self->memo_y_spin, self->check_properties.memo.y_pos);
   gtk_spin_button_set_value (self->memo_width_spin, self->check_properties.memo.width);
+
+  gtk_spin_button_set_value (self->micr_x_spin, self->check_properties.micr.x_pos);
+  gtk_spin_button_set_value (self->micr_y_spin, self->check_properties.micr.y_pos);
+  gtk_spin_button_set_value (self->micr_width_spin, self->check_properties.micr.width);
+
+  layout = check_layout_get_current ();
+  checkwriter_check_preview_set_layout (CHECKWRITER_CHECK_PREVIEW (self->check_preview), layout);
+  check_layout_unref (layout);
 }
 
 /**
@@ -142,6 +161,7 @@ checkwriter_preferences_on_apply_button_clicked (GtkButton *button,
     }
 
   /* Apply the settings */
+  checkwriter_update_scheduler_flush (&self->update_scheduler);
 
   if (check_properties_store (&self->check_properties) < 0)
     {
@@ -249,78 +269,61 @@ checkwriter_preferences_on_spin_value_change (GtkSpinButton *spin,
     {
       self->check_properties.memo.width = gtk_spin_button_get_value (self->memo_width_spin);
     }
-
-  /* Mark global variable changed */
-  check_properties_mark_settings_changed ();
-
-  /* Update the check preview */
-  if (self->check_preview_area)
+  /* MICR line */
+  else if (spin == self->micr_x_spin)
     {
-      gtk_widget_queue_draw (self->check_preview_area);
+      self->check_properties.micr.x_pos = gtk_spin_button_get_value (self->micr_x_spin);
     }
-}
-
-/**
- * Drawing functions
- */
-
-static void
-checkwriter_preferences_draw_check_preview (GtkDrawingArea *area,
-                                            cairo_t *cr,
-                                            int width,
-                                            int height,
-                                            gpointer user_data)
-{
-  CheckwriterPreferences *self = NULL;
-  cairo_surface_t *surface = NULL;
-
-  DisplayProperties display;
-  CheckData check_data;
-
-  double x_scale, y_scale, x_dpi, y_dpi;
-
-  (void) area;
-
-  self = CHECKWRITER_PREFERENCES (user_data);
-  if (!self)
+  else if (spin == self->micr_y_spin)
     {
-      g_error ("%s: Failed to retrieve instance. Invalid `user_data` parameter.", __func__);
-      return;
+      self->check_properties.micr.y_pos = gtk_spin_button_get_value (self->micr_y_spin);
     }
-
-  /* Get the target surface */
-  surface = cairo_get_target (cr);
-  if (!surface)
+  else if (spin == self->micr_width_spin)
     {
-      g_error ("%s: Failed to retrieve cairo instance. Invalid `cr` parameter.", __func__);
-      return;
+      self->check_properties.micr.width = gtk_spin_button_get_value (self->micr_width_spin);
     }
 
-  /* Get the device scale (this accounts for any scaling on HiDPI displays) */
-  cairo_surface_get_device_scale (surface, &x_scale, &y_scale);
-
-  x_dpi = DEFAULT_DPI * x_scale;
-  y_dpi = DEFAULT_DPI * y_scale;
+  checkwriter_update_scheduler_mark_dirty (&self->update_scheduler, CHECKWRITER_UPDATE_LAYOUT);
+}
 
-  display.width = width;
-  display.height = height;
-  display.x_dpi = x_dpi;
-  display.y_dpi = y_dpi;
+static void
+checkwriter_preferences_apply_updates (guint dirty, gpointer user_data)
+{
+  CheckwriterPreferences *self = CHECKWRITER_PREFERENCES (user_data);
+  const CheckLayout *layout = NULL;
 
-  check_data_set_sample (&check_data);
+  (void) dirty;
 
-  render_check (cr, &display, &self->check_properties, &check_data, CHECK_PREVIEW_ONLY);
+  /* Update the check preview with a snapshot of the edited layout */
+  layout = check_layout_new (&self->check_properties);
+  checkwriter_check_preview_set_layout (CHECKWRITER_CHECK_PREVIEW (self->check_preview), layout);
+  check_layout_unref (layout);
 }
 
 /**
  * Object Initialization
  */
 
+static void
+checkwriter_preferences_dispose (GObject *object)
+{
+  CheckwriterPreferences *self = CHECKWRITER_PREFERENCES (object);
+
+  checkwriter_update_scheduler_clear (&self->update_scheduler);
+
+  G_OBJECT_CLASS (checkwriter_preferences_parent_class)->dispose (object);
+}
+
 static void
 checkwriter_preferences_class_init (CheckwriterPreferencesClass *klass)
 {
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
 
+  object_class->dispose = checkwriter_preferences_dispose;
+
+  g_type_ensure (CHECKWRITER_TYPE_CHECK_PREVIEW);
+
   gtk_widget_class_set_template_from_resource (widget_class, CHECKWRITER_PREFERENCES_RESOURCE_FILE);
   /* Bind the variables to the template */
 
@@ -353,16 +356,24 @@ checkwriter_preferences_class_init (CheckwriterPreferencesClass *klass)
   gtk_widget_class_bind_template_child (widget_class, CheckwriterPreferences, memo_x_spin);
   gtk_widget_class_bind_template_child (widget_class, CheckwriterPreferences, memo_y_spin);
   gtk_widget_class_bind_template_child (widget_class, CheckwriterPreferences, memo_width_spin);
+  gtk_widget_class_bind_template_child (widget_class, CheckwriterPreferences, micr_x_spin);
+  gtk_widget_class_bind_template_child (widget_class, CheckwriterPreferences, micr_y_spin);
+  gtk_widget_class_bind_template_child (widget_class, CheckwriterPreferences, micr_width_spin);
 
-  gtk_widget_class_bind_template_child (widget_class, CheckwriterPreferences, check_preview_area);
+  gtk_widget_class_bind_template_child (widget_class, CheckwriterPreferences, check_preview);
 }
 
 static void
 checkwriter_preferences_init (CheckwriterPreferences *self)
 {
+  CheckData check_data;
+
   /* Initialize template */
   gtk_widget_init_template (GTK_WIDGET (self));
 
+  checkwriter_update_scheduler_init (&self->update_scheduler, self->check_preview,
+                                     checkwriter_preferences_apply_updates, self);
+
   /* Connect signals */
   g_signal_connect (self->cancel_button, "clicked",
                     G_CALLBACK (checkwriter_preferences_on_cancel_button_clicked), self);
@@ -427,9 +438,18 @@ checkwriter_preferences_init (CheckwriterPreferences *self)
   g_signal_connect (self->memo_width_spin, "value-changed",
                     G_CALLBACK (checkwriter_preferences_on_spin_value_change), self);
 
-  /* Connect drawing area update function */
-  gtk_drawing_area_set_draw_func (GTK_DRAWING_AREA (self->check_preview_area),
-                                  checkwriter_preferences_draw_check_preview, self, NULL);
+  g_signal_connect (self->micr_x_spin, "value-changed",
+                    G_CALLBACK (checkwriter_preferences_on_spin_value_change), self);
+
+  g_signal_connect (self->micr_y_spin, "value-changed",
+                    G_CALLBACK (checkwriter_preferences_on_spin_value_change), self);
+
+  g_signal_connect (self->micr_width_spin, "value-changed",
+                    G_CALLBACK (checkwriter_preferences_on_spin_value_change), self);
+
+  /* The preview shows sample data laid out with the edited properties */
+  check_data_set_sample (&check_data);
+  checkwriter_check_preview_set_data (CHECKWRITER_CHECK_PREVIEW (self->check_preview), &check_data);
 
   g_debug ("%s: Init finished", __func__);
 }
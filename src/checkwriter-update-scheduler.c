@@ -0,0 +1,137 @@
+/* checkwriter-update-scheduler.c
+ *
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include "checkwriter-update-scheduler.h"
+
+#include <string.h>
+
+static gboolean
+checkwriter_update_scheduler_on_tick (GtkWidget *widget,
+                                      GdkFrameClock *frame_clock,
+                                      gpointer user_data)
+{
+  CheckwriterUpdateScheduler *sched = user_data;
+
+  (void) widget;
+  (void) frame_clock;
+
+  /* The tick callback is removed by returning G_SOURCE_REMOVE */
+  sched->tick_id = 0;
+  checkwriter_update_scheduler_flush (sched);
+
+  return G_SOURCE_REMOVE;
+}
+
+void
+checkwriter_update_scheduler_init (CheckwriterUpdateScheduler *sched,
+                                   GtkWidget *widget,
+                                   CheckwriterUpdateFunc func,
+                                   gpointer user_data)
+{
+  g_return_if_fail (sched != NULL);
+  g_return_if_fail (GTK_IS_WIDGET (widget));
+
+  memset (sched, 0, sizeof (CheckwriterUpdateScheduler));
+  sched->widget = widget;
+  sched->func = func;
+  sched->user_data = user_data;
+}
+
+void
+checkwriter_update_scheduler_clear (CheckwriterUpdateScheduler *sched)
+{
+  if (!sched)
+    {
+      return;
+    }
+
+  if (sched->tick_id && sched->widget)
+    {
+      gtk_widget_remove_tick_callback (sched->widget, sched->tick_id);
+    }
+
+  g_debug ("%s: %" G_GUINT64_FORMAT " changes, %" G_GUINT64_FORMAT " coalesced into %" G_GUINT64_FORMAT " updates",
+           __func__, sched->n_events, sched->n_coalesced, sched->n_updates);
+
+  memset (sched, 0, sizeof (CheckwriterUpdateScheduler));
+}
+
+void
+checkwriter_update_scheduler_mark_dirty (CheckwriterUpdateScheduler *sched,
+                                         guint dirty)
+{
+  g_return_if_fail (sched != NULL && sched->widget != NULL);
+
+  ++sched->n_events;
+
+  /* An update is already pending for this frame */
+  if (sched->dirty)
+    {
+      ++sched->n_coalesced;
+    }
+
+  sched->dirty |= dirty;
+
+  if (!sched->tick_id)
+    {
+      sched->tick_id = gtk_widget_add_tick_callback (sched->widget,
+                                                     checkwriter_update_scheduler_on_tick,
+                                                     sched, NULL);
+    }
+}
+
+/* Apply pending changes now, e.g. before printing */
+void
+checkwriter_update_scheduler_flush (CheckwriterUpdateScheduler *sched)
+{
+  guint dirty;
+
+  g_return_if_fail (sched != NULL);
+
+  if (sched->tick_id)
+    {
+      gtk_widget_remove_tick_callback (sched->widget, sched->tick_id);
+      sched->tick_id = 0;
+    }
+
+  if (!sched->dirty)
+    {
+      return;
+    }
+
+  dirty = sched->dirty;
+  sched->dirty = 0;
+  ++sched->n_updates;
+
+  if (sched->func)
+    {
+      sched->func (dirty, sched->user_data);
+    }
+}
+
+guint64
+checkwriter_update_scheduler_get_coalesced (const CheckwriterUpdateScheduler *sched)
+{
+  g_return_val_if_fail (sched != NULL, 0);
+
+  return sched->n_coalesced;
+}
@@ -0,0 +1,70 @@
+/* checkwriter-update-scheduler.h
+ *
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+#include "check-properties.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Collects changes between frames and applies them once per frame of a
+ * widget's GdkFrameClock. Input handlers only mark what changed; the update
+ * function then does the parsing and layout work for all of it together,
+ * just before the frame is drawn.
+ */
+
+/* Dirty bits: one per CheckField, plus the layout */
+#define CHECKWRITER_UPDATE_FIELD(field) (1u << (field))
+#define CHECKWRITER_UPDATE_LAYOUT (1u << CHECK_N_FIELDS)
+
+typedef void (*CheckwriterUpdateFunc) (guint dirty, gpointer user_data);
+
+typedef struct checkwriter_update_scheduler
+{
+  GtkWidget *widget; /* Not owned; supplies the frame clock */
+  CheckwriterUpdateFunc func;
+  gpointer user_data;
+
+  guint tick_id;
+  guint dirty;
+
+  guint64 n_events;    /* Changes marked */
+  guint64 n_coalesced; /* Changes folded into an update already pending */
+  guint64 n_updates;   /* Times the update function ran */
+} CheckwriterUpdateScheduler;
+
+void checkwriter_update_scheduler_init (CheckwriterUpdateScheduler *sched,
+                                        GtkWidget *widget,
+                                        CheckwriterUpdateFunc func,
+                                        gpointer user_data);
+
+void checkwriter_update_scheduler_clear (CheckwriterUpdateScheduler *sched);
+
+void checkwriter_update_scheduler_mark_dirty (CheckwriterUpdateScheduler *sched,
+                                              guint dirty);
+
+void checkwriter_update_scheduler_flush (CheckwriterUpdateScheduler *sched);
+
+guint64 checkwriter_update_scheduler_get_coalesced (const CheckwriterUpdateScheduler *sched);
+
+G_END_DECLS
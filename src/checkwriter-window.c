@@ -22,9 +22,17 @@
 
 #include "checkwriter-window.h"
 
+#include "check-amount.h"
+#include "check-batch.h"
+#include "check-export.h"
+#include "check-journal.h"
+#include "check-ledger.h"
+#include "check-micr.h"
+#include "check-payees.h"
+#include "check-profiles.h"
 #include "check-properties.h"
-
-#include <ctype.h>
+#include "checkwriter-check-preview.h"
+#include "checkwriter-update-scheduler.h"
 
 struct _CheckwriterWindow
 {
@@ -35,170 +43,971 @@ struct _CheckwriterWindow
   GtkWidget *pay_to_order_entry;
   GtkWidget *check_amount_entry;
   GtkWidget *check_memo_entry;
+  GtkWidget *check_number_entry;
 
-  GtkWidget *check_preview_area;
+  GtkWidget *check_preview;
+  GtkWidget *profile_dropdown;
 
   GtkWidget *place_on_check_button;
   GtkWidget *print_template_button;
+  GtkWidget *open_batch_button;
+  GtkWidget *clear_batch_button;
+  GtkWidget *batch_status_label;
+  GtkWidget *export_button;
+  GtkWidget *cancel_export_button;
+  GtkWidget *export_progress;
+
+  /* Current layout, shared with the settings and the preview */
+  const CheckLayout *layout;
+
+  /* Saved layouts; `profile_index` is -1 while following GSettings */
+  CheckProfileStore *profiles;
+  int profile_index;
+  CheckData check_data;
+
+  /* Payee suggestions below the pay-to entry; `payees` is NULL without a directory */
+  CheckPayeeDirectory *payees;
+  GtkWidget *payee_popover;
+  GtkWidget *payee_list;
+  gboolean payee_completing;
+
+  /* Applies input changes once per frame of the preview */
+  CheckwriterUpdateScheduler update_scheduler;
+
+  /* Compiled layout for printing */
+  CheckRenderPlan print_plan;
+
+  /* Layout of the print job in progress, NULL while not printing */
+  const CheckLayout *print_layout;
+  guint32 print_layout_id;
+
+  /* Issued checks, opened for the first print job */
+  CheckJournal *journal;
+
+  /* One bit per page of the print job, set once its check is journaled */
+  guint8 *print_journaled;
+  int print_n_pages;
+  gboolean print_preview;
+
+  /* Records printed as one job when a batch is loaded, otherwise NULL */
+  CheckBatch *check_batch;
+  guint check_batch_n_flagged; /* Suspected duplicate payments */
+
+  /* Export in progress: NULL once it finished or the window went away */
+  GCancellable *export_cancellable;
+  CheckBatch *export_batch;
+};
+
+G_DEFINE_FINAL_TYPE (CheckwriterWindow, checkwriter_window, ADW_TYPE_APPLICATION_WINDOW)
+
+#define PAYEE_MAX_SUGGESTIONS (8)
+#define DUPLICATES_MAX_LISTED (10)
+
+static void checkwriter_window_load_payees (CheckwriterWindow *window);
+
+static void checkwriter_window_update_payee_suggestions (CheckwriterWindow *window,
+                                                         const char *text);
+
+static void checkwriter_window_set_amount (CheckwriterWindow *window, const char *text);
+
+static void checkwriter_window_confirm_duplicates (CheckwriterWindow *window,
+                                                   const char *export_path);
+
+static const char *
+checkwriter_window_get_entry_text (GtkWidget *entry)
+{
+  const char *text = gtk_editable_get_text (GTK_EDITABLE (entry));
+
+  return text ? text : "";
+}
+
+/**
+ * Preview
+ */
+
+/* Use `layout` for the preview and printing, taking ownership of it */
+static void
+checkwriter_window_set_layout (CheckwriterWindow *window, const CheckLayout *layout)
+{
+  NumWordsLocale words_locale;
+
+  if (window->layout && layout->version == window->layout->version)
+    {
+      check_layout_unref (layout);
+      return;
+    }
+
+  /* The amount is spelled in English until there is a layout */
+  words_locale = window->layout ? window->layout->properties.words_locale : NUM_WORDS_EN_US;
+
+  check_layout_unref (window->layout);
+  window->layout = layout;
+
+  /* Spell the amount again in the language of the new layout */
+  if (layout->properties.words_locale != words_locale)
+    {
+      checkwriter_window_set_amount (window,
+                                     checkwriter_window_get_entry_text (window->check_amount_entry));
+    }
+}
+
+/* Hand the current layout and check data to the preview widget */
+static void
+checkwriter_window_update_preview (CheckwriterWindow *window)
+{
+  CheckwriterCheckPreview *preview = CHECKWRITER_CHECK_PREVIEW (window->check_preview);
+
+  checkwriter_check_preview_set_layout (preview, window->layout);
+  checkwriter_check_preview_set_data (preview, &window->check_data);
+}
+
+static void
+checkwriter_window_on_settings_changed (GSettings *settings,
+                                        const char *key,
+                                        gpointer user_data)
+{
+  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
+
+  (void) settings;
+
+  if (g_strcmp0 (key, "payee-directory") == 0)
+    {
+      checkwriter_window_load_payees (window);
+      return;
+    }
+
+  if (g_str_has_prefix (key, "micr-"))
+    {
+      checkwriter_update_scheduler_mark_dirty (&window->update_scheduler,
+                                               CHECKWRITER_UPDATE_FIELD (CHECK_FIELD_MICR));
+      return;
+    }
+
+  checkwriter_update_scheduler_mark_dirty (&window->update_scheduler, CHECKWRITER_UPDATE_LAYOUT);
+}
+
+/* Parse the amount, and point at the first bad character while it is invalid */
+static void
+checkwriter_window_set_amount (CheckwriterWindow *window, const char *text)
+{
+  GtkWidget *entry = window->check_amount_entry;
+  CheckAmountStatus status;
+  NumWordsLocale locale = window->layout ? window->layout->properties.words_locale
+                                         : NUM_WORDS_EN_US;
+  gsize error_pos = 0;
+  gint64 cents = 0;
+
+  status = check_amount_parse (text, &cents, &error_pos);
+
+  if (status == CHECK_AMOUNT_OK && check_data_set_amount_cents (&window->check_data, cents, locale) == 0)
+    {
+      gtk_widget_remove_css_class (entry, "error");
+      gtk_widget_set_tooltip_text (entry, NULL);
+      return;
+    }
+
+  window->check_data.amount[0] = '\0';
+  window->check_data.amount_in_words[0] = '\0';
+
+  /* An empty entry just leaves the amount blank */
+  if (status == CHECK_AMOUNT_ERROR_EMPTY)
+    {
+      gtk_widget_remove_css_class (entry, "error");
+      gtk_widget_set_tooltip_text (entry, NULL);
+    }
+  else
+    {
+      g_autofree char *message = NULL;
+
+      message = g_strdup_printf ("%s at character %" G_GSIZE_FORMAT,
+                                 check_amount_status_to_string (status), error_pos + 1);
+      gtk_widget_add_css_class (entry, "error");
+      gtk_widget_set_tooltip_text (entry, message);
+    }
+}
+
+/*
+ * Lay out the MICR line from the check number and the bank account in the
+ * settings. Problems with either are shown on the check number entry.
+ */
+static void
+checkwriter_window_set_micr (CheckwriterWindow *window, const char *check_number)
+{
+  GSettings *settings = check_properties_get_settings ();
+  g_autofree char *routing = g_settings_get_string (settings, "micr-routing-number");
+  g_autofree char *account = g_settings_get_string (settings, "micr-account-number");
+  GtkWidget *entry = window->check_number_entry;
+  CheckMicrStatus status;
+
+  status = check_data_set_micr (&window->check_data, check_number, routing, account);
+
+  if (status == CHECK_MICR_OK)
+    {
+      gtk_widget_remove_css_class (entry, "error");
+      gtk_widget_set_tooltip_text (entry, NULL);
+    }
+  else
+    {
+      gtk_widget_add_css_class (entry, "error");
+      gtk_widget_set_tooltip_text (entry, check_micr_status_to_string (status));
+    }
+}
+
+/* Read back everything that changed since the last frame, then update the preview */
+static void
+checkwriter_window_apply_updates (guint dirty, gpointer user_data)
+{
+  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
+
+  /* Swap in the settings' current snapshot, which does not read dconf */
+  if ((dirty & CHECKWRITER_UPDATE_LAYOUT) && window->profile_index < 0)
+    {
+      checkwriter_window_set_layout (window, check_layout_get_current ());
+    }
+
+  if (dirty & CHECKWRITER_UPDATE_FIELD (CHECK_FIELD_DATE))
+    {
+      GtkCalendar *calendar = GTK_CALENDAR (window->check_date_calendar);
+      int day = gtk_calendar_get_day (calendar);
+      int month = (1 + gtk_calendar_get_month (calendar));
+      int year = gtk_calendar_get_year (calendar);
+
+      g_snprintf (window->check_data.date, STRING_LEN, "%02d/%02d/%04d", month, day, year);
+      g_debug ("Date changed: %02d/%02d/%04d\n", month, day, year);
+    }
+
+  if (dirty & CHECKWRITER_UPDATE_FIELD (CHECK_FIELD_NAME))
+    {
+      const char *text = checkwriter_window_get_entry_text (window->pay_to_order_entry);
+
+      g_strlcpy (window->check_data.name, text, STRING_LEN);
+      checkwriter_window_update_payee_suggestions (window, text);
+      g_debug ("Pay to the order changed: %s", text);
+    }
+
+  if (dirty & CHECKWRITER_UPDATE_FIELD (CHECK_FIELD_AMOUNT))
+    {
+      const char *text = checkwriter_window_get_entry_text (window->check_amount_entry);
+
+      checkwriter_window_set_amount (window, text);
+      g_debug ("Amount changed: %s", window->check_data.amount);
+    }
+
+  if (dirty & CHECKWRITER_UPDATE_FIELD (CHECK_FIELD_MEMO))
+    {
+      const char *text = checkwriter_window_get_entry_text (window->check_memo_entry);
+
+      g_strlcpy (window->check_data.memo, text, STRING_LEN);
+      g_debug ("Memo changed: %s", text);
+    }
+
+  if (dirty & CHECKWRITER_UPDATE_FIELD (CHECK_FIELD_MICR))
+    {
+      const char *text = checkwriter_window_get_entry_text (window->check_number_entry);
+
+      checkwriter_window_set_micr (window, text);
+      g_debug ("MICR line changed: \"%s\"", window->check_data.micr);
+    }
+
+  checkwriter_window_update_preview (window);
+}
+
+/**
+ * Payee suggestions
+ */
+
+static void
+checkwriter_window_load_payees (CheckwriterWindow *window)
+{
+  g_autoptr (GError) error = NULL;
+  g_autofree char *path = NULL;
+
+  path = g_settings_get_string (check_properties_get_settings (), "payee-directory");
+
+  g_clear_pointer (&window->payees, check_payee_directory_free);
+  window->payees = check_payee_directory_open (path[0] != '\0' ? path : NULL, &error);
+
+  if (!window->payees)
+    {
+      g_warning ("Could not open payee directory: %s", error->message);
+    }
+}
+
+/* Suggest the first payees starting with `text`, or hide the suggestions */
+static void
+checkwriter_window_update_payee_suggestions (CheckwriterWindow *window, const char *text)
+{
+  GtkPopover *popover = GTK_POPOVER (window->payee_popover);
+  GtkListBox *list = GTK_LIST_BOX (window->payee_list);
+  guint first = 0, n_matches = 0;
+
+  if (window->payees && !window->payee_completing && text[0] != '\0')
+    {
+      n_matches = check_payee_directory_find_prefix (window->payees, text, &first);
+    }
+
+  if (n_matches == 1)
+    {
+      gsize length;
+      const char *name = check_payee_directory_get_name (window->payees, first, &length);
+
+      /* Nothing left to complete */
+      if (length == strlen (text) && g_ascii_strncasecmp (name, text, length) == 0)
+        {
+          n_matches = 0;
+        }
+    }
+
+  if (n_matches == 0)
+    {
+      gtk_popover_popdown (popover);
+      return;
+    }
+
+  gtk_list_box_remove_all (list);
+
+  for (guint i = first; i < first + MIN (n_matches, PAYEE_MAX_SUGGESTIONS); ++i)
+    {
+      gsize length;
+      const char *name = check_payee_directory_get_name (window->payees, i, &length);
+      g_autofree char *label_text = g_strndup (name, length);
+      GtkWidget *label = gtk_label_new (label_text);
+
+      gtk_label_set_xalign (GTK_LABEL (label), 0.0);
+      gtk_label_set_ellipsize (GTK_LABEL (label), PANGO_ELLIPSIZE_END);
+      gtk_list_box_append (list, label);
+    }
+
+  gtk_popover_popup (popover);
+
+  g_debug ("%s: %u payees start with \"%s\"", __func__, n_matches, text);
+}
+
+static void
+checkwriter_window_on_payee_activated (GtkListBox *list,
+                                       GtkListBoxRow *row,
+                                       gpointer user_data)
+{
+  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
+  GtkWidget *label = gtk_list_box_row_get_child (row);
+
+  (void) list;
+
+  /* Taking a suggestion should not suggest it again */
+  window->payee_completing = TRUE;
+  gtk_editable_set_text (GTK_EDITABLE (window->pay_to_order_entry),
+                         gtk_label_get_text (GTK_LABEL (label)));
+  checkwriter_update_scheduler_flush (&window->update_scheduler);
+  window->payee_completing = FALSE;
+
+  gtk_editable_set_position (GTK_EDITABLE (window->pay_to_order_entry), -1);
+  gtk_widget_grab_focus (window->pay_to_order_entry);
+  gtk_popover_popdown (GTK_POPOVER (window->payee_popover));
+}
+
+static gboolean
+checkwriter_window_on_payee_key_pressed (GtkEventControllerKey *controller,
+                                         guint keyval,
+                                         guint keycode,
+                                         GdkModifierType state,
+                                         gpointer user_data)
+{
+  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
+  GtkListBoxRow *row = NULL;
+
+  (void) controller;
+  (void) keycode;
+  (void) state;
+
+  if (!gtk_widget_get_visible (window->payee_popover))
+    {
+      return FALSE;
+    }
+
+  switch (keyval)
+    {
+    case GDK_KEY_Down:
+      /* Move into the suggestions */
+      row = gtk_list_box_get_row_at_index (GTK_LIST_BOX (window->payee_list), 0);
+
+      if (row)
+        {
+          gtk_widget_grab_focus (GTK_WIDGET (row));
+        }
+      return TRUE;
+
+    case GDK_KEY_Escape:
+      gtk_popover_popdown (GTK_POPOVER (window->payee_popover));
+      return TRUE;
+
+    default:
+      return FALSE;
+    }
+}
+
+static void
+checkwriter_window_init_payees (CheckwriterWindow *window)
+{
+  GtkEventController *controller = NULL;
+
+  window->payee_list = gtk_list_box_new ();
+  gtk_list_box_set_selection_mode (GTK_LIST_BOX (window->payee_list), GTK_SELECTION_BROWSE);
+
+  /* Not autohiding, so typing in the entry continues while it is shown */
+  window->payee_popover = gtk_popover_new ();
+  gtk_popover_set_child (GTK_POPOVER (window->payee_popover), window->payee_list);
+  gtk_popover_set_autohide (GTK_POPOVER (window->payee_popover), FALSE);
+  gtk_popover_set_has_arrow (GTK_POPOVER (window->payee_popover), FALSE);
+  gtk_popover_set_position (GTK_POPOVER (window->payee_popover), GTK_POS_BOTTOM);
+  gtk_widget_set_parent (window->payee_popover, window->pay_to_order_entry);
+
+  g_signal_connect (window->payee_list, "row-activated",
+                    G_CALLBACK (checkwriter_window_on_payee_activated), window);
+
+  controller = gtk_event_controller_key_new ();
+  g_signal_connect (controller, "key-pressed",
+                    G_CALLBACK (checkwriter_window_on_payee_key_pressed), window);
+  gtk_widget_add_controller (window->pay_to_order_entry, controller);
+
+  checkwriter_window_load_payees (window);
+}
+
+/**
+ * Profiles
+ */
+
+static void
+checkwriter_window_load_profiles (CheckwriterWindow *window)
+{
+  g_autoptr (GError) error = NULL;
+  g_autoptr (GtkStringList) names = NULL;
+
+  window->profiles = check_profile_store_open (NULL, &error);
+
+  if (!window->profiles)
+    {
+      g_warning ("Could not open layout profiles: %s", error->message);
+    }
+
+  /* The first entry follows the layout from the preferences */
+  names = gtk_string_list_new ((const char *[]){ "Preferences", NULL });
+
+  for (guint i = 0; window->profiles && i < check_profile_store_get_n_profiles (window->profiles); ++i)
+    {
+      gtk_string_list_append (names, check_profile_store_get_name (window->profiles, i));
+    }
+
+  gtk_drop_down_set_model (GTK_DROP_DOWN (window->profile_dropdown), G_LIST_MODEL (names));
+  gtk_widget_set_sensitive (window->profile_dropdown,
+                            g_list_model_get_n_items (G_LIST_MODEL (names)) > 1);
+}
+
+static void
+checkwriter_window_on_profile_selected (GObject *object,
+                                        GParamSpec *pspec,
+                                        gpointer user_data)
+{
+  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
+  guint selected = gtk_drop_down_get_selected (GTK_DROP_DOWN (object));
+  CheckProperties check_properties;
+
+  (void) pspec;
+
+  if (selected == 0 || selected == GTK_INVALID_LIST_POSITION || !window->profiles)
+    {
+      window->profile_index = -1;
+      checkwriter_window_set_layout (window, check_layout_get_current ());
+    }
+  else if (check_profile_store_get (window->profiles, selected - 1, &check_properties))
+    {
+      window->profile_index = selected - 1;
+      checkwriter_window_set_layout (window, check_layout_new (&check_properties));
+      g_debug ("%s: Switched to profile \"%s\"", __func__,
+               check_profile_store_get_name (window->profiles, window->profile_index));
+    }
+
+  checkwriter_window_update_preview (window);
+}
+
+/**
+ * Event handlers
+ */
+
+static void
+checkwriter_window_on_entry_changed (GtkEntry *entry, gpointer user_data)
+{
+  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
+  guint dirty = 0;
+
+  if (!window)
+    {
+      g_debug ("Window not allocated\n");
+      return;
+    }
+
+  /* The text is read back once per frame in checkwriter_window_apply_updates () */
+  if (entry == GTK_ENTRY (window->pay_to_order_entry))
+    {
+      dirty = CHECKWRITER_UPDATE_FIELD (CHECK_FIELD_NAME);
+    }
+  else if (entry == GTK_ENTRY (window->check_amount_entry))
+    {
+      dirty = CHECKWRITER_UPDATE_FIELD (CHECK_FIELD_AMOUNT);
+    }
+  else if (entry == GTK_ENTRY (window->check_memo_entry))
+    {
+      dirty = CHECKWRITER_UPDATE_FIELD (CHECK_FIELD_MEMO);
+    }
+  else if (entry == GTK_ENTRY (window->check_number_entry))
+    {
+      dirty = CHECKWRITER_UPDATE_FIELD (CHECK_FIELD_MICR);
+    }
+
+  checkwriter_update_scheduler_mark_dirty (&window->update_scheduler, dirty);
+}
+
+static void
+checkwriter_window_on_calendar_shown (GtkCalendar *self, gpointer user_data)
+{
+  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
+  GDateTime *now = NULL;
+
+  if (self == GTK_CALENDAR (window->check_date_calendar))
+    {
+      g_signal_emit_by_name (self, "day-selected");
+
+      now = g_date_time_new_now_local ();
+      gtk_calendar_select_day (self, now);
+      g_date_time_unref (now);
+    }
+}
+
+static void
+checkwriter_window_on_day_selected (GtkCalendar *self, gpointer user_data)
+{
+  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
+
+  if (self == GTK_CALENDAR (window->check_date_calendar))
+    {
+      checkwriter_update_scheduler_mark_dirty (&window->update_scheduler,
+                                               CHECKWRITER_UPDATE_FIELD (CHECK_FIELD_DATE));
+    }
+}
+
+/**
+ * Print and export jobs
+ *
+ * Printing runs asynchronously: GTK draws one page per main loop iteration
+ * and shows its own progress dialog. Exports render in worker threads, see
+ * check_export_async (). While a job runs, the batch and layout it uses are
+ * kept from changing under it.
+ */
+
+static void
+checkwriter_window_update_job_state (CheckwriterWindow *window)
+{
+  gboolean printing = (window->print_layout != NULL);
+  gboolean exporting = (window->export_cancellable != NULL);
+  guint n_checks = window->check_batch ? check_batch_get_n_checks (window->check_batch) : 0;
+
+  gtk_widget_set_sensitive (window->place_on_check_button, !printing);
+  gtk_widget_set_sensitive (window->print_template_button, !printing);
+  gtk_widget_set_sensitive (window->open_batch_button, !printing && !exporting);
+  gtk_widget_set_sensitive (window->clear_batch_button, !printing && !exporting && n_checks > 0);
+  gtk_widget_set_sensitive (window->export_button, !exporting);
+  gtk_widget_set_sensitive (window->cancel_export_button, exporting);
+}
+
+/* Open the journal that print and export jobs record their checks in */
+static gboolean
+checkwriter_window_ensure_journal (CheckwriterWindow *window,
+                                   GError **error)
+{
+  if (!window->journal)
+    {
+      window->journal = check_journal_open (NULL, CHECK_JOURNAL_GROUP_SIZE, error);
+    }
+
+  return window->journal != NULL;
+}
+
+/*
+ * Close the journal once no print job appends to it, which gives up its
+ * lock to other windows and to `checkwriter --render`
+ */
+static void
+checkwriter_window_release_journal (CheckwriterWindow *window)
+{
+  if (!window->print_layout)
+    {
+      g_clear_pointer (&window->journal, check_journal_free);
+    }
+}
+
+static void
+checkwriter_window_on_print_done (GtkPrintOperation *operation,
+                                  GtkPrintOperationResult result,
+                                  gpointer user_data)
+{
+  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
+
+  if (result == GTK_PRINT_OPERATION_RESULT_ERROR)
+    {
+      g_autoptr (GError) error = NULL;
+
+      gtk_print_operation_get_error (operation, &error);
+      g_warning ("Could not print: %s", error ? error->message : "unknown error");
+    }
+
+  g_debug ("%s: Print operation finished with result %d", __func__, result);
+
+  g_clear_pointer (&window->print_journaled, g_free);
+  g_clear_pointer (&window->print_layout, check_layout_unref);
+  checkwriter_window_release_journal (window);
+  checkwriter_window_update_job_state (window);
+
+  g_object_unref (operation);
+  g_object_unref (window);
+}
+
+/*
+ * The last pages of a job are journaled but not synced yet. Sync them after
+ * the last page is drawn, before GTK sends the job to the printer, and
+ * cancel the job if that fails.
+ */
+static void
+checkwriter_window_on_end_print (GtkPrintOperation *operation,
+                                 GtkPrintContext *context,
+                                 gpointer user_data)
+{
+  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
+  g_autoptr (GError) error = NULL;
+
+  (void) context;
+
+  if (!window->journal || !window->print_journaled || window->print_preview)
+    {
+      return;
+    }
+
+  if (!check_journal_sync (window->journal, &error))
+    {
+      g_warning ("Cancelled printing, the last checks could not be journaled: %s", error->message);
+      gtk_print_operation_cancel (operation);
+    }
+}
+
+static gboolean
+checkwriter_window_on_print_preview (GtkPrintOperation *operation,
+                                     GtkPrintOperationPreview *preview,
+                                     GtkPrintContext *context,
+                                     GtkWindow *parent,
+                                     gpointer user_data)
+{
+  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
+
+  (void) operation;
+  (void) preview;
+  (void) context;
+  (void) parent;
+
+  /* Nothing is issued by looking at it; GTK shows the preview */
+  window->print_preview = TRUE;
+
+  return FALSE;
+}
+
+static void
+checkwriter_window_run_print (CheckwriterWindow *window,
+                              GCallback begin_print,
+                              GCallback draw_page)
+{
+  GtkPrintOperation *print = gtk_print_operation_new ();
+  GtkPrintOperationResult res;
+
+  /* The job keeps printing with the layout it started with */
+  window->print_layout = check_layout_ref (window->layout);
+  window->print_layout_id = check_journal_get_layout_id (&window->print_layout->properties);
+  window->print_preview = FALSE;
+  checkwriter_window_update_job_state (window);
+
+  gtk_print_operation_set_allow_async (print, TRUE);
+  gtk_print_operation_set_show_progress (print, TRUE);
+
+  /* Both references are dropped in checkwriter_window_on_print_done () */
+  g_signal_connect (print, "begin_print", begin_print, window);
+  g_signal_connect (print, "draw_page", draw_page, window);
+  g_signal_connect (print, "end_print", G_CALLBACK (checkwriter_window_on_end_print), window);
+  g_signal_connect (print, "preview", G_CALLBACK (checkwriter_window_on_print_preview), window);
+  g_signal_connect (print, "done", G_CALLBACK (checkwriter_window_on_print_done), g_object_ref (window));
+
+  res = gtk_print_operation_run (print, GTK_PRINT_OPERATION_ACTION_PRINT_DIALOG, GTK_WINDOW (window), NULL);
+
+  if (res == GTK_PRINT_OPERATION_RESULT_ERROR)
+    {
+      g_debug ("Error in print operation\n");
+    }
+}
+
+static void
+checkwriter_window_on_export_progress (guint n_done, guint n_total, gpointer user_data)
+{
+  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
+  g_autofree char *text = NULL;
+
+  if (!window->export_cancellable)
+    {
+      return;
+    }
+
+  text = g_strdup_printf ("%u of %u checks", n_done, n_total);
+  gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (window->export_progress),
+                                 n_total > 0 ? (double) n_done / n_total : 1.0);
+  gtk_progress_bar_set_text (GTK_PROGRESS_BAR (window->export_progress), text);
+}
+
+static void
+checkwriter_window_on_export_finished (GObject *source,
+                                       GAsyncResult *result,
+                                       gpointer user_data)
+{
+  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
+  g_autoptr (GError) error = NULL;
+
+  (void) source;
+
+  if (check_export_finish (result, &error))
+    {
+      g_debug ("%s: Export done", __func__);
+    }
+  else if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      g_debug ("%s: Export cancelled", __func__);
+    }
+  else
+    {
+      g_warning ("Could not export checks: %s", error->message);
+    }
+
+  g_clear_pointer (&window->export_batch, check_batch_free);
+
+  /* Still shown, unless the window was closed meanwhile */
+  if (window->export_cancellable)
+    {
+      g_clear_object (&window->export_cancellable);
+      gtk_widget_set_visible (window->export_progress, FALSE);
+      checkwriter_window_update_job_state (window);
+    }
+
+  g_object_unref (window);
+}
+
+/* The check being edited as a batch of one, or NULL without a valid amount and MICR line */
+static CheckBatch *
+checkwriter_window_new_check_batch (CheckwriterWindow *window)
+{
+  CheckBatch *batch = NULL;
+  gint64 cents = 0;
+
+  if (check_amount_parse (window->check_data.amount, &cents, NULL) != CHECK_AMOUNT_OK)
+    {
+      return NULL;
+    }
 
-  CheckProperties check_properties;
-  CheckData check_data;
-};
+  batch = check_batch_new ();
 
-G_DEFINE_FINAL_TYPE (CheckwriterWindow, checkwriter_window, ADW_TYPE_APPLICATION_WINDOW)
+  if (!check_batch_append (batch, window->check_data.date, window->check_data.name,
+                           cents, window->check_data.memo, window->check_data.check_number,
+                           window->check_data.routing, window->check_data.account))
+    {
+      g_clear_pointer (&batch, check_batch_free);
+    }
 
-/**
- * Event handlers
- */
+  return batch;
+}
 
+/* Journal the loaded batch, or else the check being edited, and export it to `path` */
 static void
-checkwriter_window_on_entry_changed (GtkEntry *entry, gpointer user_data)
+checkwriter_window_export_checks (CheckwriterWindow *window, const char *path)
 {
-  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
-  const gchar *text = gtk_editable_get_text (GTK_EDITABLE (entry));
+  g_autoptr (GError) error = NULL;
+  const CheckBatch *batch = NULL;
 
-  if (!window)
+  if (window->export_cancellable)
     {
-      g_debug ("Window not allocated\n");
       return;
     }
 
-  if (!text)
+  /* The loaded batch, or else the check being edited */
+  if (window->check_batch && check_batch_get_n_checks (window->check_batch) > 0)
     {
-      g_debug ("No text allocated");
-      return;
+      batch = window->check_batch;
+    }
+  else
+    {
+      window->export_batch = checkwriter_window_new_check_batch (window);
+      batch = window->export_batch;
     }
 
-  if (entry == GTK_ENTRY (window->pay_to_order_entry))
+  if (!batch)
     {
-      g_strlcpy (window->check_data.name, text, STRING_LEN);
-      g_debug ("Pay to the order changed: %s", text);
+      g_warning ("Enter a valid amount and MICR line before exporting");
+      return;
     }
-  else if (entry == GTK_ENTRY (window->check_amount_entry))
+
+  /* Exported checks are issued like printed ones, see check_export_journal () */
+  if (!checkwriter_window_ensure_journal (window, &error) ||
+      !check_export_journal (window->journal, &window->layout->properties, batch, &error))
     {
-      /* Attempt to parse the dollar and cents value from entry */
-      guint dollars = 0, cents = 0;
-      gint written = 0;
+      g_warning ("Not exporting without a journal of issued checks: %s", error->message);
+      checkwriter_window_release_journal (window);
+      g_clear_pointer (&window->export_batch, check_batch_free);
+      return;
+    }
 
-      sscanf (text, "%'u.%u", &dollars, &cents);
+  checkwriter_window_release_journal (window);
 
-      /* Write the parsed dollar amount */
-      g_snprintf (window->check_data.amount, STRING_LEN, "%'u.%02u", dollars, cents);
+  window->export_cancellable = g_cancellable_new ();
 
-      /* Write the amount in words */
-      do
-        {
-          gchar *dst = window->check_data.amount_in_words;
-          written = num_to_words (dst, STRING_LEN, dollars);
-          dst[0] = toupper (dst[0]);
+  gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (window->export_progress), 0.0);
+  gtk_progress_bar_set_text (GTK_PROGRESS_BAR (window->export_progress), "Starting export…");
+  gtk_widget_set_visible (window->export_progress, TRUE);
+  checkwriter_window_update_job_state (window);
 
-          g_assert (written >= 0);
+  /* The window reference is dropped in checkwriter_window_on_export_finished () */
+  check_export_async (path, window->layout, batch, EXPORT_DEFAULT_DPI, CHECK_WRITE, 0,
+                      window->export_cancellable,
+                      checkwriter_window_on_export_progress, window,
+                      checkwriter_window_on_export_finished, g_object_ref (window));
+}
 
-          /* Write centes */
-          g_snprintf (dst + written, STRING_LEN - written, " and %02u/100", cents);
-        }
-      while (0);
+static void
+checkwriter_window_on_export_file_chosen (GObject *source,
+                                          GAsyncResult *result,
+                                          gpointer user_data)
+{
+  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
+  g_autoptr (GFile) file = NULL;
+  g_autoptr (GError) error = NULL;
+  g_autofree char *path = NULL;
 
-      g_debug ("Amount changed: %s", window->check_data.amount);
+  file = gtk_file_dialog_save_finish (GTK_FILE_DIALOG (source), result, &error);
+  path = file ? g_file_get_path (file) : NULL;
+
+  if (!path || window->export_cancellable)
+    {
+      g_debug ("No export file selected: %s", error ? error->message : "");
     }
-  else if (entry == GTK_ENTRY (window->check_memo_entry))
+  else if (check_export_format_from_path (path) == CHECK_EXPORT_FORMAT_UNKNOWN)
     {
-      g_strlcpy (window->check_data.memo, text, STRING_LEN);
-      g_debug ("Memo changed: %s", text);
+      g_warning ("Unknown export format: %s (expected .pdf or .png)", path);
     }
-
-  if (window->check_preview_area)
+  else if (window->check_batch && window->check_batch_n_flagged > 0)
+    {
+      checkwriter_window_confirm_duplicates (window, path);
+    }
+  else
     {
-      gtk_widget_queue_draw (window->check_preview_area);
+      checkwriter_window_export_checks (window, path);
     }
+
+  g_object_unref (window);
 }
 
 static void
-checkwriter_window_on_calendar_shown (GtkCalendar *self, gpointer user_data)
+checkwriter_window_on_export_clicked (GtkWidget *button,
+                                      gpointer user_data)
 {
   CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
-  GDateTime *now = NULL;
+  g_autoptr (GtkFileDialog) dialog = NULL;
+  g_autoptr (GtkFileFilter) pdf_filter = NULL;
+  g_autoptr (GtkFileFilter) png_filter = NULL;
+  g_autoptr (GListStore) filters = NULL;
 
-  if (self == GTK_CALENDAR (window->check_date_calendar))
-    {
-      g_signal_emit_by_name (self, "day-selected");
+  (void) button;
 
-      now = g_date_time_new_now_local ();
-      gtk_calendar_select_day (self, now);
-      g_date_time_unref (now);
-    }
-}
+  /* Export what is typed, even if no frame was drawn since */
+  checkwriter_update_scheduler_flush (&window->update_scheduler);
 
-static void
-checkwriter_window_on_day_selected (GtkCalendar *self, gpointer user_data)
-{
-  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
+  pdf_filter = gtk_file_filter_new ();
+  gtk_file_filter_set_name (pdf_filter, "PDF documents");
+  gtk_file_filter_add_suffix (pdf_filter, "pdf");
 
-  if (self == GTK_CALENDAR (window->check_date_calendar))
-    {
-      int day = gtk_calendar_get_day (self);
-      int month = (1 + gtk_calendar_get_month (self));
-      int year = gtk_calendar_get_year (self);
+  png_filter = gtk_file_filter_new ();
+  gtk_file_filter_set_name (png_filter, "PNG images");
+  gtk_file_filter_add_suffix (png_filter, "png");
 
-      g_snprintf (window->check_data.date, STRING_LEN, "%02d/%02d/%04d", month, day, year);
-      g_debug ("Date changed: %02d/%02d/%04d\n", month, day, year);
-    }
+  filters = g_list_store_new (GTK_TYPE_FILE_FILTER);
+  g_list_store_append (filters, pdf_filter);
+  g_list_store_append (filters, png_filter);
 
-  if (window->check_preview_area)
-    {
-      gtk_widget_queue_draw (window->check_preview_area);
-    }
+  dialog = gtk_file_dialog_new ();
+  gtk_file_dialog_set_title (dialog, "Export Checks");
+  gtk_file_dialog_set_initial_name (dialog, "checks.pdf");
+  gtk_file_dialog_set_filters (dialog, G_LIST_MODEL (filters));
+
+  gtk_file_dialog_save (dialog, GTK_WINDOW (window), NULL,
+                        checkwriter_window_on_export_file_chosen,
+                        g_object_ref (window));
 }
 
 static void
-checkwriter_window_draw_check_preview (GtkDrawingArea *area,
-                                       cairo_t *cr,
-                                       int width,
-                                       int height,
-                                       gpointer user_data)
+checkwriter_window_on_cancel_export_clicked (GtkWidget *button,
+                                             gpointer user_data)
 {
-  CheckwriterWindow *window = NULL;
-  cairo_surface_t *surface = NULL;
-  double x_scale, y_scale, x_dpi, y_dpi;
-  DisplayProperties display;
-  CheckProperties *check_properties = NULL;
-  CheckData *check_data = NULL;
+  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
 
-  (void) area;
+  (void) button;
 
-  window = CHECKWRITER_WINDOW (user_data);
+  if (window->export_cancellable)
+    {
+      g_cancellable_cancel (window->export_cancellable);
+    }
+}
 
-  /* Get the target surface */
-  surface = cairo_get_target (cr);
+/**
+ * Printing functions (Regular, Fill check)
+ */
 
-  /* Get the device scale (this accounts for any scaling on HiDPI displays) */
-  cairo_surface_get_device_scale (surface, &x_scale, &y_scale);
+/*
+ * Journal the check on page `page_nr` before it is drawn. GTK may draw a page
+ * more than once, e.g. for copies, but the check is only issued once. If the
+ * journal cannot take it, the job is cancelled and nothing is printed.
+ */
+static gboolean
+checkwriter_window_journal_page (CheckwriterWindow *window,
+                                 GtkPrintOperation *operation,
+                                 int page_nr,
+                                 const CheckData *check_data)
+{
+  g_autoptr (GError) error = NULL;
+  guint8 bit = (guint8) (1u << (page_nr % 8));
+  gint64 cents;
 
-  x_dpi = DEFAULT_DPI * x_scale;
-  y_dpi = DEFAULT_DPI * y_scale;
+  g_return_val_if_fail (page_nr >= 0 && page_nr < window->print_n_pages, FALSE);
 
-  display.width = width;
-  display.height = height;
-  display.x_dpi = x_dpi;
-  display.y_dpi = y_dpi;
+  if (window->print_journaled[page_nr / 8] & bit)
+    {
+      return TRUE;
+    }
 
-  check_properties = &window->check_properties;
+  if (check_amount_parse (check_data->amount, &cents, NULL) != CHECK_AMOUNT_OK)
+    {
+      cents = -1;
+    }
 
-  /* Reload settings if necessary */
-  if (check_properties_settings_changed ())
+  if (!check_journal_append (window->journal, check_data, cents, window->print_layout_id, &error))
     {
-      check_properties_load (check_properties);
+      g_warning ("Cancelled printing, check %d could not be journaled: %s", page_nr + 1, error->message);
+      gtk_print_operation_cancel (operation);
+      return FALSE;
     }
 
-  check_data = &window->check_data;
+  window->print_journaled[page_nr / 8] |= bit;
 
-  render_check (cr, &display, check_properties, check_data, CHECK_PREVIEW_ONLY);
+  return TRUE;
 }
 
-/**
- * Printing functions (Regular, Fill check)
- */
-
 static void
 checkwrter_window_on_draw_page (GtkPrintOperation *operation,
                                 GtkPrintContext *context,
@@ -209,11 +1018,9 @@ checkwrter_window_on_draw_page (GtkPrintOperation *operation,
   cairo_t *cr = NULL;
   double x_dpi, y_dpi, width, height;
   DisplayProperties display;
-  CheckProperties *check_properties = NULL;
-  CheckData *check_data = NULL;
-
-  (void) page_nr;
-  (void) operation;
+  const CheckProperties *check_properties = NULL;
+  const CheckData *check_data = NULL;
+  CheckData page_data;
 
   window = CHECKWRITER_WINDOW (user_data);
 
@@ -230,12 +1037,27 @@ checkwrter_window_on_draw_page (GtkPrintOperation *operation,
   display.x_dpi = x_dpi;
   display.y_dpi = y_dpi;
 
-  check_properties = &window->check_properties;
-  check_data = &window->check_data;
+  check_properties = &window->print_layout->properties;
+
+  /* Each page of a batch job is one record of the batch */
+  if (window->check_batch && check_batch_get (window->check_batch, page_nr, check_properties->words_locale, &page_data))
+    {
+      check_data = &page_data;
+    }
+  else
+    {
+      check_data = &window->check_data;
+    }
+
+  if (!window->print_preview && !checkwriter_window_journal_page (window, operation, page_nr, check_data))
+    {
+      return;
+    }
 
-  render_check (cr, &display, check_properties, check_data, CHECK_WRITE);
+  check_render_plan_update (&window->print_plan, cr, &display, check_properties, CHECK_WRITE);
+  render_check_plan (cr, &window->print_plan, check_data);
 
-  g_debug ("Done rendering page");
+  g_debug ("Done rendering page %d", page_nr);
 }
 
 static void
@@ -243,15 +1065,63 @@ checkwriter_window_on_begin_print (GtkPrintOperation *operation,
                                    GtkPrintContext *context,
                                    gpointer user_data)
 {
+  CheckwriterWindow *window = NULL;
+  int n_pages = 1;
+
   // Unused variables
   (void) context;
-  (void) user_data;
+
+  window = CHECKWRITER_WINDOW (user_data);
+
+  if (window->check_batch && check_batch_get_n_checks (window->check_batch) > 0)
+    {
+      n_pages = check_batch_get_n_checks (window->check_batch);
+    }
+
+  g_clear_pointer (&window->print_journaled, g_free);
+  window->print_journaled = g_new0 (guint8, (n_pages + 7) / 8);
+  window->print_n_pages = n_pages;
 
   // Inform the print operation how many pages to expect.
+  gtk_print_operation_set_n_pages (operation, n_pages);
+  g_debug ("Print operation begins with %d pages\n", n_pages);
+}
+
+static void
+checkwriter_window_on_begin_print_template (GtkPrintOperation *operation,
+                                            GtkPrintContext *context,
+                                            gpointer user_data)
+{
+  // Unused variables
+  (void) context;
+  (void) user_data;
+
+  // A template is always a single page
   gtk_print_operation_set_n_pages (operation, 1);
   g_debug ("Print operation begins\n");
 }
 
+static void
+checkwriter_window_print_checks (CheckwriterWindow *window)
+{
+  g_autoptr (GError) error = NULL;
+
+  if (window->print_layout)
+    {
+      return;
+    }
+
+  if (!checkwriter_window_ensure_journal (window, &error))
+    {
+      g_warning ("Not printing without a journal of issued checks: %s", error->message);
+      return;
+    }
+
+  checkwriter_window_run_print (window,
+                                G_CALLBACK (checkwriter_window_on_begin_print),
+                                G_CALLBACK (checkwrter_window_on_draw_page));
+}
+
 static void
 checkwriter_window_on_print_check_clicked (GtkWidget *button,
                                            gpointer user_data)
@@ -261,20 +1131,16 @@ checkwriter_window_on_print_check_clicked (GtkWidget *button,
   (void) button;
   window = CHECKWRITER_WINDOW (user_data);
 
-  GtkPrintOperation *print = gtk_print_operation_new ();
-
-  g_signal_connect (print, "begin_print", G_CALLBACK (checkwriter_window_on_begin_print), user_data);
-  g_signal_connect (print, "draw_page", G_CALLBACK (checkwrter_window_on_draw_page), user_data);
+  /* Print what is typed, even if no frame was drawn since */
+  checkwriter_update_scheduler_flush (&window->update_scheduler);
 
-  GtkPrintOperationResult res = gtk_print_operation_run (
-      print, GTK_PRINT_OPERATION_ACTION_PRINT_DIALOG, GTK_WINDOW (window), NULL);
-
-  if (res == GTK_PRINT_OPERATION_RESULT_ERROR)
+  if (window->check_batch && window->check_batch_n_flagged > 0)
     {
-      g_debug ("Error in print operation\n");
+      checkwriter_window_confirm_duplicates (window, NULL);
+      return;
     }
 
-  g_object_unref (print);
+  checkwriter_window_print_checks (window);
 }
 
 /**
@@ -291,7 +1157,7 @@ checkwrter_window_on_draw_template_page (GtkPrintOperation *operation,
   cairo_t *cr = NULL;
   double x_dpi, y_dpi, width, height;
   DisplayProperties display;
-  CheckProperties *check_properties = NULL;
+  const CheckProperties *check_properties = NULL;
   CheckData check_data;
 
   (void) page_nr;
@@ -312,7 +1178,7 @@ checkwrter_window_on_draw_template_page (GtkPrintOperation *operation,
   display.x_dpi = x_dpi;
   display.y_dpi = y_dpi;
 
-  check_properties = &window->check_properties;
+  check_properties = &window->print_layout->properties;
 
   check_data_set_sample (&check_data);
   render_check (cr, &display, check_properties, &check_data, CHECK_TEMPLATE);
@@ -328,31 +1194,270 @@ checkwriter_window_on_print_template_clicked (GtkWidget *button,
   (void) button;
   window = CHECKWRITER_WINDOW (user_data);
 
-  GtkPrintOperation *print = gtk_print_operation_new ();
+  checkwriter_window_run_print (window,
+                                G_CALLBACK (checkwriter_window_on_begin_print_template),
+                                G_CALLBACK (checkwrter_window_on_draw_template_page));
+}
+
+/**
+ * Batch functions
+ */
+
+static void
+checkwriter_window_update_batch_status (CheckwriterWindow *window)
+{
+  g_autofree char *status = NULL;
+  guint n_checks = window->check_batch ? check_batch_get_n_checks (window->check_batch) : 0;
+
+  if (n_checks > 0 && window->check_batch_n_flagged > 0)
+    {
+      status = g_strdup_printf ("%u checks in batch, %u possibly paid twice",
+                                n_checks, window->check_batch_n_flagged);
+    }
+  else if (n_checks > 0)
+    {
+      status = g_strdup_printf ("%u checks in batch", n_checks);
+    }
+  else
+    {
+      status = g_strdup ("No batch loaded");
+    }
 
-  g_signal_connect (print, "begin_print", G_CALLBACK (checkwriter_window_on_begin_print), user_data);
-  g_signal_connect (print, "draw_page", G_CALLBACK (checkwrter_window_on_draw_template_page), user_data);
+  gtk_label_set_text (GTK_LABEL (window->batch_status_label), status);
+  checkwriter_window_update_job_state (window);
+}
 
-  GtkPrintOperationResult res = gtk_print_operation_run (
-      print, GTK_PRINT_OPERATION_ACTION_PRINT_DIALOG, GTK_WINDOW (window), NULL);
+static void
+checkwriter_window_on_duplicates_confirmed (GObject *source,
+                                            GAsyncResult *result,
+                                            gpointer user_data)
+{
+  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
+  const char *response = adw_alert_dialog_choose_finish (ADW_ALERT_DIALOG (source), result);
+  const char *export_path = g_object_get_data (source, "export-path");
 
-  if (res == GTK_PRINT_OPERATION_RESULT_ERROR)
+  if (g_strcmp0 (response, "continue") != 0)
     {
-      g_debug ("Error in print operation\n");
+      g_debug ("%s: Not issuing a batch with possible duplicate payments", __func__);
+    }
+  else if (export_path)
+    {
+      checkwriter_window_export_checks (window, export_path);
+    }
+  else
+    {
+      checkwriter_window_print_checks (window);
+    }
+
+  g_object_unref (window);
+}
+
+/*
+ * List the checks of the batch that repeat another one, or one already issued,
+ * and print the batch, or export it to `export_path`, only once confirmed.
+ * The command line refuses them unless --allow-duplicates is passed.
+ */
+static void
+checkwriter_window_confirm_duplicates (CheckwriterWindow *window,
+                                       const char *export_path)
+{
+  const CheckBatch *batch = window->check_batch;
+  g_autoptr (GString) body = g_string_new (NULL);
+  AdwDialog *dialog = NULL;
+  guint n_listed = 0;
+
+  for (guint i = 0; i < check_batch_get_n_checks (batch) && n_listed < DUPLICATES_MAX_LISTED; ++i)
+    {
+      CheckBatchFlags flags = check_batch_get_flags (batch, i);
+      CheckData check_data;
+
+      /* The amount in words is not listed, its language does not matter */
+      if (flags == 0 || !check_batch_get (batch, i, NUM_WORDS_EN_US, &check_data))
+        {
+          continue;
+        }
+
+      g_string_append_printf (body, "Check %u to %s for %s dated %s %s\n", i + 1, check_data.name,
+                              check_data.amount, check_data.date,
+                              (flags & CHECK_BATCH_ISSUED) ? "was already issued" : "repeats an earlier check");
+      ++n_listed;
+    }
+
+  if (window->check_batch_n_flagged > n_listed)
+    {
+      g_string_append_printf (body, "and %u more\n", window->check_batch_n_flagged - n_listed);
+    }
+
+  g_string_append (body, "\nIssue these checks anyway?");
+
+  dialog = adw_alert_dialog_new ("Possible Duplicate Payments", body->str);
+  adw_alert_dialog_add_responses (ADW_ALERT_DIALOG (dialog),
+                                  "cancel", "_Cancel",
+                                  "continue", export_path ? "_Export Anyway" : "_Print Anyway",
+                                  NULL);
+  adw_alert_dialog_set_response_appearance (ADW_ALERT_DIALOG (dialog), "continue", ADW_RESPONSE_DESTRUCTIVE);
+  adw_alert_dialog_set_default_response (ADW_ALERT_DIALOG (dialog), "cancel");
+  adw_alert_dialog_set_close_response (ADW_ALERT_DIALOG (dialog), "cancel");
+  g_object_set_data_full (G_OBJECT (dialog), "export-path", g_strdup (export_path), g_free);
+
+  /* The window reference is dropped in checkwriter_window_on_duplicates_confirmed () */
+  adw_alert_dialog_choose (ADW_ALERT_DIALOG (dialog), GTK_WIDGET (window), NULL,
+                           checkwriter_window_on_duplicates_confirmed, g_object_ref (window));
+}
+
+static void
+checkwriter_window_on_batch_file_opened (GObject *source,
+                                         GAsyncResult *result,
+                                         gpointer user_data)
+{
+  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
+  g_autoptr (GFile) file = NULL;
+  g_autoptr (GError) error = NULL;
+  g_autofree char *path = NULL;
+  CheckBatch *batch = NULL;
+
+  file = gtk_file_dialog_open_finish (GTK_FILE_DIALOG (source), result, &error);
+
+  if (!file)
+    {
+      g_debug ("No batch file selected: %s", error ? error->message : "");
+      g_object_unref (window);
+      return;
+    }
+
+  path = g_file_get_path (file);
+  batch = path ? check_batch_load_csv (path, &error) : NULL;
+
+  if (!batch)
+    {
+      g_warning ("Could not load batch: %s", error ? error->message : "invalid path");
+    }
+  else if (window->print_layout || window->export_cancellable)
+    {
+      /* The dialog was opened before the job started */
+      g_warning ("Not replacing the batch while it is printed or exported");
+      check_batch_free (batch);
+    }
+  else
+    {
+      g_autoptr (CheckLedger) ledger = check_ledger_open (NULL, &error);
+
+      /* Still catch the checks repeated within the batch */
+      if (!ledger)
+        {
+          g_warning ("Not checking the batch against issued checks: %s", error->message);
+        }
+
+      g_clear_pointer (&window->check_batch, check_batch_free);
+      window->check_batch = batch;
+      window->check_batch_n_flagged = check_batch_find_duplicates (batch, ledger);
+
+      if (window->check_batch_n_flagged > 0)
+        {
+          g_debug ("%s: %u checks of %s have the payee, amount and date of another check",
+                   __func__, window->check_batch_n_flagged, path);
+        }
     }
 
-  g_object_unref (print);
+  checkwriter_window_update_batch_status (window);
+  g_object_unref (window);
+}
+
+static void
+checkwriter_window_on_open_batch_clicked (GtkWidget *button,
+                                          gpointer user_data)
+{
+  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
+  g_autoptr (GtkFileDialog) dialog = NULL;
+  g_autoptr (GtkFileFilter) filter = NULL;
+  g_autoptr (GListStore) filters = NULL;
+
+  (void) button;
+
+  filter = gtk_file_filter_new ();
+  gtk_file_filter_set_name (filter, "CSV files");
+  gtk_file_filter_add_suffix (filter, "csv");
+
+  filters = g_list_store_new (GTK_TYPE_FILE_FILTER);
+  g_list_store_append (filters, filter);
+
+  dialog = gtk_file_dialog_new ();
+  gtk_file_dialog_set_title (dialog, "Open Check Batch");
+  gtk_file_dialog_set_filters (dialog, G_LIST_MODEL (filters));
+
+  gtk_file_dialog_open (dialog, GTK_WINDOW (window), NULL,
+                        checkwriter_window_on_batch_file_opened,
+                        g_object_ref (window));
+}
+
+static void
+checkwriter_window_on_clear_batch_clicked (GtkWidget *button,
+                                           gpointer user_data)
+{
+  CheckwriterWindow *window = CHECKWRITER_WINDOW (user_data);
+
+  (void) button;
+
+  g_clear_pointer (&window->check_batch, check_batch_free);
+  window->check_batch_n_flagged = 0;
+  checkwriter_window_update_batch_status (window);
 }
 
 /**
  * Window and Application Initializations
  */
 
+static void
+checkwriter_window_dispose (GObject *object)
+{
+  CheckwriterWindow *self = CHECKWRITER_WINDOW (object);
+
+  g_signal_handlers_disconnect_by_data (check_properties_get_settings (), self);
+
+  /* Before the preview that supplies the frame clock goes away */
+  checkwriter_update_scheduler_clear (&self->update_scheduler);
+
+  g_clear_pointer (&self->payee_popover, gtk_widget_unparent);
+
+  /* A running export finishes without touching the widgets */
+  if (self->export_cancellable)
+    {
+      g_cancellable_cancel (self->export_cancellable);
+      g_clear_object (&self->export_cancellable);
+    }
+
+  G_OBJECT_CLASS (checkwriter_window_parent_class)->dispose (object);
+}
+
+static void
+checkwriter_window_finalize (GObject *object)
+{
+  CheckwriterWindow *self = CHECKWRITER_WINDOW (object);
+
+  g_clear_pointer (&self->check_batch, check_batch_free);
+  g_clear_pointer (&self->export_batch, check_batch_free);
+  g_clear_pointer (&self->layout, check_layout_unref);
+  g_clear_pointer (&self->print_layout, check_layout_unref);
+  g_clear_pointer (&self->profiles, check_profile_store_free);
+  g_clear_pointer (&self->payees, check_payee_directory_free);
+  g_clear_pointer (&self->print_journaled, g_free);
+  g_clear_pointer (&self->journal, check_journal_free);
+  check_render_plan_clear (&self->print_plan);
+
+  G_OBJECT_CLASS (checkwriter_window_parent_class)->finalize (object);
+}
+
 static void
 checkwriter_window_class_init (CheckwriterWindowClass *klass)
 {
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
 
+  object_class->dispose = checkwriter_window_dispose;
+  object_class->finalize = checkwriter_window_finalize;
+
+  g_type_ensure (CHECKWRITER_TYPE_CHECK_PREVIEW);
+
   gtk_widget_class_set_template_from_resource (widget_class, "/at/shafq/checkwriter/checkwriter-window.ui");
 
   /* Bind the variables to the template */
@@ -360,9 +1465,17 @@ checkwriter_window_class_init (CheckwriterWindowClass *klass)
   gtk_widget_class_bind_template_child (widget_class, CheckwriterWindow, pay_to_order_entry);
   gtk_widget_class_bind_template_child (widget_class, CheckwriterWindow, check_amount_entry);
   gtk_widget_class_bind_template_child (widget_class, CheckwriterWindow, check_memo_entry);
+  gtk_widget_class_bind_template_child (widget_class, CheckwriterWindow, check_number_entry);
   gtk_widget_class_bind_template_child (widget_class, CheckwriterWindow, place_on_check_button);
   gtk_widget_class_bind_template_child (widget_class, CheckwriterWindow, print_template_button);
-  gtk_widget_class_bind_template_child (widget_class, CheckwriterWindow, check_preview_area);
+  gtk_widget_class_bind_template_child (widget_class, CheckwriterWindow, open_batch_button);
+  gtk_widget_class_bind_template_child (widget_class, CheckwriterWindow, clear_batch_button);
+  gtk_widget_class_bind_template_child (widget_class, CheckwriterWindow, batch_status_label);
+  gtk_widget_class_bind_template_child (widget_class, CheckwriterWindow, export_button);
+  gtk_widget_class_bind_template_child (widget_class, CheckwriterWindow, cancel_export_button);
+  gtk_widget_class_bind_template_child (widget_class, CheckwriterWindow, export_progress);
+  gtk_widget_class_bind_template_child (widget_class, CheckwriterWindow, check_preview);
+  gtk_widget_class_bind_template_child (widget_class, CheckwriterWindow, profile_dropdown);
 }
 
 static void
@@ -372,8 +1485,13 @@ checkwriter_window_init (CheckwriterWindow *self)
   gtk_widget_init_template (GTK_WIDGET (self));
 
   /* Initialize check properties */
-  check_properties_load (&self->check_properties);
+  self->layout = check_layout_get_current ();
+  self->profile_index = -1;
   check_data_init (&self->check_data);
+  check_render_plan_init (&self->print_plan);
+
+  checkwriter_update_scheduler_init (&self->update_scheduler, self->check_preview,
+                                     checkwriter_window_apply_updates, self);
 
   /* Connect calendar "day-selected" signal */
   g_signal_connect (self->check_date_calendar, "day-selected", G_CALLBACK (checkwriter_window_on_day_selected), self);
@@ -385,10 +1503,22 @@ checkwriter_window_init (CheckwriterWindow *self)
   g_signal_connect (self->pay_to_order_entry, "changed", G_CALLBACK (checkwriter_window_on_entry_changed), self);
   g_signal_connect (self->check_amount_entry, "changed", G_CALLBACK (checkwriter_window_on_entry_changed), self);
   g_signal_connect (self->check_memo_entry, "changed", G_CALLBACK (checkwriter_window_on_entry_changed), self);
+  g_signal_connect (self->check_number_entry, "changed", G_CALLBACK (checkwriter_window_on_entry_changed), self);
 
-  /* Connect drawing area update function */
-  gtk_drawing_area_set_draw_func (GTK_DRAWING_AREA (self->check_preview_area),
-                                  checkwriter_window_draw_check_preview, self, NULL);
+  /* The routing and account numbers come from the settings */
+  checkwriter_update_scheduler_mark_dirty (&self->update_scheduler, CHECKWRITER_UPDATE_FIELD (CHECK_FIELD_MICR));
+
+  /* Suggest payees from the directory */
+  checkwriter_window_init_payees (self);
+
+  /* Select the check stock */
+  checkwriter_window_load_profiles (self);
+  g_signal_connect (self->profile_dropdown, "notify::selected",
+                    G_CALLBACK (checkwriter_window_on_profile_selected), self);
+
+  /* Follow layout changes, e.g. from the preferences window */
+  g_signal_connect (check_properties_get_settings (), "changed",
+                    G_CALLBACK (checkwriter_window_on_settings_changed), self);
 
   /* Connect button events for printing */
   g_signal_connect (self->place_on_check_button, "clicked", G_CALLBACK (checkwriter_window_on_print_check_clicked),
@@ -396,4 +1526,21 @@ checkwriter_window_init (CheckwriterWindow *self)
 
   g_signal_connect (self->print_template_button, "clicked", G_CALLBACK (checkwriter_window_on_print_template_clicked),
                     self);
+
+  /* Connect button events for batch printing */
+  g_signal_connect (self->open_batch_button, "clicked", G_CALLBACK (checkwriter_window_on_open_batch_clicked),
+                    self);
+
+  g_signal_connect (self->clear_batch_button, "clicked", G_CALLBACK (checkwriter_window_on_clear_batch_clicked),
+                    self);
+
+  /* Connect button events for exporting */
+  g_signal_connect (self->export_button, "clicked", G_CALLBACK (checkwriter_window_on_export_clicked),
+                    self);
+
+  g_signal_connect (self->cancel_export_button, "clicked", G_CALLBACK (checkwriter_window_on_cancel_export_clicked),
+                    self);
+
+  checkwriter_window_update_batch_status (self);
+  checkwriter_window_update_preview (self);
 }
@@ -0,0 +1,439 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+# SPDX-License-Identifier: GPL-3.0-or-later
+
+"""
+Writes the phrase tables num-to-words.c spells numbers with.
+
+A number is written as up to four 3-digit groups (units, thousands,
+millions, billions), most significant first. For each locale and each
+group, the tables give the phrase for a group of 0, the phrase for a group
+of 1, and for groups of 2-999 a "form" (the group spelled out as it reads
+before that scale word) followed by the scale word. Every group has a
+second set of phrases, used once a higher group has been written, for
+languages such as British English ("one thousand and five") or Spanish
+("mil un millones") where that changes the wording.
+
+Usage: gen-num-to-words.py OUTPUT
+"""
+
+import sys
+
+GROUPS = 1000
+WEIGHTS = 4
+
+# --- English ---------------------------------------------------------------
+
+EN_UNIT = [
+    "zero", "one", "two", "three", "four", "five", "six", "seven", "eight",
+    "nine", "ten", "eleven", "twelve", "thirteen", "fourteen", "fifteen",
+    "sixteen", "seventeen", "eighteen", "nineteen",
+]
+
+EN_TENS = [
+    "", "", "twenty", "thirty", "forty", "fifty", "sixty", "seventy",
+    "eighty", "ninety",
+]
+
+
+def en_below_100(num):
+    if num < 20:
+        return EN_UNIT[num]
+
+    if num % 10:
+        return EN_TENS[num // 10] + "-" + EN_UNIT[num % 10]
+
+    return EN_TENS[num // 10]
+
+
+def en_us_group(num):
+    """ "two hundred thirty-four" """
+    words = []
+
+    if num >= 100:
+        words.append(EN_UNIT[num // 100] + " hundred")
+
+    if num % 100:
+        words.append(en_below_100(num % 100))
+
+    return " ".join(words)
+
+
+def en_gb_group(num):
+    """ "two hundred and thirty-four" """
+    words = []
+
+    if num >= 100:
+        words.append(EN_UNIT[num // 100] + " hundred")
+
+    if num % 100:
+        words.append(en_below_100(num % 100))
+
+    return " and ".join(words)
+
+
+def en_gb_tail(num):
+    """The last group after a higher one: "one thousand and five" """
+    if num < 100:
+        return "and " + en_below_100(num)
+
+    return en_gb_group(num)
+
+
+# --- Spanish ---------------------------------------------------------------
+
+ES_UNIT = [
+    "cero", "uno", "dos", "tres", "cuatro", "cinco", "seis", "siete", "ocho",
+    "nueve", "diez", "once", "doce", "trece", "catorce", "quince",
+    "dieciséis", "diecisiete", "dieciocho", "diecinueve", "veinte",
+    "veintiuno", "veintidós", "veintitrés", "veinticuatro", "veinticinco",
+    "veintiséis", "veintisiete", "veintiocho", "veintinueve",
+]
+
+ES_TENS = [
+    "", "", "", "treinta", "cuarenta", "cincuenta", "sesenta", "setenta",
+    "ochenta", "noventa",
+]
+
+ES_HUNDREDS = [
+    "", "ciento", "doscientos", "trescientos", "cuatrocientos", "quinientos",
+    "seiscientos", "setecientos", "ochocientos", "novecientos",
+]
+
+
+def es_group(num, apocope=False):
+    """
+    "doscientos treinta y uno", or "doscientos treinta y un" before "mil"
+    and "millones" when `apocope` is set.
+    """
+    words = []
+    rem = num % 100
+
+    if num == 100:
+        return "cien"
+
+    if num >= 100:
+        words.append(ES_HUNDREDS[num // 100])
+
+    if rem >= 30:
+        words.append(ES_TENS[rem // 10])
+
+        if rem % 10:
+            words.append("y")
+            words.append(ES_UNIT[rem % 10])
+    elif rem:
+        words.append(ES_UNIT[rem])
+
+    if apocope:
+        if words[-1] == "uno":
+            words[-1] = "un"
+        elif words[-1] == "veintiuno":
+            words[-1] = "veintiún"
+
+    return " ".join(words)
+
+
+def es_group_apocope(num):
+    return es_group(num, apocope=True)
+
+
+# --- French ----------------------------------------------------------------
+
+FR_UNIT = [
+    "zéro", "un", "deux", "trois", "quatre", "cinq", "six", "sept", "huit",
+    "neuf", "dix", "onze", "douze", "treize", "quatorze", "quinze", "seize",
+    "dix-sept", "dix-huit", "dix-neuf",
+]
+
+FR_TENS = [
+    "", "", "vingt", "trente", "quarante", "cinquante", "soixante",
+]
+
+
+def fr_below_100(num, final):
+    if num < 20:
+        return FR_UNIT[num]
+
+    tens, unit = divmod(num, 10)
+
+    if tens < 7:
+        if unit == 0:
+            return FR_TENS[tens]
+
+        if unit == 1:
+            return FR_TENS[tens] + " et un"
+
+        return FR_TENS[tens] + "-" + FR_UNIT[unit]
+
+    if tens == 7:
+        # soixante-dix, soixante et onze, soixante-douze...
+        if unit == 1:
+            return "soixante et onze"
+
+        return "soixante-" + FR_UNIT[10 + unit]
+
+    # quatre-vingts, quatre-vingt-un, quatre-vingt-dix...
+    rest = num - 80
+
+    if rest == 0:
+        return "quatre-vingts" if final else "quatre-vingt"
+
+    return "quatre-vingt-" + FR_UNIT[rest]
+
+
+def fr_group(num, final=True):
+    """
+    "deux cent quatre-vingt-un". "Cents" and "quatre-vingts" only take an "s"
+    when they end the number or come before "millions" or "milliards", not
+    before "mille", so groups of thousands are spelled with `final` unset.
+    """
+    words = []
+    hundreds, rem = divmod(num, 100)
+
+    if hundreds == 1:
+        words.append("cent")
+    elif hundreds:
+        words.append(FR_UNIT[hundreds] + (" cents" if final and not rem else " cent"))
+
+    if rem:
+        words.append(fr_below_100(rem, final))
+
+    return " ".join(words)
+
+
+def fr_group_before_mille(num):
+    return fr_group(num, final=False)
+
+
+# --- German ----------------------------------------------------------------
+
+DE_UNIT = [
+    "null", "eins", "zwei", "drei", "vier", "fünf", "sechs", "sieben", "acht",
+    "neun", "zehn", "elf", "zwölf", "dreizehn", "vierzehn", "fünfzehn",
+    "sechzehn", "siebzehn", "achtzehn", "neunzehn",
+]
+
+DE_TENS = [
+    "", "", "zwanzig", "dreißig", "vierzig", "fünfzig", "sechzig", "siebzig",
+    "achtzig", "neunzig",
+]
+
+
+def de_group(num, one="eins"):
+    """
+    "zweihunderteinunddreißig", written as one word. A trailing one is
+    "eins" at the end of the number, "ein" before "tausend" and "eine"
+    before "Million" and "Milliarde".
+    """
+    hundreds, rem = divmod(num, 100)
+    word = ""
+
+    if hundreds:
+        word = ("ein" if hundreds == 1 else DE_UNIT[hundreds]) + "hundert"
+
+    if rem == 1:
+        word += one
+    elif rem < 20:
+        word += DE_UNIT[rem] if rem else ""
+    elif rem % 10:
+        unit = "ein" if rem % 10 == 1 else DE_UNIT[rem % 10]
+        word += unit + "und" + DE_TENS[rem // 10]
+    else:
+        word += DE_TENS[rem // 10]
+
+    return word
+
+
+def de_group_before_tausend(num):
+    return de_group(num, one="ein")
+
+
+def de_group_before_million(num):
+    return de_group(num, one="eine")
+
+
+# --- Locales ---------------------------------------------------------------
+#
+# Each locale has a name, the word joining the cents to the amount in words
+# on a check ("and" in "one hundred and 25/100"), and one entry per weight.
+# Each weight is (zero, one, form, scale, separator), optionally followed by
+# a second tuple of the same shape used after a higher group. The separator
+# goes between the group and the next phrase written.
+
+
+def same(weight):
+    return (weight, weight)
+
+
+def units(zero, one, form):
+    """Zero is only spelled out when it is the whole number"""
+    return ((zero, one, form, "", " "), ("", one, form, "", " "))
+
+
+LOCALES = [
+    ("en_US", "and", [
+        units("zero", "one", en_us_group),
+        same(("", "one thousand", en_us_group, " thousand", " ")),
+        same(("", "one million", en_us_group, " million", " ")),
+        same(("", "one billion", en_us_group, " billion", " ")),
+    ]),
+    ("en_GB", "and", [
+        (("zero", "one", en_gb_group, "", " "),
+         ("", "and one", en_gb_tail, "", " ")),
+        same(("", "one thousand", en_gb_group, " thousand", " ")),
+        same(("", "one million", en_gb_group, " million", " ")),
+        same(("", "one billion", en_gb_group, " billion", " ")),
+    ]),
+    # Long scale: a thousand millions are "mil millones"
+    ("es", "con", [
+        units("cero", "uno", es_group),
+        same(("", "mil", es_group_apocope, " mil", " ")),
+        (("", "un millón", es_group_apocope, " millones", " "),
+         ("millones", "un millones", es_group_apocope, " millones", " ")),
+        same(("", "mil", es_group_apocope, " mil", " ")),
+    ]),
+    ("fr", "et", [
+        units("zéro", "un", fr_group),
+        same(("", "mille", fr_group_before_mille, " mille", " ")),
+        same(("", "un million", fr_group, " millions", " ")),
+        same(("", "un milliard", fr_group, " milliards", " ")),
+    ]),
+    # Below a million, the groups run together into one word
+    ("de", "und", [
+        units("null", "eins", de_group),
+        same(("", "eintausend", de_group_before_tausend, "tausend", "")),
+        same(("", "eine Million", de_group_before_million, " Millionen", " ")),
+        same(("", "eine Milliarde", de_group_before_million, " Milliarden", " ")),
+    ]),
+]
+
+
+class Pool:
+    """Every phrase once, as (offset << 8) | length into one string"""
+
+    def __init__(self):
+        self.data = bytearray()
+        self.phrases = {"": 0}
+
+    def add(self, text):
+        if text in self.phrases:
+            return self.phrases[text]
+
+        raw = text.encode("utf-8")
+        offset = self.data.find(raw)
+
+        if offset < 0:
+            offset = len(self.data)
+            self.data += raw
+
+        assert len(raw) < 256 and offset < (1 << 24)
+        self.phrases[text] = (offset << 8) | len(raw)
+
+        return self.phrases[text]
+
+
+def c_string(data, width=72):
+    lines = []
+    line = ""
+
+    for byte in data:
+        char = chr(byte) if 0x20 <= byte < 0x7f and byte not in b'"\\?' else "\\%03o" % byte
+
+        if len(line) + len(char) > width:
+            lines.append(line)
+            line = ""
+
+        line += char
+
+    lines.append(line)
+
+    return "\n".join('  "%s"' % line for line in lines)
+
+
+def main():
+    pool = Pool()
+    forms = []
+    locales = []
+
+    for name, conjunction, weights in LOCALES:
+        entries = []
+
+        for weight in weights:
+            for zero, one, form, scale, sep in weight:
+                if form not in forms:
+                    forms.append(form)
+
+                assert one and all(form(num) for num in range(2, GROUPS)) and len(sep) <= 1
+                entries.append((pool.add(zero), pool.add(one), forms.index(form),
+                                pool.add(scale), "'%s'" % sep if sep else "0"))
+
+        locales.append((name, conjunction, entries))
+
+    tables = [[pool.add(form(num)) if num > 1 else 0 for num in range(GROUPS)]
+              for form in forms]
+
+    out = []
+    out.append("/* Generated by gen-num-to-words.py from its locale data, do not edit */")
+    out.append("")
+    out.append("#define NUM_WORDS_N_FORMS (%d)" % len(forms))
+    out.append("")
+    out.append("static const char NUM_WORDS_POOL[] =")
+    out.append(c_string(pool.data) + ";")
+    out.append("")
+    out.append("static const uint32_t NUM_WORDS_FORMS[NUM_WORDS_N_FORMS][NUM_WORDS_GROUPS] = {")
+
+    for form, table in zip(forms, tables):
+        out.append("  /* %s */" % form.__name__)
+        out.append("  {")
+
+        for start in range(0, GROUPS, 6):
+            out.append("    " + " ".join("0x%08x," % phrase for phrase in table[start:start + 6]))
+
+        out.append("  },")
+
+    out.append("};")
+    out.append("")
+    out.append("static const NumWordsTable NUM_WORDS_TABLES[] = {")
+
+    for name, conjunction, entries in locales:
+        out.append("  {")
+        out.append('    "%s", "%s",' % (name, conjunction))
+        out.append("    {")
+
+        for i in range(0, len(entries), 2):
+            out.append("      {")
+
+            for zero, one, form, scale, sep in entries[i:i + 2]:
+                out.append("        { 0x%08x, 0x%08x, 0x%08x, %s, %d }," % (zero, one, scale, sep, form))
+
+            out.append("      },")
+
+        out.append("    },")
+        out.append("  },")
+
+    out.append("};")
+    out.append("")
+
+    assert all(len(weights) == WEIGHTS for _, _, weights in LOCALES)
+
+    with open(sys.argv[1], "w", encoding="utf-8") as output:
+        output.write("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
@@ -19,164 +19,243 @@
 
 #include "check-properties.h" /* Declares num_to_words () */
 
-#include <math.h>
 #include <stdint.h>
-#include <stdio.h>
 #include <string.h>
 
-static const char *UNIT[] = {
-  "zero",
-  "one",
-  "two",
-  "three",
-  "four",
-  "five",
-  "six",
-  "seven",
-  "eight",
-  "nine",
-  "ten",
-  "eleven",
-  "tweleve",
-  "thirteen",
-  "fourteen",
-  "fifteen",
-  "sixteen",
-  "seventeen",
-  "eighteen",
-  "nineteen",
-};
-
-static const char *TENS[] = {
-  "",
-  "ten",
-  "twenty",
-  "thirty",
-  "fourty",
-  "fifty",
-  "sixty",
-  "seventy",
-  "eighty",
-  "ninety",
-};
-
-// Limit of uint32_t is ~4 Billion
-static const char *WEIGHT[] = {
-  "",
-  "thousand",
-  "million",
-  "billion",
-};
-
-#define FAIL_EARLY(err)         \
-  do                            \
-    {                           \
-      if (err < 0)              \
-        {                       \
-          goto fail_and_return; \
-        }                       \
-    }                           \
-  while (0);
-
-static uint32_t
-eng_log10 (uint32_t num)
+/* Limit of uint32_t is ~4 Billion */
+#define NUM_WORDS_WEIGHTS (4)
+#define NUM_WORDS_GROUPS (1000)
+
+/* A phrase in NUM_WORDS_POOL, packed as (offset << 8) | length */
+#define PHRASE_OFFSET(phrase) ((phrase) >> 8)
+#define PHRASE_LEN(phrase) ((phrase) & 0xff)
+
+/*
+ * How one 3-digit group is written, see gen-num-to-words.py. A group of 2-999
+ * is NUM_WORDS_FORMS[form][group] followed by `scale`.
+ */
+typedef struct
 {
-  return floor (log10 (num)) / 3;
-}
+  uint32_t zero;  /* Group of 0, empty unless the words must say it */
+  uint32_t one;   /* Group of 1, e.g. "one thousand" or "mil" */
+  uint32_t scale; /* After a group of 2-999, e.g. " thousand" */
+  char sep;       /* Between this group and the next phrase, if not 0 */
+  uint8_t form;
+} NumWordsGroup;
 
-static uint32_t
-eng_power (uint32_t power)
+typedef struct
 {
-  return pow (10.0, power * 3);
+  const char *name;
+  const char *conjunction; /* Before the cents, e.g. "and" */
+  /* Indexed by weight, then by whether a higher group has been written */
+  NumWordsGroup groups[NUM_WORDS_WEIGHTS][2];
+} NumWordsTable;
+
+/*
+ * Every phrase of every locale is generated at build time from the grammar
+ * in gen-num-to-words.py, so converting a number is at most a couple of
+ * memcpy () calls per group in any language.
+ */
+#include "num-to-words-tables.h"
+
+G_STATIC_ASSERT (G_N_ELEMENTS (NUM_WORDS_TABLES) == NUM_WORDS_N_LOCALES);
+
+/*
+ * Phrases are short, and a memcpy () of a variable length is often expanded
+ * into `rep movs`, which takes longer to start than the copy itself. Copy in
+ * fixed size blocks instead, the last one overlapping the one before so
+ * nothing past the phrase is written.
+ */
+static inline size_t
+phrase_copy (char *dst, size_t pos, uint32_t phrase)
+{
+  const char *src = NUM_WORDS_POOL + PHRASE_OFFSET (phrase);
+  size_t n = PHRASE_LEN (phrase);
+
+  dst += pos;
+
+  if (n >= 16)
+    {
+      for (size_t i = 0; i < n - 16; i += 16)
+        {
+          memcpy (dst + i, src + i, 16);
+        }
+
+      memcpy (dst + n - 16, src + n - 16, 16);
+    }
+  else if (n >= 8)
+    {
+      memcpy (dst, src, 8);
+      memcpy (dst + n - 8, src + n - 8, 8);
+    }
+  else if (n >= 4)
+    {
+      memcpy (dst, src, 4);
+      memcpy (dst + n - 4, src + n - 4, 4);
+    }
+  else if (n > 0)
+    {
+      dst[0] = src[0];
+      dst[n / 2] = src[n / 2];
+      dst[n - 1] = src[n - 1];
+    }
+
+  return pos + n;
 }
 
+/*
+ * Write `num` in words in the language of `locale` to `dst`, e.g. 1234 becomes
+ * "one thousand two hundred thirty-four" in NUM_WORDS_EN_US. The words are
+ * UTF-8. Returns the string length in bytes, or -1 if `dst` is NULL, the
+ * locale is unknown or the words (with the terminating NUL) do not fit in
+ * `len` bytes.
+ */
 int
-num_to_words (char *dst, size_t len, uint32_t num)
+num_to_words_locale (char *dst, size_t len, uint32_t num, NumWordsLocale locale)
 {
-  if (!dst)
+  const NumWordsTable *table;
+  uint32_t groups[NUM_WORDS_WEIGHTS];
+  char sep = 0;
+  size_t pos = 0;
+
+  if (!dst || (unsigned) locale >= NUM_WORDS_N_LOCALES)
     {
       return -1;
     }
 
-  char *const start = dst;
-  char *const end = dst + len;
-  char *cur = dst;
-  uint32_t ex, val, msd, rem;
-  int written = 0;
+  table = &NUM_WORDS_TABLES[locale];
 
-  memset (dst, 'x', len);
+  /* Split into 3-digit groups, least significant first */
+  for (int i = 0; i < NUM_WORDS_WEIGHTS; ++i)
+    {
+      groups[i] = num % 1000;
+      num /= 1000;
+    }
 
-  if (num >= 1000)
+  for (int i = NUM_WORDS_WEIGHTS - 1; i >= 0; --i)
     {
-      ex = eng_log10 (num);
-      val = eng_power (ex);
+      /* The second set of phrases once a higher group has been written */
+      const NumWordsGroup *group = &table->groups[i][pos > 0];
+      uint32_t value = groups[i];
+      uint32_t phrase, scale = 0;
+      size_t need;
 
-      msd = num / val;
-      rem = num % val;
+      if (value > 1)
+        {
+          phrase = NUM_WORDS_FORMS[group->form][value];
+          scale = group->scale;
+        }
+      else
+        {
+          phrase = value ? group->one : group->zero;
+        }
 
-      written = num_to_words (cur, end - cur, msd);
-      FAIL_EARLY (written)
-      cur += written;
+      /* Empty groups are skipped */
+      if (PHRASE_LEN (phrase) == 0)
+        {
+          continue;
+        }
 
-      written = snprintf (cur, end - cur, " %s", WEIGHT[ex]);
-      FAIL_EARLY (written)
-      cur += written;
+      need = (sep != 0) + PHRASE_LEN (phrase) + PHRASE_LEN (scale);
 
-      if (rem)
+      if ((pos + need) >= len)
         {
-          *(cur) = ' ';
-          ++cur;
-          written = num_to_words (cur, end - cur, rem);
-          FAIL_EARLY (written)
-          cur += written;
+          if (len > 0)
+            {
+              dst[0] = '\0';
+            }
+
+          return -1;
         }
 
-      return cur - start;
-    }
-  else if (num >= 100)
-    {
-      msd = num / 100;
-      rem = num % 100;
+      if (sep)
+        {
+          dst[pos++] = sep;
+        }
 
-      written = snprintf (cur, end - cur, "%s hundred", UNIT[msd]);
-      FAIL_EARLY (written);
-      cur += written;
+      pos = phrase_copy (dst, pos, phrase);
 
-      if (rem)
+      if (scale)
         {
-          *(cur) = ' ';
-          ++cur;
-          written = num_to_words (cur, end - cur, rem);
-          FAIL_EARLY (written)
-          cur += written;
+          pos = phrase_copy (dst, pos, scale);
         }
-
-      return cur - start;
+      sep = group->sep;
     }
-  else if (num >= 20)
+
+  dst[pos] = '\0';
+
+  return (int) pos;
+}
+
+/*
+ * Write `num` in English words to `dst`, e.g. 1234 becomes "one thousand two
+ * hundred thirty-four". Returns the string length, or -1 if `dst` is NULL or
+ * the words (with the terminating NUL) do not fit in `len` bytes.
+ */
+int
+num_to_words (char *dst, size_t len, uint32_t num)
+{
+  return num_to_words_locale (dst, len, num, NUM_WORDS_EN_US);
+}
+
+/*
+ * Look up the words for a locale name such as "de_DE.UTF-8", falling back
+ * from the country to the language alone, so "de_AT" gets NUM_WORDS_DE and
+ * "en" gets NUM_WORDS_EN_US. Returns false if no language matches.
+ */
+bool
+num_words_locale_from_name (const char *name, NumWordsLocale *locale)
+{
+  size_t name_len, lang_len;
+
+  if (!name)
     {
-      msd = num / 10;
-      rem = num % 10;
+      return false;
+    }
+
+  /* Drop the codeset and the modifier */
+  name_len = strcspn (name, ".@");
+  lang_len = strcspn (name, "_.@");
 
-      written = snprintf (cur, end - cur, "%s", TENS[msd]);
-      FAIL_EARLY (written)
-      cur += written;
+  for (int pass = 0; pass < 2; ++pass)
+    {
+      size_t match_len = pass ? lang_len : name_len;
 
-      if (rem)
+      for (int i = 0; i < NUM_WORDS_N_LOCALES; ++i)
         {
-          written = snprintf (cur, end - cur, "-%s", UNIT[rem]);
-          FAIL_EARLY (written)
-          cur += written;
+          const char *table_name = NUM_WORDS_TABLES[i].name;
+
+          if (g_ascii_strncasecmp (table_name, name, match_len) == 0
+              && (table_name[match_len] == '\0' || (pass && table_name[match_len] == '_')))
+            {
+              *locale = (NumWordsLocale) i;
+              return true;
+            }
         }
+    }
+
+  return false;
+}
 
-      return cur - start;
+const char *
+num_words_locale_to_name (NumWordsLocale locale)
+{
+  if ((unsigned) locale >= NUM_WORDS_N_LOCALES)
+    {
+      return NULL;
     }
-  else
+
+  return NUM_WORDS_TABLES[locale].name;
+}
+
+/* The word between the amount in words and the cents, e.g. "and" in English */
+const char *
+num_words_locale_get_conjunction (NumWordsLocale locale)
+{
+  if ((unsigned) locale >= NUM_WORDS_N_LOCALES)
     {
-      written = snprintf (cur, end - cur, "%s", UNIT[num]);
-      return written;
+      return NULL;
     }
 
-fail_and_return:
-  return written;
+  return NUM_WORDS_TABLES[locale].conjunction;
 }
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Compares check_amount_parse () against the sscanf () path it replaced.
+ * The parser is first checked against a table of valid and invalid inputs;
+ * the benchmark fails on any mismatch. The legacy path is only timed, as it
+ * depends on the locale and reads "1,234.56" as one dollar in the C locale.
+ */
+
+#include "bench-common.h"
+#include "check-amount.h"
+#include "check-properties.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct
+{
+  const char *text;
+  CheckAmountStatus status;
+  gint64 cents;     /* When valid */
+  gsize error_pos;  /* When invalid */
+} ParseCase;
+
+static const ParseCase PARSE_CASES[] = {
+  { "0", CHECK_AMOUNT_OK, 0, 0 },
+  { "7", CHECK_AMOUNT_OK, 700, 0 },
+  { "42.5", CHECK_AMOUNT_OK, 4250, 0 },
+  { "42.", CHECK_AMOUNT_OK, 4200, 0 },
+  { ".99", CHECK_AMOUNT_OK, 99, 0 },
+  { "100.00", CHECK_AMOUNT_OK, 10000, 0 },
+  { " $1,234.56 ", CHECK_AMOUNT_OK, 123456, 0 },
+  { "$ 98765.43", CHECK_AMOUNT_OK, 9876543, 0 },
+  { "1,000,000", CHECK_AMOUNT_OK, 100000000, 0 },
+  { "4,294,967,295.99", CHECK_AMOUNT_OK, CHECK_AMOUNT_MAX_CENTS, 0 },
+  { "", CHECK_AMOUNT_ERROR_EMPTY, 0, 0 },
+  { "  $ ", CHECK_AMOUNT_ERROR_EMPTY, 0, 4 },
+  { ".", CHECK_AMOUNT_ERROR_EMPTY, 0, 1 },
+  { "12a", CHECK_AMOUNT_ERROR_CHARACTER, 0, 2 },
+  { "-5", CHECK_AMOUNT_ERROR_CHARACTER, 0, 0 },
+  { "1.2.3", CHECK_AMOUNT_ERROR_CHARACTER, 0, 3 },
+  { "1 000", CHECK_AMOUNT_ERROR_CHARACTER, 0, 2 },
+  { ",123", CHECK_AMOUNT_ERROR_GROUPING, 0, 0 },
+  { "1234,567", CHECK_AMOUNT_ERROR_GROUPING, 0, 4 },
+  { "1,23", CHECK_AMOUNT_ERROR_GROUPING, 0, 4 },
+  { "1,2345", CHECK_AMOUNT_ERROR_GROUPING, 0, 5 },
+  { "1,,234", CHECK_AMOUNT_ERROR_GROUPING, 0, 2 },
+  { "1.234", CHECK_AMOUNT_ERROR_CENTS, 0, 4 },
+  { "4294967296", CHECK_AMOUNT_ERROR_RANGE, 0, 9 },
+  { "99999999999999999999", CHECK_AMOUNT_ERROR_RANGE, 0, 9 },
+};
+
+static const char *AMOUNTS[] = {
+  "0.01",
+  "7",
+  "42.50",
+  "100.00",
+  "1,234.56",
+  "98765.43",
+  "1,000,000.00",
+  "4,294,967,295.99",
+};
+
+static bool
+check_parse_cases (void)
+{
+  char formatted[STRING_LEN];
+
+  for (gsize i = 0; i < G_N_ELEMENTS (PARSE_CASES); ++i)
+    {
+      const ParseCase *test = &PARSE_CASES[i];
+      CheckAmountStatus status;
+      gsize error_pos = G_MAXSIZE;
+      gint64 cents = -1;
+
+      status = check_amount_parse (test->text, &cents, &error_pos);
+
+      if (status != test->status
+          || (status == CHECK_AMOUNT_OK && cents != test->cents)
+          || (status != CHECK_AMOUNT_OK && error_pos != test->error_pos))
+        {
+          g_printerr ("Mismatch for \"%s\": status %d, cents %" G_GINT64_FORMAT
+                      ", position %" G_GSIZE_FORMAT "\n",
+                      test->text, status, cents, error_pos);
+          return false;
+        }
+    }
+
+  /* Formatting must read back to the same number of cents */
+  for (gint64 cents = 0; cents < 200000; cents += 7)
+    {
+      gint64 parsed = -1;
+
+      if (check_amount_format (formatted, STRING_LEN, cents) < 0
+          || check_amount_parse (formatted, &parsed, NULL) != CHECK_AMOUNT_OK
+          || parsed != cents)
+        {
+          g_printerr ("Round trip failed for %" G_GINT64_FORMAT ": \"%s\"\n", cents, formatted);
+          return false;
+        }
+    }
+
+  return true;
+}
+
+static void
+bench_legacy_sscanf (gpointer data, guint64 iteration)
+{
+  guint dollars = 0, cents = 0;
+
+  (void) data;
+
+  sscanf (AMOUNTS[iteration % G_N_ELEMENTS (AMOUNTS)], "%'u.%u", &dollars, &cents);
+  bench_consume ((guint64) dollars * 100 + cents);
+}
+
+static void
+bench_check_amount_parse (gpointer data, guint64 iteration)
+{
+  gint64 cents = 0;
+
+  (void) data;
+
+  check_amount_parse (AMOUNTS[iteration % G_N_ELEMENTS (AMOUNTS)], &cents, NULL);
+  bench_consume ((guint64) cents);
+}
+
+int
+main (int argc, char *argv[])
+{
+  double legacy_ns, parser_ns;
+  BenchSuite suite;
+
+  bench_init (argc, argv);
+
+  if (!check_parse_cases ())
+    {
+      return EXIT_FAILURE;
+    }
+
+  bench_suite_begin (&suite, "amount-parse");
+  legacy_ns = bench_suite_run (&suite, "amount_parse/sscanf", bench_legacy_sscanf, NULL);
+  parser_ns = bench_suite_run (&suite, "amount_parse/check_amount_parse", bench_check_amount_parse, NULL);
+  bench_suite_end (&suite);
+
+  g_printerr ("check_amount_parse speedup: %.1fx\n", legacy_ns / parser_ns);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Duplicate payments in a batch of a million generated checks, about one in
+ * a hundred of them repeated with the payee spelled differently, checked
+ * within the batch and against a journal of already issued checks. The flags
+ * must match those found by comparing the keys as strings; the benchmark
+ * fails otherwise.
+ */
+
+#include "bench-common.h"
+#include "check-batch.h"
+
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BENCH_CHECKS (bench_size (1000000, 10000))
+#define BENCH_ISSUED (bench_size (20000, 2000))
+#define BENCH_RECENT (bench_size (1024, 128)) /* Issued checks the batch may pay again */
+
+static const char *WORDS[] = {
+  "Acme", "Allied", "Apex", "Atlas", "Blue", "Capital", "Central", "Coastal",
+  "Delta", "Eagle", "Empire", "First", "Global", "Golden", "Harbor", "Horizon",
+  "Liberty", "Metro", "National", "North", "Pacific", "Pioneer", "Premier",
+  "Summit", "United", "Valley", "Western",
+};
+
+static const char *KINDS[] = {
+  "Supply", "Logistics", "Electric", "Plumbing", "Foods", "Printing",
+  "Hardware", "Consulting", "Services", "Freight",
+};
+
+typedef struct
+{
+  CheckBatch *batch;
+  CheckLedger *ledger;
+  guint n_flagged;
+} BenchData;
+
+typedef struct
+{
+  char name[STRING_LEN];
+  char date[STRING_LEN];
+  gint64 cents;
+} Payment;
+
+static void
+random_payment (GRand *rand, Payment *payment)
+{
+  g_snprintf (payment->name, STRING_LEN, "%s %s Inc.",
+              WORDS[g_rand_int_range (rand, 0, G_N_ELEMENTS (WORDS))],
+              KINDS[g_rand_int_range (rand, 0, G_N_ELEMENTS (KINDS))]);
+  g_snprintf (payment->date, STRING_LEN, "%02d/%02d/2024", g_rand_int_range (rand, 1, 13),
+              g_rand_int_range (rand, 1, 29));
+  payment->cents = (g_rand_int_range (rand, 1, 50000) * 100) + g_rand_int_range (rand, 0, 100);
+}
+
+/* How the duplicate was keyed in: in capitals, with other punctuation */
+static void
+respell_payment (Payment *payment)
+{
+  for (char *cur = payment->name; *cur; ++cur)
+    {
+      *cur = (*cur == '.') ? ',' : g_ascii_toupper (*cur);
+    }
+}
+
+/* The key compared as a string, for reference */
+static char *
+payment_key (const Payment *payment)
+{
+  GString *key = g_string_new (NULL);
+
+  for (const char *cur = payment->name; *cur; ++cur)
+    {
+      if (g_ascii_isalnum (*cur))
+        {
+          g_string_append_c (key, g_ascii_tolower (*cur));
+        }
+    }
+
+  g_string_append_printf (key, "|%" G_GINT64_FORMAT "|%s", payment->cents, payment->date);
+
+  return g_string_free (key, FALSE);
+}
+
+static void
+bench_find_duplicates (gpointer data, guint64 iteration)
+{
+  BenchData *bench = data;
+
+  bench->n_flagged = check_batch_find_duplicates (bench->batch, bench->ledger);
+  bench_consume (bench->n_flagged);
+}
+
+static bool
+journal_payments (const char *path, GRand *rand, Payment *recent, GHashTable *issued)
+{
+  g_autoptr (GError) error = NULL;
+  g_autoptr (CheckJournal) journal = check_journal_open (path, 4096, &error);
+  CheckData check_data;
+
+  if (!journal)
+    {
+      g_printerr ("Could not open the journal: %s\n", error->message);
+      return false;
+    }
+
+  memset (&check_data, 0, sizeof (CheckData));
+
+  for (guint i = 0; i < BENCH_ISSUED; ++i)
+    {
+      Payment *payment = &recent[i % BENCH_RECENT];
+
+      random_payment (rand, payment);
+      g_strlcpy (check_data.name, payment->name, STRING_LEN);
+      g_strlcpy (check_data.date, payment->date, STRING_LEN);
+      g_hash_table_add (issued, payment_key (payment));
+
+      if (!check_journal_append (journal, &check_data, payment->cents, 0, &error))
+        {
+          g_printerr ("Could not journal: %s\n", error->message);
+          return false;
+        }
+    }
+
+  return true;
+}
+
+/* Returns the number of checks that should be flagged */
+static guint
+batch_payments (CheckBatch *batch,
+                GRand *rand,
+                const Payment *recent,
+                GHashTable *issued,
+                guint8 *expected)
+{
+  g_autoptr (GHashTable) seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  CheckData check_data;
+  guint n_expected = 0;
+
+  for (guint i = 0; i < BENCH_CHECKS; ++i)
+    {
+      Payment payment;
+      char *key;
+
+      if ((i % 1000) == 999)
+        {
+          /* Paid again from the journal */
+          memcpy (&payment, &recent[g_rand_int_range (rand, 0, BENCH_RECENT)], sizeof (Payment));
+          respell_payment (&payment);
+        }
+      else if ((i % 100) == 99)
+        {
+          /* Twice in the batch */
+          guint j = g_rand_int_range (rand, 0, i);
+
+          check_batch_get (batch, j, NUM_WORDS_EN_US, &check_data);
+          g_strlcpy (payment.name, check_data.name, STRING_LEN);
+          g_strlcpy (payment.date, check_data.date, STRING_LEN);
+          payment.cents = check_batch_get_cents (batch, j);
+          respell_payment (&payment);
+        }
+      else
+        {
+          random_payment (rand, &payment);
+        }
+
+      if (!check_batch_append (batch, payment.date, payment.name, payment.cents,
+                               NULL, NULL, NULL, NULL))
+        {
+          g_printerr ("Could not add check %u to the batch\n", i);
+          return G_MAXUINT;
+        }
+
+      key = payment_key (&payment);
+
+      if (g_hash_table_contains (seen, key))
+        {
+          expected[i] = CHECK_BATCH_DUPLICATE;
+          g_free (key);
+        }
+      else
+        {
+          expected[i] = g_hash_table_contains (issued, key) ? CHECK_BATCH_ISSUED : 0;
+          g_hash_table_add (seen, key);
+        }
+
+      n_expected += expected[i] != 0;
+    }
+
+  return n_expected;
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_autoptr (GError) error = NULL;
+  g_autoptr (GHashTable) issued = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  g_autofree char *journal_path = NULL;
+  g_autofree char *index_path = NULL;
+  g_autofree guint8 *expected = NULL;
+  g_autofree Payment *recent = NULL;
+  GRand *rand = g_rand_new_with_seed (0xD0B1);
+  BenchData bench = { 0 }, batch_only = { 0 };
+  guint n_expected = G_MAXUINT;
+  double batch_ns, ledger_ns;
+  BenchSuite suite;
+  bool ok;
+  int fd;
+
+  bench_init (argc, argv);
+  expected = g_new0 (guint8, BENCH_CHECKS);
+  recent = g_new0 (Payment, BENCH_RECENT);
+
+  fd = g_file_open_tmp ("checkwriter-duplicates-XXXXXX", &journal_path, &error);
+
+  if (fd < 0)
+    {
+      g_printerr ("Could not create a journal: %s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  close (fd);
+  index_path = g_strconcat (journal_path, ".index", NULL);
+
+  ok = journal_payments (journal_path, rand, recent, issued);
+  bench.ledger = ok ? check_ledger_open (journal_path, &error) : NULL;
+  bench.batch = check_batch_new ();
+  batch_only.batch = bench.batch;
+
+  if (ok && !bench.ledger)
+    {
+      g_printerr ("Could not open the ledger: %s\n", error->message);
+    }
+
+  if (bench.ledger)
+    {
+      n_expected = batch_payments (bench.batch, rand, recent, issued, expected);
+    }
+
+  g_rand_free (rand);
+  ok = n_expected != G_MAXUINT;
+
+  if (ok)
+    {
+      bench_suite_begin (&suite, "batch_duplicates");
+      batch_ns = bench_suite_run (&suite, "find_duplicates/batch", bench_find_duplicates, &batch_only);
+      ledger_ns = bench_suite_run (&suite, "find_duplicates/batch_and_ledger", bench_find_duplicates, &bench);
+      bench_suite_end (&suite);
+
+      /* The last run looked at the ledger too */
+      for (guint i = 0; i < BENCH_CHECKS && ok; ++i)
+        {
+          if (check_batch_get_flags (bench.batch, i) != expected[i])
+            {
+              g_printerr ("Check %u flagged %d, expected %d\n", i + 1,
+                          check_batch_get_flags (bench.batch, i), expected[i]);
+              ok = false;
+            }
+        }
+
+      ok = ok && bench.n_flagged == n_expected;
+
+      g_printerr ("Flagged %u of %u checks: %.1f ns per check within the batch, %.1f ns with the ledger\n",
+                  bench.n_flagged, BENCH_CHECKS, batch_ns / BENCH_CHECKS, ledger_ns / BENCH_CHECKS);
+    }
+
+  g_clear_pointer (&bench.ledger, check_ledger_free);
+  check_batch_free (bench.batch);
+  g_unlink (index_path);
+  g_unlink (journal_path);
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef CHECKWRITER_BENCH_COMMON_H_
+#define CHECKWRITER_BENCH_COMMON_H_
+
+/*
+ * Minimal benchmark harness. Each case is calibrated by doubling its
+ * iteration count until one run takes at least BENCH_MIN_TIME_US, and the
+ * results of a suite are printed to stdout as one JSON document:
+ *
+ *   { "suite": "...", "benchmarks": [
+ *       { "name": "...", "iterations": N, "ns_per_op": X, "ops_per_sec": Y },
+ *       ... ] }
+ *
+ * `meson test` runs the benchmarks that check their results with --test
+ * (see bench_init ()): every case then runs BENCH_TEST_ITERATIONS times
+ * without calibration, on the smaller data sets given to bench_size (), so
+ * the checks stay quick enough for every build.
+ */
+
+#include <glib.h>
+
+#define BENCH_MIN_TIME_US (200000)
+#define BENCH_TEST_ITERATIONS (16)
+
+typedef void (*BenchFunc) (gpointer data, guint64 iteration);
+
+typedef struct
+{
+  guint n_cases;
+} BenchSuite;
+
+/* Results are accumulated here so the optimizer cannot drop the work */
+static volatile guint64 bench_sink;
+
+/* Set by bench_init () when only the results are checked */
+static gboolean bench_testing;
+
+static inline void
+bench_init (int argc, char *argv[])
+{
+  bench_testing = argc > 1 && g_strcmp0 (argv[1], "--test") == 0;
+}
+
+/* The size of a data set: `full` when benchmarking, `test` with --test */
+static inline guint
+bench_size (guint full, guint test)
+{
+  return bench_testing ? test : full;
+}
+
+static inline void
+bench_consume (guint64 value)
+{
+  bench_sink += value;
+}
+
+static inline void
+bench_suite_begin (BenchSuite *suite, const char *name)
+{
+  suite->n_cases = 0;
+  g_print ("{\n  \"suite\": \"%s\",\n  \"benchmarks\": [", name);
+}
+
+static inline double
+bench_suite_run (BenchSuite *suite,
+                 const char *name,
+                 BenchFunc func,
+                 gpointer data)
+{
+  guint64 iterations = bench_testing ? BENCH_TEST_ITERATIONS : 1;
+  gint64 elapsed = 0;
+  double ns_per_op;
+
+  for (;;)
+    {
+      gint64 start = g_get_monotonic_time ();
+
+      for (guint64 i = 0; i < iterations; ++i)
+        {
+          func (data, i);
+        }
+
+      elapsed = g_get_monotonic_time () - start;
+
+      if (bench_testing || elapsed >= BENCH_MIN_TIME_US || iterations >= (G_MAXUINT64 / 2))
+        {
+          break;
+        }
+
+      iterations *= 2;
+    }
+
+  ns_per_op = (elapsed * 1000.0) / (double) iterations;
+
+  g_print ("%s\n    { \"name\": \"%s\", \"iterations\": %" G_GUINT64_FORMAT
+           ", \"ns_per_op\": %.3f, \"ops_per_sec\": %.1f }",
+           suite->n_cases ? "," : "", name, iterations, ns_per_op,
+           ns_per_op > 0 ? (1e9 / ns_per_op) : 0.0);
+
+  ++suite->n_cases;
+
+  return ns_per_op;
+}
+
+static inline void
+bench_suite_end (BenchSuite *suite)
+{
+  (void) suite;
+  g_print ("\n  ]\n}\n");
+}
+
+#endif /* CHECKWRITER_BENCH_COMMON_H_ */
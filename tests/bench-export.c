@@ -0,0 +1,415 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Exports a batch to PDF and PNG in a temporary directory, with one worker
+ * and with four. The batch spans several chunks of pages and several PDF
+ * windows, so the pages rendered out of order by the workers must still come
+ * out in order. Each PDF must hold one page per check and each PNG export one
+ * numbered image per check, and four workers must write what one does; the
+ * benchmark fails otherwise.
+ *
+ * Pages and outputs are compared without a PDF library: the streams of each
+ * PDF are inflated, as cairo may store the page objects in compressed object
+ * streams, and the page, template and font streams must be the same in both
+ * documents. Creation dates and document IDs differ between the two and are
+ * left out.
+ */
+
+#include "bench-common.h"
+#include "check-export.h"
+
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* More than two chunks of pages, and more than one PDF window of four workers */
+#define BENCH_CHECKS (bench_size (400, 80))
+#define BENCH_DPI (100.0)
+
+typedef struct
+{
+  const char *path;
+  const CheckProperties *check_prop;
+  const CheckBatch *batch;
+  CheckExportFormat format;
+  guint n_jobs;
+} BenchData;
+
+static void
+bench_layout_init (CheckProperties *p)
+{
+  /* The defaults of the GSettings schema */
+  static const FieldProperties date = { 85.0, 19.0, 38.0 };
+  static const FieldProperties name = { 16.0, 29.5, 97.0 };
+  static const FieldProperties amount = { 121.0, 29.0, 25.0 };
+  static const FieldProperties amount_in_words = { 6.0, 37.0, 113.0 };
+  static const FieldProperties memo = { 10.0, 56.0, 59.0 };
+  static const FieldProperties micr = { 7.9375, 65.2375, 136.525 };
+
+  memset (p, 0, sizeof (CheckProperties));
+  g_strlcpy (p->check_font, "Courier", STRING_LEN);
+  p->check_font_height = 10;
+  p->words_locale = NUM_WORDS_EN_US;
+  p->width = 152.4;
+  p->height = 70.0;
+  p->x_pad = 1.0;
+  p->y_pad = 1.0;
+  p->date = date;
+  p->name = name;
+  p->amount = amount;
+  p->amount_in_words = amount_in_words;
+  p->memo = memo;
+  p->micr = micr;
+  p->magic = CHECK_PROPERTIES_MAGIC;
+}
+
+static CheckBatch *
+bench_batch_new (void)
+{
+  CheckBatch *batch = check_batch_new ();
+  char name[STRING_LEN], check_number[STRING_LEN];
+
+  for (guint i = 0; i < BENCH_CHECKS; ++i)
+    {
+      g_snprintf (name, sizeof (name), "Payee number %u", i);
+      g_snprintf (check_number, sizeof (check_number), "%u", 1001 + i);
+      check_batch_append (batch, "01/31/2025", name, 100 + (gint64) i * 137, "Invoice",
+                          check_number, "011000015", "123456789");
+    }
+
+  return batch;
+}
+
+static void
+bench_export (gpointer data, guint64 iteration)
+{
+  const BenchData *bench = data;
+  g_autoptr (GError) error = NULL;
+  gboolean ok;
+
+  (void) iteration;
+
+  if (bench->format == CHECK_EXPORT_FORMAT_PDF)
+    {
+      ok = check_export_pdf (bench->path, bench->check_prop, bench->batch, CHECK_WRITE,
+                             bench->n_jobs, &error);
+    }
+  else
+    {
+      ok = check_export_png (bench->path, bench->check_prop, bench->batch, BENCH_DPI,
+                             CHECK_WRITE, bench->n_jobs, &error);
+    }
+
+  if (!ok)
+    {
+      g_printerr ("Could not export %s: %s\n", bench->path, error->message);
+      exit (EXIT_FAILURE);
+    }
+
+  bench_consume (bench->n_jobs);
+}
+
+static const char *
+find_bytes (const char *haystack, const char *end, const char *needle)
+{
+  gsize length = strlen (needle);
+  const char *cur = haystack;
+
+  while ((gsize) (end - cur) >= length && (cur = memchr (cur, needle[0], (end - cur) - length + 1)))
+    {
+      if (memcmp (cur, needle, length) == 0)
+        {
+          return cur;
+        }
+
+      ++cur;
+    }
+
+  return NULL;
+}
+
+/* Page objects are "/Type /Page", the page tree "/Type /Pages" */
+static guint
+count_pages (const char *data, const char *end)
+{
+  guint n_pages = 0;
+
+  for (const char *cur = find_bytes (data, end, "/Type /Page"); cur;
+       cur = find_bytes (cur + 1, end, "/Type /Page"))
+    {
+      n_pages += (cur + 11 == end || cur[11] != 's');
+    }
+
+  return n_pages;
+}
+
+static GBytes *
+inflate_stream (const char *data, gsize length)
+{
+  g_autoptr (GZlibDecompressor) decompressor = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_ZLIB);
+  g_autoptr (GInputStream) raw = g_memory_input_stream_new_from_data (data, length, NULL);
+  g_autoptr (GInputStream) input = g_converter_input_stream_new (raw, G_CONVERTER (decompressor));
+  g_autoptr (GOutputStream) output = g_memory_output_stream_new_resizable ();
+
+  if (g_output_stream_splice (output, input, G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET, NULL, NULL) < 0)
+    {
+      return NULL;
+    }
+
+  return g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (output));
+}
+
+/*
+ * Counts the pages of the PDF at `path` and adds its inflated streams to
+ * `streams`, but for the cross reference and object streams, which hold
+ * file offsets and the document information.
+ */
+static bool
+read_pdf (const char *path, guint *n_pages, GPtrArray *streams)
+{
+  g_autofree char *contents = NULL;
+  const char *cur, *end, *start;
+  gsize length;
+
+  if (!g_file_get_contents (path, &contents, &length, NULL))
+    {
+      g_printerr ("Could not read %s\n", path);
+      return false;
+    }
+
+  *n_pages = 0;
+  end = contents + length;
+
+  for (cur = contents; (start = find_bytes (cur, end, ">>\nstream\n")); cur = start)
+    {
+      const char *data = start + 10;
+      const char *data_end = find_bytes (data, end, "endstream");
+      GBytes *inflated = NULL;
+
+      if (!data_end)
+        {
+          g_printerr ("%s: Unterminated stream\n", path);
+          return false;
+        }
+
+      *n_pages += count_pages (cur, start);
+      inflated = inflate_stream (data, data_end - data);
+
+      if (inflated)
+        {
+          gsize size;
+          const char *bytes = g_bytes_get_data (inflated, &size);
+
+          *n_pages += count_pages (bytes, bytes + size);
+
+          /* The dictionary of the stream follows the end of the previous one */
+          if (find_bytes (cur, start, "/Type /XRef") || find_bytes (cur, start, "/Type /ObjStm"))
+            {
+              g_bytes_unref (inflated);
+            }
+          else
+            {
+              g_ptr_array_add (streams, inflated);
+            }
+        }
+
+      start = data_end;
+    }
+
+  *n_pages += count_pages (cur, end);
+
+  return true;
+}
+
+static bool
+check_pdf (const BenchData *one, const BenchData *four)
+{
+  g_autoptr (GPtrArray) one_streams = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+  g_autoptr (GPtrArray) four_streams = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+  guint one_pages, four_pages;
+
+  if (!read_pdf (one->path, &one_pages, one_streams)
+      || !read_pdf (four->path, &four_pages, four_streams))
+    {
+      return false;
+    }
+
+  if (one_pages != BENCH_CHECKS || four_pages != BENCH_CHECKS)
+    {
+      g_printerr ("PDF exports have %u and %u pages for %u checks\n",
+                  one_pages, four_pages, BENCH_CHECKS);
+      return false;
+    }
+
+  if (one_streams->len != four_streams->len || one_streams->len < BENCH_CHECKS)
+    {
+      g_printerr ("PDF exports have %u and %u streams\n", one_streams->len, four_streams->len);
+      return false;
+    }
+
+  for (guint i = 0; i < one_streams->len; ++i)
+    {
+      if (!g_bytes_equal (one_streams->pdata[i], four_streams->pdata[i]))
+        {
+          g_printerr ("Stream %u differs between %s and %s\n", i, one->path, four->path);
+          return false;
+        }
+    }
+
+  return true;
+}
+
+/* "jobs-1.png" is written as "jobs-1-0001.png", "jobs-1-0002.png", ... */
+static char *
+png_page_path (const char *path, guint page)
+{
+  return g_strdup_printf ("%.*s-%04u.png", (int) (strlen (path) - 4), path, page + 1);
+}
+
+static bool
+check_png (const BenchData *one, const BenchData *four)
+{
+  int width = (int) ceil ((one->check_prop->width * BENCH_DPI) / INCH_PER_MM);
+  int height = (int) ceil ((one->check_prop->height * BENCH_DPI) / INCH_PER_MM);
+
+  for (guint i = 0; i <= BENCH_CHECKS; ++i)
+    {
+      g_autofree char *one_path = png_page_path (one->path, i);
+      g_autofree char *four_path = png_page_path (four->path, i);
+      g_autofree char *one_contents = NULL;
+      g_autofree char *four_contents = NULL;
+      gsize one_length, four_length;
+
+      /* One image per check, and no more */
+      if (i == BENCH_CHECKS)
+        {
+          if (g_file_test (one_path, G_FILE_TEST_EXISTS) || g_file_test (four_path, G_FILE_TEST_EXISTS))
+            {
+              g_printerr ("More images than the %u checks were written\n", BENCH_CHECKS);
+              return false;
+            }
+
+          break;
+        }
+
+      if (!g_file_get_contents (one_path, &one_contents, &one_length, NULL)
+          || !g_file_get_contents (four_path, &four_contents, &four_length, NULL))
+        {
+          g_printerr ("Image %s or %s is missing\n", one_path, four_path);
+          return false;
+        }
+
+      if (one_length != four_length || memcmp (one_contents, four_contents, one_length) != 0)
+        {
+          g_printerr ("Images %s and %s differ\n", one_path, four_path);
+          return false;
+        }
+
+      if (i == 0)
+        {
+          cairo_surface_t *image = cairo_image_surface_create_from_png (one_path);
+          bool sized = cairo_surface_status (image) == CAIRO_STATUS_SUCCESS
+                       && cairo_image_surface_get_width (image) == width
+                       && cairo_image_surface_get_height (image) == height;
+
+          cairo_surface_destroy (image);
+
+          if (!sized)
+            {
+              g_printerr ("Image %s is not a %dx%d PNG\n", one_path, width, height);
+              return false;
+            }
+        }
+    }
+
+  return true;
+}
+
+static void
+remove_dir (const char *path)
+{
+  g_autoptr (GDir) dir = g_dir_open (path, 0, NULL);
+  const char *name;
+
+  while (dir && (name = g_dir_read_name (dir)))
+    {
+      g_autofree char *file = g_build_filename (path, name, NULL);
+
+      g_unlink (file);
+    }
+
+  g_rmdir (path);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_autoptr (GError) error = NULL;
+  g_autofree char *dir = NULL;
+  g_autofree char *pdf_one_path = NULL;
+  g_autofree char *pdf_four_path = NULL;
+  g_autofree char *png_one_path = NULL;
+  g_autofree char *png_four_path = NULL;
+  CheckBatch *batch = NULL;
+  CheckProperties check_prop;
+  BenchData pdf_one, pdf_four, png_one, png_four;
+  BenchSuite suite;
+  bool ok;
+
+  bench_init (argc, argv);
+
+  dir = g_dir_make_tmp ("checkwriter-export-XXXXXX", &error);
+
+  if (!dir)
+    {
+      g_printerr ("Could not create a directory: %s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  pdf_one_path = g_build_filename (dir, "jobs-1.pdf", NULL);
+  pdf_four_path = g_build_filename (dir, "jobs-4.pdf", NULL);
+  png_one_path = g_build_filename (dir, "jobs-1.png", NULL);
+  png_four_path = g_build_filename (dir, "jobs-4.png", NULL);
+
+  bench_layout_init (&check_prop);
+  batch = bench_batch_new ();
+
+  pdf_one = (BenchData) { pdf_one_path, &check_prop, batch, CHECK_EXPORT_FORMAT_PDF, 1 };
+  pdf_four = (BenchData) { pdf_four_path, &check_prop, batch, CHECK_EXPORT_FORMAT_PDF, 4 };
+  png_one = (BenchData) { png_one_path, &check_prop, batch, CHECK_EXPORT_FORMAT_PNG, 1 };
+  png_four = (BenchData) { png_four_path, &check_prop, batch, CHECK_EXPORT_FORMAT_PNG, 4 };
+
+  bench_suite_begin (&suite, "export");
+  bench_suite_run (&suite, "pdf/jobs_1", bench_export, &pdf_one);
+  bench_suite_run (&suite, "pdf/jobs_4", bench_export, &pdf_four);
+  bench_suite_run (&suite, "png/jobs_1", bench_export, &png_one);
+  bench_suite_run (&suite, "png/jobs_4", bench_export, &png_four);
+  bench_suite_end (&suite);
+
+  ok = check_pdf (&pdf_one, &pdf_four) && check_png (&png_one, &png_four);
+
+  check_batch_free (batch);
+  remove_dir (dir);
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
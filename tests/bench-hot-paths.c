@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Benchmarks of the text and amount handling that runs on every keystroke
+ * and for every record of a batch.
+ */
+
+#include "bench-common.h"
+#include "check-batch.h"
+#include "check-properties.h"
+
+#include <stdlib.h>
+
+typedef struct
+{
+  uint32_t base;
+  uint32_t span;
+} NumRange;
+
+static void
+bench_num_to_words (gpointer data, guint64 iteration)
+{
+  const NumRange *range = data;
+  char buffer[STRING_LEN];
+
+  /* Multiplicative hashing spreads the values over the whole range */
+  uint32_t num = range->base + (uint32_t) ((iteration * 2654435761u) % range->span);
+
+  bench_consume (num_to_words (buffer, STRING_LEN, num));
+}
+
+static const char *AMOUNTS[] = {
+  "0.01",
+  "7",
+  "42.50",
+  "100.00",
+  "1,234.56",
+  "98,765.43",
+  "1,000,000.00",
+  "4,294,967,295.99",
+};
+
+static void
+bench_check_data_set_amount (gpointer data, guint64 iteration)
+{
+  CheckData *check_data = data;
+
+  check_data_set_amount (check_data, AMOUNTS[iteration % G_N_ELEMENTS (AMOUNTS)], NUM_WORDS_EN_US);
+  bench_consume ((guchar) check_data->amount_in_words[0]);
+}
+
+static void
+bench_check_data_set_sample (gpointer data, guint64 iteration)
+{
+  CheckData *check_data = data;
+
+  (void) iteration;
+
+  check_data_set_sample (check_data);
+  bench_consume ((guchar) check_data->memo[0]);
+}
+
+#define BENCH_BATCH_CHECKS (100000)
+
+static CheckBatch *
+bench_batch_new (void)
+{
+  CheckBatch *batch = check_batch_new ();
+  char name[STRING_LEN], memo[STRING_LEN], check_number[STRING_LEN];
+
+  /* Payees and memos repeat, as they do in payroll and vendor runs */
+  for (guint i = 0; i < BENCH_BATCH_CHECKS; ++i)
+    {
+      g_snprintf (name, sizeof (name), "Payee number %u", (i * 2654435761u) % 1000);
+      g_snprintf (memo, sizeof (memo), "Invoice batch %u", i % 50);
+      g_snprintf (check_number, sizeof (check_number), "%u", 1001 + i);
+      check_batch_append (batch, "01/31/2025", name, (gint64) i * 137, memo,
+                          check_number, "011000015", "123456789");
+    }
+
+  return batch;
+}
+
+static void
+bench_check_batch_get (gpointer data, guint64 iteration)
+{
+  const CheckBatch *batch = data;
+  CheckData check_data;
+
+  check_batch_get (batch, (guint) (iteration % BENCH_BATCH_CHECKS), NUM_WORDS_EN_US, &check_data);
+  bench_consume ((guchar) check_data.amount_in_words[0]);
+}
+
+int
+main (void)
+{
+  static const struct
+  {
+    const char *name;
+    NumRange range;
+  } num_ranges[] = {
+    { "num_to_words/0-999", { 0, 1000 } },
+    { "num_to_words/thousands", { 1000, 999000 } },
+    { "num_to_words/millions", { 1000000, 999000000 } },
+    { "num_to_words/billions", { 1000000000, G_MAXUINT32 - 1000000000 } },
+    { "num_to_words/full-range", { 0, G_MAXUINT32 } },
+  };
+  CheckData *check_data = g_new0 (CheckData, 1);
+  CheckBatch *batch = bench_batch_new ();
+  BenchSuite suite;
+
+  bench_suite_begin (&suite, "hot-paths");
+
+  for (gsize i = 0; i < G_N_ELEMENTS (num_ranges); ++i)
+    {
+      bench_suite_run (&suite, num_ranges[i].name, bench_num_to_words,
+                       (gpointer) &num_ranges[i].range);
+    }
+
+  bench_suite_run (&suite, "check_data_set_amount", bench_check_data_set_amount, check_data);
+  bench_suite_run (&suite, "check_data_set_sample", bench_check_data_set_sample, check_data);
+  bench_suite_run (&suite, "check_batch_get", bench_check_batch_get, batch);
+
+  bench_suite_end (&suite);
+
+  g_printerr ("check batch: %.1f bytes per check, CheckData array: %zu bytes per check\n",
+              (double) check_batch_get_memory_size (batch) / BENCH_BATCH_CHECKS,
+              sizeof (CheckData));
+
+  check_batch_free (batch);
+  g_free (check_data);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Journals checks with a sync after every entry and with the group size used
+ * for printing, in temporary files. Each journal is then read back and must
+ * hold every entry in order, must survive a torn record at its end, and must
+ * not be opened by a second handle while the first one is appending; the
+ * benchmark fails otherwise.
+ */
+
+#include "bench-common.h"
+#include "check-journal.h"
+
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BENCH_PAYEE ("Pacific Freight Logistics")
+#define BENCH_DATE ("03/14/2024")
+#define BENCH_MEMO ("Invoice 4471")
+
+typedef struct
+{
+  char *path;
+  CheckJournal *journal;
+  CheckData check_data;
+  guint32 layout_id;
+  guint64 n_checked;
+  bool mismatch;
+} BenchData;
+
+static void
+bench_append (gpointer data, guint64 iteration)
+{
+  BenchData *bench = data;
+  g_autoptr (GError) error = NULL;
+
+  g_snprintf (bench->check_data.check_number, STRING_LEN, "%" G_GUINT64_FORMAT, 1000 + iteration);
+
+  if (!check_journal_append (bench->journal, &bench->check_data, (gint64) iteration * 100,
+                             bench->layout_id, &error))
+    {
+      g_printerr ("Could not journal: %s\n", error->message);
+      exit (EXIT_FAILURE);
+    }
+
+  bench_consume (check_journal_get_n_entries (bench->journal));
+}
+
+/* Calibration restarts the iteration count, so numbers repeat in the file */
+static gboolean
+check_entry (const CheckJournalRecord *record, gpointer user_data)
+{
+  BenchData *bench = user_data;
+  char payee[STRING_LEN], date[STRING_LEN], memo[STRING_LEN], check_number[STRING_LEN];
+
+  check_journal_record_get_string (record, CHECK_JOURNAL_PAYEE, payee, STRING_LEN);
+  check_journal_record_get_string (record, CHECK_JOURNAL_DATE, date, STRING_LEN);
+  check_journal_record_get_string (record, CHECK_JOURNAL_MEMO, memo, STRING_LEN);
+  check_journal_record_get_string (record, CHECK_JOURNAL_CHECK_NUMBER, check_number, STRING_LEN);
+
+  if (record->sequence != bench->n_checked
+      || record->layout_id != bench->layout_id
+      || strcmp (payee, bench->check_data.name) != 0
+      || strcmp (date, bench->check_data.date) != 0
+      || strcmp (memo, bench->check_data.memo) != 0
+      || g_ascii_strtoll (check_number, NULL, 10) != 1000 + (record->cents / 100))
+    {
+      g_printerr ("Mismatch at entry %" G_GUINT64_FORMAT "\n", bench->n_checked);
+      bench->mismatch = true;
+      return FALSE;
+    }
+
+  ++bench->n_checked;
+
+  return TRUE;
+}
+
+static bool
+check_journal_file (BenchData *bench, guint64 n_entries)
+{
+  g_autoptr (GError) error = NULL;
+
+  bench->n_checked = 0;
+  bench->mismatch = false;
+
+  if (!check_journal_foreach (bench->path, check_entry, bench, &error))
+    {
+      g_printerr ("Could not read the journal: %s\n", error->message);
+      return false;
+    }
+
+  return !bench->mismatch && bench->n_checked == n_entries;
+}
+
+/* A second handle on the journal of `bench` must be refused, not append too */
+static bool
+check_journal_locked (const BenchData *bench, guint group_size)
+{
+  g_autoptr (GError) error = NULL;
+  g_autoptr (CheckJournal) other = check_journal_open (bench->path, group_size, &error);
+
+  if (other || !g_error_matches (error, CHECK_JOURNAL_ERROR, CHECK_JOURNAL_ERROR_BUSY))
+    {
+      g_printerr ("Journal %s was opened twice: %s\n", bench->path, error ? error->message : "no error");
+      return false;
+    }
+
+  return true;
+}
+
+static bool
+run_case (BenchSuite *suite, const char *name, guint group_size, double *ns_per_op)
+{
+  g_autoptr (GError) error = NULL;
+  BenchData bench = { 0 };
+  CheckProperties check_prop;
+  guint64 n_entries;
+  bool ok;
+  FILE *file;
+  int fd;
+
+  memset (&check_prop, 0, sizeof (CheckProperties));
+  g_strlcpy (check_prop.check_font, "Courier", STRING_LEN);
+  check_prop.check_font_height = 10;
+  check_prop.width = 152.4;
+  check_prop.height = 70.0;
+  bench.layout_id = check_journal_get_layout_id (&check_prop);
+
+  memset (&bench.check_data, 0, sizeof (CheckData));
+  g_strlcpy (bench.check_data.name, BENCH_PAYEE, STRING_LEN);
+  g_strlcpy (bench.check_data.date, BENCH_DATE, STRING_LEN);
+  g_strlcpy (bench.check_data.memo, BENCH_MEMO, STRING_LEN);
+
+  fd = g_file_open_tmp ("checkwriter-journal-XXXXXX", &bench.path, &error);
+
+  if (fd < 0)
+    {
+      g_printerr ("Could not create a journal: %s\n", error->message);
+      return false;
+    }
+
+  close (fd);
+
+  bench.journal = check_journal_open (bench.path, group_size, &error);
+
+  if (!bench.journal)
+    {
+      g_printerr ("Could not open the journal: %s\n", error->message);
+      g_unlink (bench.path);
+      g_free (bench.path);
+      return false;
+    }
+
+  *ns_per_op = bench_suite_run (suite, name, bench_append, &bench);
+
+  n_entries = check_journal_get_n_entries (bench.journal);
+  check_journal_free (bench.journal);
+
+  ok = check_journal_file (&bench, n_entries);
+
+  /* A record cut short by a crash is dropped and appending carries on */
+  file = fopen (bench.path, "ab");
+  ok = ok && file && fwrite ("\x30\0\0\0torn", 1, 8, file) == 8;
+
+  if (file)
+    {
+      fclose (file);
+    }
+
+  bench.journal = ok ? check_journal_open (bench.path, group_size, &error) : NULL;
+  ok = bench.journal && check_journal_get_n_entries (bench.journal) == n_entries;
+  ok = ok && check_journal_locked (&bench, group_size);
+
+  if (ok)
+    {
+      bench_append (&bench, n_entries);
+    }
+
+  g_clear_pointer (&bench.journal, check_journal_free);
+  ok = ok && check_journal_file (&bench, n_entries + 1);
+
+  if (!ok)
+    {
+      g_printerr ("Journal %s did not survive a torn record\n", name);
+    }
+
+  g_unlink (bench.path);
+  g_free (bench.path);
+
+  return ok;
+}
+
+int
+main (int argc, char *argv[])
+{
+  double each_ns, group_ns;
+  BenchSuite suite;
+  bool ok;
+
+  bench_init (argc, argv);
+
+  bench_suite_begin (&suite, "journal");
+  ok = run_case (&suite, "append/sync_each", 1, &each_ns);
+  ok = ok && run_case (&suite, "append/group_commit", CHECK_JOURNAL_GROUP_SIZE, &group_ns);
+  bench_suite_end (&suite);
+
+  if (!ok)
+    {
+      return EXIT_FAILURE;
+    }
+
+  g_printerr ("Group commit of %d entries: %.1fx the appends per second\n",
+              CHECK_JOURNAL_GROUP_SIZE, each_ns / group_ns);
+
+  return EXIT_SUCCESS;
+}
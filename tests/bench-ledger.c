@@ -0,0 +1,380 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Ledger lookups in a journal of 500k generated checks: by number, by payee
+ * within a quarter and by day, next to a full scan of the journal for the
+ * same query. Some checks are journaled after the index file is written, so
+ * lookups merge both runs. Every query must find the same checks as the
+ * scan; the benchmark fails otherwise. Opening the ledger, with and without
+ * building the index file, is timed once and reported on stderr.
+ */
+
+#include "bench-common.h"
+#include "check-ledger.h"
+
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BENCH_CHECKS (bench_size (500000, 5000))
+#define BENCH_RECENT (bench_size (5000, 500))
+#define BENCH_QUERIES (1024)
+
+static const char *WORDS[] = {
+  "Acme", "Allied", "Apex", "Atlas", "Blue", "Capital", "Central", "Coastal",
+  "Delta", "Eagle", "Empire", "First", "Global", "Golden", "Harbor", "Horizon",
+  "Liberty", "Metro", "National", "North", "Pacific", "Pioneer", "Premier",
+  "Summit", "United", "Valley", "Western",
+};
+
+static const char *KINDS[] = {
+  "Supply", "Logistics", "Electric", "Plumbing", "Foods", "Printing",
+  "Hardware", "Consulting", "Services", "Freight",
+};
+
+typedef enum
+{
+  QUERY_NUMBER,
+  QUERY_PAYEE,
+  QUERY_DATE,
+  N_QUERY_KINDS,
+} QueryKind;
+
+typedef struct
+{
+  char number[16];
+  char payee[64];
+  char first_date[16]; /* A quarter for payees, one day for dates */
+  char last_date[16];
+} Query;
+
+typedef struct
+{
+  const Query *query;
+  QueryKind kind;
+  guint32 first, last;
+  guint64 n_found;
+  guint64 sequence_sum;
+} QueryResult;
+
+typedef struct
+{
+  char *path;
+  CheckLedger *ledger;
+  Query queries[BENCH_QUERIES];
+} BenchData;
+
+static void
+random_payee (GRand *rand, char *payee, gsize len)
+{
+  g_snprintf (payee, len, "%s %s",
+              WORDS[g_rand_int_range (rand, 0, G_N_ELEMENTS (WORDS))],
+              KINDS[g_rand_int_range (rand, 0, G_N_ELEMENTS (KINDS))]);
+}
+
+static void
+random_date (GRand *rand, char *date, gsize len)
+{
+  g_snprintf (date, len, "%02d/%02d/%04d", g_rand_int_range (rand, 1, 13),
+              g_rand_int_range (rand, 1, 29), g_rand_int_range (rand, 2022, 2025));
+}
+
+static bool
+journal_checks (const char *path, guint first, guint n_checks, GRand *rand)
+{
+  g_autoptr (GError) error = NULL;
+  g_autoptr (CheckJournal) journal = check_journal_open (path, 4096, &error);
+  CheckData check_data;
+
+  if (!journal)
+    {
+      g_printerr ("Could not open the journal: %s\n", error->message);
+      return false;
+    }
+
+  memset (&check_data, 0, sizeof (CheckData));
+  g_strlcpy (check_data.memo, "Invoice", STRING_LEN);
+
+  for (guint i = first; i < first + n_checks; ++i)
+    {
+      g_snprintf (check_data.check_number, STRING_LEN, "%u", 1000 + i);
+      random_payee (rand, check_data.name, STRING_LEN);
+
+      /* Mix the case, payees are looked up ignoring it */
+      if ((i % 7) == 0)
+        {
+          check_data.name[0] = g_ascii_tolower (check_data.name[0]);
+        }
+
+      random_date (rand, check_data.date, STRING_LEN);
+
+      if (!check_journal_append (journal, &check_data, g_rand_int_range (rand, 1, 1000000), 0, &error))
+        {
+          g_printerr ("Could not journal: %s\n", error->message);
+          return false;
+        }
+    }
+
+  return true;
+}
+
+static gboolean
+count_record (const CheckJournalRecord *record, gpointer user_data)
+{
+  QueryResult *result = user_data;
+
+  ++result->n_found;
+  result->sequence_sum += record->sequence;
+
+  return TRUE;
+}
+
+/* The query evaluated on every record, for reference */
+static gboolean
+scan_record (const CheckJournalRecord *record, gpointer user_data)
+{
+  QueryResult *result = user_data;
+  char text[STRING_LEN];
+  guint32 date;
+  bool match = false;
+
+  switch (result->kind)
+    {
+    case QUERY_NUMBER:
+      check_journal_record_get_string (record, CHECK_JOURNAL_CHECK_NUMBER, text, STRING_LEN);
+      match = strcmp (text, result->query->number) == 0;
+      break;
+
+    case QUERY_PAYEE:
+      check_journal_record_get_string (record, CHECK_JOURNAL_PAYEE, text, STRING_LEN);
+      date = check_ledger_parse_date (record->strings[CHECK_JOURNAL_DATE], record->lengths[CHECK_JOURNAL_DATE]);
+      match = g_ascii_strcasecmp (text, result->query->payee) == 0 && date >= result->first && date <= result->last;
+      break;
+
+    case QUERY_DATE:
+      date = check_ledger_parse_date (record->strings[CHECK_JOURNAL_DATE], record->lengths[CHECK_JOURNAL_DATE]);
+      match = date >= result->first && date <= result->last;
+      break;
+
+    default:
+      g_assert_not_reached ();
+    }
+
+  return match ? count_record (record, result) : TRUE;
+}
+
+static void
+run_query (const CheckLedger *ledger, QueryResult *result)
+{
+  const Query *query = result->query;
+
+  switch (result->kind)
+    {
+    case QUERY_NUMBER:
+      check_ledger_find_number (ledger, query->number, query->number, count_record, result);
+      break;
+
+    case QUERY_PAYEE:
+      check_ledger_find_payee (ledger, query->payee, query->first_date, query->last_date, count_record, result);
+      break;
+
+    case QUERY_DATE:
+      check_ledger_find_date (ledger, query->first_date, query->last_date, count_record, result);
+      break;
+
+    default:
+      g_assert_not_reached ();
+    }
+}
+
+static void
+query_result_init (QueryResult *result, const Query *query, QueryKind kind)
+{
+  memset (result, 0, sizeof (QueryResult));
+  result->query = query;
+  result->kind = kind;
+  result->first = check_ledger_parse_date (query->first_date, strlen (query->first_date));
+  result->last = check_ledger_parse_date (query->last_date, strlen (query->last_date));
+}
+
+static bool
+check_queries (const BenchData *bench)
+{
+  for (guint i = 0; i < BENCH_QUERIES; i += 64)
+    {
+      for (int kind = 0; kind < N_QUERY_KINDS; ++kind)
+        {
+          QueryResult indexed, scanned;
+
+          query_result_init (&indexed, &bench->queries[i], kind);
+          query_result_init (&scanned, &bench->queries[i], kind);
+
+          run_query (bench->ledger, &indexed);
+          check_journal_foreach (bench->path, scan_record, &scanned, NULL);
+
+          if (indexed.n_found != scanned.n_found || indexed.sequence_sum != scanned.sequence_sum)
+            {
+              g_printerr ("Mismatch for query %u of kind %d: %" G_GUINT64_FORMAT " != %" G_GUINT64_FORMAT "\n",
+                          i, kind, indexed.n_found, scanned.n_found);
+              return false;
+            }
+        }
+    }
+
+  return true;
+}
+
+static void
+bench_scan_payee (gpointer data, guint64 iteration)
+{
+  const BenchData *bench = data;
+  QueryResult result;
+
+  query_result_init (&result, &bench->queries[iteration % BENCH_QUERIES], QUERY_PAYEE);
+  check_journal_foreach (bench->path, scan_record, &result, NULL);
+  bench_consume (result.n_found);
+}
+
+static void
+bench_find (const BenchData *bench, guint64 iteration, QueryKind kind)
+{
+  QueryResult result;
+
+  query_result_init (&result, &bench->queries[iteration % BENCH_QUERIES], kind);
+  run_query (bench->ledger, &result);
+  bench_consume (result.n_found);
+}
+
+static void
+bench_find_number (gpointer data, guint64 iteration)
+{
+  bench_find (data, iteration, QUERY_NUMBER);
+}
+
+static void
+bench_find_payee (gpointer data, guint64 iteration)
+{
+  bench_find (data, iteration, QUERY_PAYEE);
+}
+
+static void
+bench_find_date (gpointer data, guint64 iteration)
+{
+  bench_find (data, iteration, QUERY_DATE);
+}
+
+static CheckLedger *
+open_ledger (const char *path, const char *what)
+{
+  g_autoptr (GError) error = NULL;
+  gint64 start = g_get_monotonic_time ();
+  CheckLedger *ledger = check_ledger_open (path, &error);
+
+  if (!ledger)
+    {
+      g_printerr ("Could not open the ledger: %s\n", error->message);
+      return NULL;
+    }
+
+  g_printerr ("Opened a ledger of %" G_GUINT64_FORMAT " checks %s in %.1f ms\n",
+              check_ledger_get_n_checks (ledger), what, (g_get_monotonic_time () - start) / 1000.0);
+
+  return ledger;
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_autoptr (GError) error = NULL;
+  g_autofree char *index_path = NULL;
+  GRand *rand = g_rand_new_with_seed (0xC4EC);
+  BenchData *bench = g_new0 (BenchData, 1);
+  double scan_ns, payee_ns;
+  BenchSuite suite;
+  bool ok;
+  int fd;
+
+  bench_init (argc, argv);
+
+  fd = g_file_open_tmp ("checkwriter-ledger-XXXXXX", &bench->path, &error);
+
+  if (fd < 0)
+    {
+      g_printerr ("Could not create a journal: %s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  close (fd);
+  index_path = g_strconcat (bench->path, ".index", NULL);
+
+  ok = journal_checks (bench->path, 0, BENCH_CHECKS, rand);
+  ok = ok && (bench->ledger = open_ledger (bench->path, "building the index")) != NULL;
+
+  /* Journaled after the index file, these are the second run */
+  g_clear_pointer (&bench->ledger, check_ledger_free);
+  ok = ok && journal_checks (bench->path, BENCH_CHECKS, BENCH_RECENT, rand);
+  ok = ok && (bench->ledger = open_ledger (bench->path, "from the index")) != NULL;
+
+  for (guint i = 0; i < BENCH_QUERIES; ++i)
+    {
+      Query *query = &bench->queries[i];
+      int quarter = g_rand_int_range (rand, 0, 4);
+      int year = g_rand_int_range (rand, 2022, 2025);
+
+      g_snprintf (query->number, sizeof (query->number), "%u",
+                  1000 + g_rand_int_range (rand, 0, BENCH_CHECKS + BENCH_RECENT));
+      random_payee (rand, query->payee, sizeof (query->payee));
+      g_snprintf (query->first_date, sizeof (query->first_date), "%02d/01/%04d", (quarter * 3) + 1, year);
+      g_snprintf (query->last_date, sizeof (query->last_date), "%02d/31/%04d", (quarter * 3) + 3, year);
+
+      /* Every other date query is a single day */
+      if (i & 1)
+        {
+          random_date (rand, query->first_date, sizeof (query->first_date));
+          memcpy (query->last_date, query->first_date, sizeof (query->last_date));
+        }
+    }
+
+  g_rand_free (rand);
+
+  ok = ok && check_queries (bench);
+
+  if (ok)
+    {
+      bench_suite_begin (&suite, "ledger");
+      scan_ns = bench_suite_run (&suite, "payee_quarter/scan", bench_scan_payee, bench);
+      payee_ns = bench_suite_run (&suite, "payee_quarter/indexed", bench_find_payee, bench);
+      bench_suite_run (&suite, "number/indexed", bench_find_number, bench);
+      bench_suite_run (&suite, "date/indexed", bench_find_date, bench);
+      bench_suite_end (&suite);
+
+      g_printerr ("check_ledger_find_payee speedup over a scan: %.1fx\n", scan_ns / payee_ns);
+    }
+
+  g_clear_pointer (&bench->ledger, check_ledger_free);
+  g_unlink (index_path);
+  g_unlink (bench->path);
+  g_free (bench->path);
+  g_free (bench);
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Checks routing number validation and MICR line layout against a table of
+ * cases, failing on any mismatch. Then times drawing the MICR line of a 300
+ * DPI check from the cached glyph paths, next to drawing the same line as
+ * text with the check font for reference.
+ */
+
+#include "bench-common.h"
+#include "check-micr.h"
+#include "check-properties.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_DPI (300.0)
+
+typedef struct
+{
+  const char *check_number;
+  const char *routing;
+  const char *account;
+  CheckMicrStatus status;
+  const char *line; /* When valid */
+} MicrCase;
+
+static const MicrCase MICR_CASES[] = {
+  { "", "", "", CHECK_MICR_OK, "" },
+  { "1001", "011000015", "123456789", CHECK_MICR_OK,
+    "A011000015A    123456789C 1001             " },
+  { "", "121000358", "12-345 6", CHECK_MICR_OK,
+    "A121000358A          12D345 6C             " },
+  { "42", "026009593", "", CHECK_MICR_OK,
+    "A026009593A                 42             " },
+  { "1001", "", "123456789", CHECK_MICR_ERROR_ROUTING, NULL },
+  { "1001", "01100001", "123456789", CHECK_MICR_ERROR_ROUTING, NULL },
+  { "1001", "01100001x", "123456789", CHECK_MICR_ERROR_ROUTING, NULL },
+  { "1001", "011000016", "123456789", CHECK_MICR_ERROR_CHECKSUM, NULL },
+  { "1001", "011000015", "1234/5678", CHECK_MICR_ERROR_ACCOUNT, NULL },
+  { "10a1", "011000015", "123456789", CHECK_MICR_ERROR_CHECK_NUMBER, NULL },
+  { "123456", "011000015", "12345678901", CHECK_MICR_ERROR_TOO_LONG, NULL },
+};
+
+typedef struct
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  CheckRenderPlan plan;
+  CheckData check_data;
+} BenchData;
+
+static bool
+check_micr_cases (void)
+{
+  for (gsize i = 0; i < G_N_ELEMENTS (MICR_CASES); ++i)
+    {
+      const MicrCase *test = &MICR_CASES[i];
+      char line[CHECK_MICR_LINE_LEN];
+      CheckMicrStatus status;
+
+      status = check_micr_format_line (line, sizeof (line), test->check_number,
+                                       test->routing, test->account);
+
+      if (status != test->status || (status == CHECK_MICR_OK && strcmp (line, test->line) != 0))
+        {
+          g_printerr ("Mismatch for \"%s\" \"%s\" \"%s\": status %d, line \"%s\"\n",
+                      test->check_number, test->routing, test->account, status, line);
+          return false;
+        }
+    }
+
+  /* Every single digit error breaks the checksum */
+  for (int position = 0; position < 9; ++position)
+    {
+      char routing[] = "011000015";
+
+      for (char digit = '0'; digit <= '9'; ++digit)
+        {
+          if (digit != routing[position])
+            {
+              char changed[sizeof (routing)];
+
+              memcpy (changed, routing, sizeof (routing));
+              changed[position] = digit;
+
+              if (check_micr_routing_is_valid (changed))
+                {
+                  g_printerr ("Checksum accepted \"%s\"\n", changed);
+                  return false;
+                }
+            }
+        }
+    }
+
+  return true;
+}
+
+static void
+bench_micr_path_table (gpointer data, guint64 iteration)
+{
+  BenchData *bench = data;
+
+  (void) iteration;
+
+  render_check_plan_field (bench->cr, &bench->plan, CHECK_FIELD_MICR, &bench->check_data);
+  bench_consume (cairo_status (bench->cr));
+}
+
+static void
+bench_micr_show_text (gpointer data, guint64 iteration)
+{
+  BenchData *bench = data;
+
+  (void) iteration;
+
+  cairo_set_scaled_font (bench->cr, bench->plan.fonts.field_font);
+  cairo_move_to (bench->cr, bench->plan.micr.x, bench->plan.micr.y);
+  cairo_show_text (bench->cr, bench->check_data.micr);
+  bench_consume (cairo_status (bench->cr));
+}
+
+int
+main (int argc, char *argv[])
+{
+  DisplayProperties display;
+  CheckProperties check_prop;
+  BenchData bench;
+  double table_ns, text_ns;
+  BenchSuite suite;
+
+  bench_init (argc, argv);
+
+  if (!check_micr_cases ())
+    {
+      return EXIT_FAILURE;
+    }
+
+  memset (&check_prop, 0, sizeof (CheckProperties));
+  g_strlcpy (check_prop.check_font, "Courier", STRING_LEN);
+  check_prop.check_font_height = 10;
+  check_prop.width = 152.4;
+  check_prop.height = 70.0;
+  check_micr_get_standard_position (check_prop.width, check_prop.height, &check_prop.micr);
+  check_prop.magic = CHECK_PROPERTIES_MAGIC;
+
+  display.x_dpi = BENCH_DPI;
+  display.y_dpi = BENCH_DPI;
+  display.width = (check_prop.width * BENCH_DPI) / INCH_PER_MM;
+  display.height = (check_prop.height * BENCH_DPI) / INCH_PER_MM;
+
+  bench.surface = cairo_image_surface_create (CAIRO_FORMAT_A8, (int) display.width, (int) display.height);
+  bench.cr = cairo_create (bench.surface);
+
+  check_render_plan_init (&bench.plan);
+  check_render_plan_update (&bench.plan, bench.cr, &display, &check_prop, CHECK_WRITE);
+
+  check_data_init (&bench.check_data);
+  check_data_set_micr (&bench.check_data, "1001", "011000015", "123456789");
+
+  bench_suite_begin (&suite, "micr");
+  table_ns = bench_suite_run (&suite, "micr_line/path_table", bench_micr_path_table, &bench);
+  text_ns = bench_suite_run (&suite, "micr_line/show_text", bench_micr_show_text, &bench);
+  bench_suite_end (&suite);
+
+  g_printerr ("MICR line from the path table: %.2fx the cost of text\n", table_ns / text_ns);
+
+  check_render_plan_clear (&bench.plan);
+  cairo_destroy (bench.cr);
+  cairo_surface_destroy (bench.surface);
+
+  return EXIT_SUCCESS;
+}
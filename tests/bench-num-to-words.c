@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Compares num_to_words () against the previous recursive implementation,
+ * which used log10 ()/pow () and snprintf () at every level. Both must
+ * produce identical output; the benchmark fails otherwise. Every other
+ * language is then checked against a few known phrases and timed on the
+ * same values.
+ */
+
+#include "bench-common.h"
+#include "check-properties.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_VALUES (4096)
+
+static const char *LEGACY_UNIT[] = {
+  "zero", "one", "two", "three", "four", "five", "six", "seven", "eight",
+  "nine", "ten", "eleven", "twelve", "thirteen", "fourteen", "fifteen",
+  "sixteen", "seventeen", "eighteen", "nineteen",
+};
+
+static const char *LEGACY_TENS[] = {
+  "", "ten", "twenty", "thirty", "forty", "fifty", "sixty", "seventy",
+  "eighty", "ninety",
+};
+
+static const char *LEGACY_WEIGHT[] = {
+  "", "thousand", "million", "billion",
+};
+
+static int
+legacy_num_to_words (char *dst, size_t len, uint32_t num)
+{
+  char *const start = dst;
+  char *const end = dst + len;
+  char *cur = dst;
+  uint32_t ex, val, msd, rem;
+  int written = 0;
+
+  memset (dst, 'x', len);
+
+  if (num >= 1000)
+    {
+      ex = floor (log10 (num)) / 3;
+      val = pow (10.0, ex * 3);
+      msd = num / val;
+      rem = num % val;
+
+      cur += legacy_num_to_words (cur, end - cur, msd);
+      cur += snprintf (cur, end - cur, " %s", LEGACY_WEIGHT[ex]);
+
+      if (rem)
+        {
+          *(cur++) = ' ';
+          cur += legacy_num_to_words (cur, end - cur, rem);
+        }
+
+      return cur - start;
+    }
+  else if (num >= 100)
+    {
+      msd = num / 100;
+      rem = num % 100;
+
+      cur += snprintf (cur, end - cur, "%s hundred", LEGACY_UNIT[msd]);
+
+      if (rem)
+        {
+          *(cur++) = ' ';
+          cur += legacy_num_to_words (cur, end - cur, rem);
+        }
+
+      return cur - start;
+    }
+  else if (num >= 20)
+    {
+      cur += snprintf (cur, end - cur, "%s", LEGACY_TENS[num / 10]);
+
+      if (num % 10)
+        {
+          cur += snprintf (cur, end - cur, "-%s", LEGACY_UNIT[num % 10]);
+        }
+
+      return cur - start;
+    }
+
+  written = snprintf (cur, end - cur, "%s", LEGACY_UNIT[num]);
+  return written;
+}
+
+typedef int (*NumToWordsFunc) (char *dst, size_t len, uint32_t num);
+
+typedef struct
+{
+  NumToWordsFunc func;
+  const uint32_t *values;
+  NumWordsLocale locale;
+} BenchData;
+
+typedef struct
+{
+  NumWordsLocale locale;
+  uint32_t num;
+  const char *words;
+} KnownPhrase;
+
+static const KnownPhrase KNOWN_PHRASES[] = {
+  { NUM_WORDS_EN_US, 1012, "one thousand twelve" },
+  { NUM_WORDS_EN_GB, 1040, "one thousand and forty" },
+  { NUM_WORDS_EN_GB, 201000, "two hundred and one thousand" },
+  { NUM_WORDS_ES, 21000, "veintiún mil" },
+  { NUM_WORDS_ES, 1001000000, "mil un millones" },
+  { NUM_WORDS_ES, 3000000100u, "tres mil millones cien" },
+  { NUM_WORDS_FR, 80, "quatre-vingts" },
+  { NUM_WORDS_FR, 280071, "deux cent quatre-vingt mille soixante et onze" },
+  { NUM_WORDS_FR, 200000000, "deux cents millions" },
+  { NUM_WORDS_DE, 1001, "eintausendeins" },
+  { NUM_WORDS_DE, 2031000000, "zwei Milliarden einunddreißig Millionen" },
+};
+
+static void
+bench_convert (gpointer data, guint64 iteration)
+{
+  const BenchData *bench = data;
+  char buffer[STRING_LEN];
+
+  bench_consume (bench->func (buffer, STRING_LEN, bench->values[iteration % BENCH_VALUES]));
+}
+
+static void
+bench_convert_locale (gpointer data, guint64 iteration)
+{
+  const BenchData *bench = data;
+  char buffer[STRING_LEN];
+
+  bench_consume (num_to_words_locale (buffer, STRING_LEN, bench->values[iteration % BENCH_VALUES],
+                                      bench->locale));
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t values[BENCH_VALUES];
+  char expected[STRING_LEN], actual[STRING_LEN];
+  BenchData legacy = { legacy_num_to_words, values, NUM_WORDS_EN_US };
+  BenchData table = { num_to_words, values, NUM_WORDS_EN_US };
+  double legacy_ns, table_ns;
+  GRand *rand = g_rand_new_with_seed (0xC4EC);
+  BenchSuite suite;
+
+  bench_init (argc, argv);
+
+  /* Spread the values over every magnitude of the uint32_t range */
+  for (int i = 0; i < BENCH_VALUES; ++i)
+    {
+      uint32_t magnitude = 1u << (i % 32);
+      values[i] = g_rand_int (rand) % magnitude + (magnitude >> 1);
+    }
+
+  g_rand_free (rand);
+
+  for (int i = 0; i < BENCH_VALUES; ++i)
+    {
+      legacy_num_to_words (expected, STRING_LEN, values[i]);
+      num_to_words (actual, STRING_LEN, values[i]);
+
+      if (strcmp (expected, actual) != 0)
+        {
+          g_printerr ("Mismatch for %u: \"%s\" != \"%s\"\n", values[i], actual, expected);
+          return EXIT_FAILURE;
+        }
+    }
+
+  for (guint i = 0; i < G_N_ELEMENTS (KNOWN_PHRASES); ++i)
+    {
+      const KnownPhrase *known = &KNOWN_PHRASES[i];
+
+      num_to_words_locale (actual, STRING_LEN, known->num, known->locale);
+
+      if (strcmp (known->words, actual) != 0)
+        {
+          g_printerr ("Mismatch for %u in %s: \"%s\" != \"%s\"\n", known->num,
+                      num_words_locale_to_name (known->locale), actual, known->words);
+          return EXIT_FAILURE;
+        }
+    }
+
+  bench_suite_begin (&suite, "num-to-words");
+  legacy_ns = bench_suite_run (&suite, "num_to_words/legacy", bench_convert, &legacy);
+  table_ns = bench_suite_run (&suite, "num_to_words/table", bench_convert, &table);
+
+  for (int i = 0; i < NUM_WORDS_N_LOCALES; ++i)
+    {
+      g_autofree char *name = g_strdup_printf ("num_to_words_locale/%s", num_words_locale_to_name (i));
+      BenchData locale = { NULL, values, i };
+      double locale_ns;
+
+      locale_ns = bench_suite_run (&suite, name, bench_convert_locale, &locale);
+      g_printerr ("%s: %.1f ns, %.2fx English\n", num_words_locale_to_name (i), locale_ns,
+                  locale_ns / table_ns);
+    }
+
+  bench_suite_end (&suite);
+
+  g_printerr ("num_to_words speedup: %.1fx\n", legacy_ns / table_ns);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Prefix lookups in a directory of 500k generated vendor names, compared
+ * against a linear scan over the same names. Both must find the same
+ * number of payees; the benchmark fails otherwise. Opening the (unsorted)
+ * file is timed once and reported on stderr.
+ */
+
+#include "bench-common.h"
+#include "check-payees.h"
+
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BENCH_PAYEES (bench_size (500000, 5000))
+#define BENCH_PREFIXES (1024)
+
+static const char *WORDS[] = {
+  "Acme", "Allied", "Apex", "Atlas", "Blue", "Capital", "Central", "Coastal",
+  "Delta", "Eagle", "Empire", "First", "Global", "Golden", "Harbor", "Horizon",
+  "Liberty", "Metro", "National", "North", "Pacific", "Pioneer", "Premier",
+  "Summit", "United", "Valley", "Western",
+};
+
+static const char *KINDS[] = {
+  "Supply", "Logistics", "Electric", "Plumbing", "Foods", "Printing",
+  "Hardware", "Consulting", "Services", "Freight",
+};
+
+typedef struct
+{
+  const CheckPayeeDirectory *directory;
+  char prefixes[BENCH_PREFIXES][8];
+} BenchData;
+
+static guint
+linear_find_prefix (const CheckPayeeDirectory *directory, const char *prefix)
+{
+  gsize prefix_len = strlen (prefix);
+  guint n_payees = check_payee_directory_get_n_payees (directory);
+  guint n_matches = 0;
+
+  for (guint i = 0; i < n_payees; ++i)
+    {
+      gsize length;
+      const char *name = check_payee_directory_get_name (directory, i, &length);
+
+      if (length >= prefix_len && g_ascii_strncasecmp (name, prefix, prefix_len) == 0)
+        {
+          ++n_matches;
+        }
+    }
+
+  return n_matches;
+}
+
+static void
+bench_linear (gpointer data, guint64 iteration)
+{
+  const BenchData *bench = data;
+
+  bench_consume (linear_find_prefix (bench->directory, bench->prefixes[iteration % BENCH_PREFIXES]));
+}
+
+static void
+bench_find_prefix (gpointer data, guint64 iteration)
+{
+  const BenchData *bench = data;
+  guint first = 0;
+
+  bench_consume (check_payee_directory_find_prefix (bench->directory,
+                                                    bench->prefixes[iteration % BENCH_PREFIXES],
+                                                    &first));
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_autoptr (GError) error = NULL;
+  g_autoptr (CheckPayeeDirectory) directory = NULL;
+  g_autofree char *path = NULL;
+  GString *contents = g_string_new (NULL);
+  GRand *rand = g_rand_new_with_seed (0xC4EC);
+  BenchData *bench = g_new0 (BenchData, 1);
+  double linear_ns, indexed_ns;
+  gint64 start;
+  BenchSuite suite;
+  int fd;
+
+  bench_init (argc, argv);
+
+  for (guint i = 0; i < BENCH_PAYEES; ++i)
+    {
+      g_string_append_printf (contents, "%s %s %s #%u\n",
+                              WORDS[g_rand_int_range (rand, 0, G_N_ELEMENTS (WORDS))],
+                              WORDS[g_rand_int_range (rand, 0, G_N_ELEMENTS (WORDS))],
+                              KINDS[g_rand_int_range (rand, 0, G_N_ELEMENTS (KINDS))],
+                              g_rand_int_range (rand, 1, 10000));
+    }
+
+  fd = g_file_open_tmp ("checkwriter-payees-XXXXXX.txt", &path, &error);
+
+  if (fd < 0 || !g_file_set_contents (path, contents->str, contents->len, &error))
+    {
+      g_printerr ("Could not write payees: %s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  close (fd);
+  g_string_free (contents, TRUE);
+
+  start = g_get_monotonic_time ();
+  directory = check_payee_directory_open (path, &error);
+
+  if (!directory)
+    {
+      g_printerr ("Could not open payees: %s\n", error->message);
+      g_unlink (path);
+      return EXIT_FAILURE;
+    }
+
+  g_printerr ("Opened %u payees in %.1f ms\n", check_payee_directory_get_n_payees (directory),
+              (g_get_monotonic_time () - start) / 1000.0);
+
+  /* Prefixes of 1 to 6 characters, typed in any case */
+  bench->directory = directory;
+
+  for (guint i = 0; i < BENCH_PREFIXES; ++i)
+    {
+      gsize length;
+      guint index = g_rand_int_range (rand, 0, BENCH_PAYEES);
+      const char *name = check_payee_directory_get_name (directory, index, &length);
+      gsize prefix_len = MIN (length, (gsize) (1 + (i % 6)));
+
+      for (gsize j = 0; j < prefix_len; ++j)
+        {
+          bench->prefixes[i][j] = (i & 1) ? g_ascii_tolower (name[j]) : name[j];
+        }
+    }
+
+  g_rand_free (rand);
+
+  for (guint i = 0; i < BENCH_PREFIXES; i += 16)
+    {
+      guint first = 0;
+      guint expected = linear_find_prefix (directory, bench->prefixes[i]);
+      guint actual = check_payee_directory_find_prefix (directory, bench->prefixes[i], &first);
+
+      if (expected != actual)
+        {
+          g_printerr ("Mismatch for \"%s\": %u != %u\n", bench->prefixes[i], actual, expected);
+          g_unlink (path);
+          return EXIT_FAILURE;
+        }
+    }
+
+  bench_suite_begin (&suite, "payee-directory");
+  linear_ns = bench_suite_run (&suite, "find_prefix/linear", bench_linear, bench);
+  indexed_ns = bench_suite_run (&suite, "find_prefix/sorted", bench_find_prefix, bench);
+  bench_suite_end (&suite);
+
+  g_printerr ("check_payee_directory_find_prefix speedup: %.1fx\n", linear_ns / indexed_ns);
+
+  g_unlink (path);
+  g_free (bench);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Exports a day of 200k checks, out of a journal that also holds other days
+ * and two reprints, as fixed width and CSV Positive Pay files. The first
+ * check is printed again that day, and another one for the next day. Each
+ * file is read back and must hold one well formed line per check of the day,
+ * with the first reprint last and without the check moved to the next day;
+ * the benchmark fails otherwise.
+ */
+
+#include "bench-common.h"
+#include "check-positive-pay.h"
+
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BENCH_CHECKS (bench_size (200000, 2000))
+#define BENCH_OTHER_DAYS (BENCH_CHECKS / 10) /* Every 11th check */
+#define BENCH_DATE ("03/14/2024")
+#define BENCH_ACCOUNT ("0123-456 789")
+#define BENCH_REPRINT_CENTS (4200) /* Check 1000, printed again */
+#define BENCH_REDATED ("1002")       /* Printed again for the next day */
+#define BENCH_WRITTEN (BENCH_CHECKS - 1)
+
+#define FIXED_LINE_LEN (100)
+
+typedef struct
+{
+  char *journal_path;
+  char *path;
+  CheckPositivePayFormat format;
+  guint64 n_checks;
+} BenchData;
+
+static const char *PAYEES[] = {
+  "Pacific Freight Logistics",
+  "Summit \"North\" Hardware",
+  "Caf\xc3\xa9 du Nord",
+};
+
+static bool
+journal_checks (const char *path)
+{
+  g_autoptr (GError) error = NULL;
+  g_autoptr (CheckJournal) journal = check_journal_open (path, 4096, &error);
+  CheckData check_data;
+
+  if (!journal)
+    {
+      g_printerr ("Could not open the journal: %s\n", error->message);
+      return false;
+    }
+
+  memset (&check_data, 0, sizeof (CheckData));
+  g_strlcpy (check_data.routing, "011000015", STRING_LEN);
+  g_strlcpy (check_data.account, BENCH_ACCOUNT, STRING_LEN);
+
+  for (guint i = 0; i < BENCH_CHECKS + BENCH_OTHER_DAYS; ++i)
+    {
+      g_snprintf (check_data.check_number, STRING_LEN, "%u", 1000 + i);
+      g_strlcpy (check_data.name, PAYEES[i % G_N_ELEMENTS (PAYEES)], STRING_LEN);
+      g_strlcpy (check_data.date, (i % 11) == 10 ? "03/15/2024" : BENCH_DATE, STRING_LEN);
+
+      if (!check_journal_append (journal, &check_data, (gint64) i * 101, 0, &error))
+        {
+          g_printerr ("Could not journal: %s\n", error->message);
+          return false;
+        }
+    }
+
+  g_strlcpy (check_data.check_number, "1000", STRING_LEN);
+  g_strlcpy (check_data.name, PAYEES[0], STRING_LEN);
+  g_strlcpy (check_data.date, BENCH_DATE, STRING_LEN);
+
+  if (!check_journal_append (journal, &check_data, BENCH_REPRINT_CENTS, 0, &error))
+    {
+      g_printerr ("Could not journal: %s\n", error->message);
+      return false;
+    }
+
+  g_strlcpy (check_data.check_number, BENCH_REDATED, STRING_LEN);
+  g_strlcpy (check_data.date, "03/15/2024", STRING_LEN);
+
+  if (!check_journal_append (journal, &check_data, 202, 0, &error))
+    {
+      g_printerr ("Could not journal: %s\n", error->message);
+      return false;
+    }
+
+  return true;
+}
+
+static void
+bench_export (gpointer data, guint64 iteration)
+{
+  BenchData *bench = data;
+  g_autoptr (GError) error = NULL;
+
+  if (!check_positive_pay_export (bench->journal_path, bench->path, bench->format,
+                                  BENCH_DATE, BENCH_DATE, &bench->n_checks, &error))
+    {
+      g_printerr ("Could not export: %s\n", error->message);
+      exit (EXIT_FAILURE);
+    }
+
+  bench_consume (bench->n_checks);
+}
+
+static bool
+line_equals (const char *cur, const char *end, const char *line)
+{
+  return strncmp (cur, line, end - cur) == 0 && line[end - cur] == '\0';
+}
+
+/* Every line of the file, the first and last checks against `first` and `last`, and the count */
+static bool
+check_file (const BenchData *bench, const char *first, const char *last)
+{
+  g_autofree char *contents = NULL;
+  gsize length;
+  guint64 n_lines = 0;
+  guint64 n_header = bench->format == CHECK_POSITIVE_PAY_CSV;
+  const char *cur;
+
+  if (!g_file_get_contents (bench->path, &contents, &length, NULL))
+    {
+      return false;
+    }
+
+  for (cur = contents; cur < contents + length;)
+    {
+      const char *end = strstr (cur, "\r\n");
+
+      if (!end
+          || (bench->format == CHECK_POSITIVE_PAY_FIXED && end - cur != FIXED_LINE_LEN - 2)
+          || (n_lines == n_header && !line_equals (cur, end, first))
+          || (n_lines == n_header + BENCH_WRITTEN - 1 && !line_equals (cur, end, last)))
+        {
+          g_printerr ("Unexpected line %" G_GUINT64_FORMAT "\n", n_lines + 1);
+          return false;
+        }
+
+      ++n_lines;
+      cur = end + 2;
+    }
+
+  return n_lines == BENCH_WRITTEN + n_header;
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_autoptr (GError) error = NULL;
+  g_autofree char *fixed_path = NULL;
+  g_autofree char *csv_path = NULL;
+  g_autofree char *index_path = NULL;
+  BenchData fixed = { 0 }, csv = { 0 };
+  double fixed_ns, csv_ns;
+  BenchSuite suite;
+  bool ok;
+  int fd;
+
+  bench_init (argc, argv);
+
+  fd = g_file_open_tmp ("checkwriter-positive-pay-XXXXXX", &fixed.journal_path, &error);
+
+  if (fd < 0)
+    {
+      g_printerr ("Could not create a journal: %s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  close (fd);
+  csv.journal_path = fixed.journal_path;
+  fixed_path = g_strconcat (fixed.journal_path, ".txt", NULL);
+  csv_path = g_strconcat (fixed.journal_path, ".csv", NULL);
+  index_path = g_strconcat (fixed.journal_path, ".index", NULL);
+
+  fixed.path = fixed_path;
+  fixed.format = check_positive_pay_format_from_path (fixed_path);
+  csv.path = csv_path;
+  csv.format = check_positive_pay_format_from_path (csv_path);
+
+  ok = journal_checks (fixed.journal_path);
+
+  if (ok)
+    {
+      bench_suite_begin (&suite, "positive_pay");
+      fixed_ns = bench_suite_run (&suite, "export/fixed", bench_export, &fixed);
+      csv_ns = bench_suite_run (&suite, "export/csv", bench_export, &csv);
+      bench_suite_end (&suite);
+
+      /* Check 1001 comes first and has a payee with quotes, check 1000 was printed again */
+      ok = fixed.n_checks == BENCH_WRITTEN && csv.n_checks == BENCH_WRITTEN
+           && check_file (&fixed,
+                          "0000000012345678900000010010000000001010314202"
+                          "4ISummit \"North\" Hardware                           ",
+                          "0000000012345678900000010000000000042000314202"
+                          "4IPacific Freight Logistics                         ")
+           && check_file (&csv,
+                          "123456789,1001,1.01,03/14/2024,\"Summit \"\"North\"\" Hardware\"",
+                          "123456789,1000,42.00,03/14/2024,\"Pacific Freight Logistics\"");
+
+      g_printerr ("Exported %u checks in %.1f ms (fixed width) and %.1f ms (CSV)\n",
+                  BENCH_WRITTEN, fixed_ns / 1e6, csv_ns / 1e6);
+    }
+
+  g_unlink (fixed_path);
+  g_unlink (csv_path);
+  g_unlink (index_path);
+  g_unlink (fixed.journal_path);
+  g_free (fixed.journal_path);
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
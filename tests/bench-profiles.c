@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Saves named profiles to a store in a temporary directory, replaces one and
+ * looks them up by name after reopening the file. A truncated file, a bad
+ * header and a record whose name is not NUL terminated must be refused when
+ * opened; the benchmark fails otherwise.
+ */
+
+#include "bench-common.h"
+#include "check-profiles.h"
+
+#include <errno.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_PROFILES (bench_size (64, 8))
+
+typedef struct
+{
+  CheckProfileStore *store;
+  char **names;
+  guint n_names;
+} BenchData;
+
+static void
+make_profile (CheckProperties *p, const char *font, double width, NumWordsLocale locale)
+{
+  memset (p, 0, sizeof (CheckProperties));
+  g_strlcpy (p->check_font, font, STRING_LEN);
+  p->check_font_height = 10;
+  p->words_locale = locale;
+  p->width = width;
+  p->height = 70.0;
+  p->name.x_pos = width / 8;
+  p->name.y_pos = 25.0;
+  p->name.width = width / 2;
+  p->magic = CHECK_PROPERTIES_MAGIC;
+}
+
+static bool
+same_profile (const CheckProperties *a, const CheckProperties *b)
+{
+  return strcmp (a->check_font, b->check_font) == 0
+         && a->check_font_height == b->check_font_height
+         && a->words_locale == b->words_locale
+         && a->width == b->width
+         && a->height == b->height
+         && memcmp (&a->name, &b->name, sizeof (FieldProperties)) == 0;
+}
+
+static void
+bench_lookup (gpointer data, guint64 iteration)
+{
+  BenchData *bench = data;
+  CheckProperties p;
+  int index = check_profile_store_lookup (bench->store, bench->names[iteration % bench->n_names]);
+
+  if (index < 0 || !check_profile_store_get (bench->store, (guint) index, &p))
+    {
+      g_printerr ("Profile %s is missing\n", bench->names[iteration % bench->n_names]);
+      exit (EXIT_FAILURE);
+    }
+
+  bench_consume ((guint64) p.width);
+}
+
+/* The profile called `name` in `store` must be `expected` */
+static bool
+check_profile (const CheckProfileStore *store, const char *name, guint index,
+               const CheckProperties *expected)
+{
+  CheckProperties p;
+
+  if (check_profile_store_lookup (store, name) != (int) index
+      || g_strcmp0 (check_profile_store_get_name (store, index), name) != 0
+      || !check_profile_store_get (store, index, &p)
+      || !same_profile (&p, expected))
+    {
+      g_printerr ("Profile %s is not the one saved at %u\n", name, index);
+      return false;
+    }
+
+  return true;
+}
+
+/* Writes `length` bytes of `contents` to `path`, which must then be refused */
+static bool
+check_refused (const char *path, const char *contents, gsize length, const char *what)
+{
+  g_autoptr (GError) error = NULL;
+  g_autoptr (CheckProfileStore) store = NULL;
+
+  if (!g_file_set_contents (path, contents, length, &error))
+    {
+      g_printerr ("Could not write %s: %s\n", path, error->message);
+      return false;
+    }
+
+  store = check_profile_store_open (path, &error);
+
+  if (store || !g_error_matches (error, CHECK_PROFILES_ERROR, CHECK_PROFILES_ERROR_FORMAT))
+    {
+      g_printerr ("A store with %s was opened: %s\n", what, error ? error->message : "no error");
+      return false;
+    }
+
+  return true;
+}
+
+/*
+ * Saves two profiles, replaces the first and reopens the file, then damages
+ * copies of it. The record size is found from the length of the file with
+ * one and two profiles, so the test does not depend on the record layout
+ * beyond the name coming first.
+ */
+static bool
+check_store (const char *path)
+{
+  g_autoptr (GError) error = NULL;
+  g_autoptr (CheckProfileStore) store = NULL;
+  g_autofree char *contents = NULL;
+  CheckProperties business, personal, wide;
+  GStatBuf st;
+  gsize one_length, length, record_size, header_size;
+
+  make_profile (&business, "Courier", 152.4, NUM_WORDS_EN_US);
+  make_profile (&personal, "Sans", 152.4, NUM_WORDS_FR);
+  make_profile (&wide, "Serif", 203.2, NUM_WORDS_DE);
+
+  store = check_profile_store_open (path, &error);
+
+  if (!store || check_profile_store_get_n_profiles (store) != 0)
+    {
+      g_printerr ("Could not open an empty store: %s\n", error ? error->message : "not empty");
+      return false;
+    }
+
+  if (!check_profile_store_put (store, "Business", &business, &error)
+      || g_stat (path, &st) < 0)
+    {
+      g_printerr ("Could not save a profile: %s\n", error ? error->message : g_strerror (errno));
+      return false;
+    }
+
+  one_length = st.st_size;
+
+  if (!check_profile_store_put (store, "Personal", &personal, &error)
+      || !check_profile_store_put (store, "Business", &wide, &error))
+    {
+      g_printerr ("Could not save a profile: %s\n", error->message);
+      return false;
+    }
+
+  if (check_profile_store_get_n_profiles (store) != 2
+      || !check_profile (store, "Business", 0, &wide)
+      || !check_profile (store, "Personal", 1, &personal))
+    {
+      return false;
+    }
+
+  g_clear_pointer (&store, check_profile_store_free);
+  store = check_profile_store_open (path, &error);
+
+  if (!store)
+    {
+      g_printerr ("Could not reopen the store: %s\n", error->message);
+      return false;
+    }
+
+  if (check_profile_store_get_n_profiles (store) != 2
+      || !check_profile (store, "Business", 0, &wide)
+      || !check_profile (store, "Personal", 1, &personal)
+      || check_profile_store_lookup (store, "Payroll") != -1)
+    {
+      g_printerr ("The reopened store does not hold what was saved\n");
+      return false;
+    }
+
+  g_clear_pointer (&store, check_profile_store_free);
+
+  if (!g_file_get_contents (path, &contents, &length, &error))
+    {
+      g_printerr ("Could not read the store: %s\n", error->message);
+      return false;
+    }
+
+  record_size = length - one_length;
+  header_size = one_length - record_size;
+
+  if (length <= one_length || one_length <= record_size
+      || record_size < CHECK_PROFILE_NAME_LEN)
+    {
+      g_printerr ("Unexpected store sizes %" G_GSIZE_FORMAT " and %" G_GSIZE_FORMAT "\n",
+                  one_length, length);
+      return false;
+    }
+
+  if (!check_refused (path, contents, length - 1, "a truncated record")
+      || !check_refused (path, contents, header_size / 2, "a truncated header"))
+    {
+      return false;
+    }
+
+  contents[0] ^= 0x20;
+
+  if (!check_refused (path, contents, length, "a bad magic"))
+    {
+      return false;
+    }
+
+  contents[0] ^= 0x20;
+  memset (contents + header_size + record_size, 'x', CHECK_PROFILE_NAME_LEN);
+
+  return check_refused (path, contents, length, "a name without a NUL");
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_autoptr (GError) error = NULL;
+  g_autofree char *dir = NULL;
+  g_autofree char *path = NULL;
+  BenchData bench = { 0 };
+  CheckProperties p;
+  BenchSuite suite;
+  bool ok;
+
+  bench_init (argc, argv);
+
+  dir = g_dir_make_tmp ("checkwriter-profiles-XXXXXX", &error);
+
+  if (!dir)
+    {
+      g_printerr ("Could not create a directory: %s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  path = g_build_filename (dir, "profiles.bin", NULL);
+  ok = check_store (path);
+  g_unlink (path);
+
+  bench.store = ok ? check_profile_store_open (path, &error) : NULL;
+  bench.n_names = BENCH_PROFILES;
+  bench.names = g_new0 (char *, bench.n_names + 1);
+
+  for (guint i = 0; ok && i < bench.n_names; ++i)
+    {
+      bench.names[i] = g_strdup_printf ("Stock %u", i);
+      make_profile (&p, "Courier", 150.0 + i, NUM_WORDS_EN_US);
+      ok = bench.store && check_profile_store_put (bench.store, bench.names[i], &p, &error);
+    }
+
+  if (ok)
+    {
+      bench_suite_begin (&suite, "profiles");
+      bench_suite_run (&suite, "lookup_get", bench_lookup, &bench);
+      bench_suite_end (&suite);
+    }
+  else if (error)
+    {
+      g_printerr ("Could not save the profiles: %s\n", error->message);
+    }
+
+  g_clear_pointer (&bench.store, check_profile_store_free);
+  g_strfreev (bench.names);
+  g_unlink (path);
+  g_rmdir (dir);
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2024 Ayan Shafqat <ayan@shafq.at>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Checks num_to_words () for every uint32_t, split across one thread per
+ * processor. Each number is compared against a reference spelled digit by
+ * digit, without the generated tables, and the buffer length is checked at
+ * its limits: the words must be shorter than STRING_LEN, must fit in exactly
+ * their length plus the NUL, and one byte less must fail without writing
+ * past the buffer.
+ *
+ *   verify-num-to-words [COUNT]
+ *
+ * checks the numbers below COUNT, all of them by default.
+ */
+
+#include "check-properties.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VERIFY_CHUNK (1u << 16)    /* Numbers per unit of work */
+#define VERIFY_MAX_REPORTS (10)    /* Mismatches printed in full */
+#define VERIFY_GUARD ('\xa5')      /* Fills the buffer past `len` */
+
+static const char *REF_UNIT[] = {
+  "zero", "one", "two", "three", "four", "five", "six", "seven", "eight",
+  "nine", "ten", "eleven", "twelve", "thirteen", "fourteen", "fifteen",
+  "sixteen", "seventeen", "eighteen", "nineteen",
+};
+
+static const char *REF_TENS[] = {
+  "", "", "twenty", "thirty", "forty", "fifty", "sixty", "seventy",
+  "eighty", "ninety",
+};
+
+static const char *REF_SCALE[] = {
+  "", " thousand", " million", " billion",
+};
+
+typedef struct
+{
+  guint64 count;
+  gint next_chunk;
+
+  GMutex lock;
+  guint n_reports;      /* Protected by `lock` */
+  guint64 n_mismatches; /* Protected by `lock` */
+  size_t max_len;       /* Protected by `lock` */
+} Verify;
+
+/* Words for 1-999 */
+static char *
+ref_below_1000 (char *cur, uint32_t num)
+{
+  if (num >= 100)
+    {
+      cur = stpcpy (cur, REF_UNIT[num / 100]);
+      cur = stpcpy (cur, " hundred");
+      num %= 100;
+
+      if (num == 0)
+        {
+          return cur;
+        }
+
+      *cur++ = ' ';
+    }
+
+  if (num < 20)
+    {
+      return stpcpy (cur, REF_UNIT[num]);
+    }
+
+  cur = stpcpy (cur, REF_TENS[num / 10]);
+
+  if (num % 10)
+    {
+      *cur++ = '-';
+      cur = stpcpy (cur, REF_UNIT[num % 10]);
+    }
+
+  return cur;
+}
+
+/* The expected words for `num`, returning their length */
+static size_t
+ref_num_to_words (char *dst, uint32_t num)
+{
+  static const uint32_t SCALE[] = { 1, 1000, 1000000, 1000000000 };
+  char *cur = dst;
+
+  if (num == 0)
+    {
+      return stpcpy (dst, REF_UNIT[0]) - dst;
+    }
+
+  for (int i = G_N_ELEMENTS (SCALE) - 1; i >= 0; --i)
+    {
+      uint32_t group = (num / SCALE[i]) % 1000;
+
+      if (group == 0)
+        {
+          continue;
+        }
+
+      if (cur != dst)
+        {
+          *cur++ = ' ';
+        }
+
+      cur = ref_below_1000 (cur, group);
+      cur = stpcpy (cur, REF_SCALE[i]);
+    }
+
+  return cur - dst;
+}
+
+static bool
+guard_intact (const char *buffer, size_t from, size_t to)
+{
+  for (size_t i = from; i < to; ++i)
+    {
+      if (buffer[i] != VERIFY_GUARD)
+        {
+          return false;
+        }
+    }
+
+  return true;
+}
+
+/* Returns NULL if num_to_words () is right about `num`, or what is wrong */
+static const char *
+verify_one (uint32_t num, char *expected, char *actual, size_t *words_len)
+{
+  size_t len = ref_num_to_words (expected, num);
+  int written;
+
+  *words_len = len;
+
+  if (len >= STRING_LEN)
+    {
+      return "words do not fit in STRING_LEN";
+    }
+
+  /* Room for the words and the NUL only */
+  memset (actual, VERIFY_GUARD, len + 2);
+  written = num_to_words (actual, len + 1, num);
+
+  if (written != (int) len || memcmp (actual, expected, len + 1) != 0)
+    {
+      return "wrong words";
+    }
+
+  if (!guard_intact (actual, len + 1, len + 2))
+    {
+      return "wrote past the buffer";
+    }
+
+  /* One byte short */
+  memset (actual, VERIFY_GUARD, len + 1);
+  written = num_to_words (actual, len, num);
+
+  if (written != -1 || actual[0] != '\0')
+    {
+      return "did not fail in a short buffer";
+    }
+
+  if (!guard_intact (actual, len, len + 1))
+    {
+      return "wrote past a short buffer";
+    }
+
+  return NULL;
+}
+
+static gpointer
+verify_thread (gpointer data)
+{
+  Verify *verify = data;
+  guint64 n_chunks = (verify->count + VERIFY_CHUNK - 1) / VERIFY_CHUNK;
+  char expected[STRING_LEN * 2], actual[STRING_LEN * 2];
+  guint64 n_mismatches = 0;
+  size_t max_len = 0;
+
+  for (;;)
+    {
+      guint64 chunk = (guint) g_atomic_int_add (&verify->next_chunk, 1);
+      guint64 first = chunk * VERIFY_CHUNK;
+      guint64 last = MIN (first + VERIFY_CHUNK, verify->count);
+
+      if (chunk >= n_chunks)
+        {
+          break;
+        }
+
+      for (guint64 num = first; num < last; ++num)
+        {
+          size_t len;
+          const char *problem = verify_one ((uint32_t) num, expected, actual, &len);
+
+          max_len = MAX (max_len, len);
+
+          if (G_LIKELY (!problem))
+            {
+              continue;
+            }
+
+          g_mutex_lock (&verify->lock);
+
+          if (verify->n_reports++ < VERIFY_MAX_REPORTS)
+            {
+              int written = num_to_words (actual, STRING_LEN, (uint32_t) num);
+
+              g_printerr ("%" G_GUINT64_FORMAT ": %s\n  expected \"%s\"\n  got      \"%s\" (%d)\n",
+                          num, problem, expected, written < 0 ? "" : actual, written);
+            }
+
+          g_mutex_unlock (&verify->lock);
+          ++n_mismatches;
+        }
+    }
+
+  g_mutex_lock (&verify->lock);
+  verify->n_mismatches += n_mismatches;
+  verify->max_len = MAX (verify->max_len, max_len);
+  g_mutex_unlock (&verify->lock);
+
+  return NULL;
+}
+
+int
+main (int argc, char *argv[])
+{
+  guint n_threads = g_get_num_processors ();
+  g_autofree GThread **threads = g_new0 (GThread *, n_threads);
+  Verify verify = { 0 };
+  gint64 start;
+  double seconds;
+
+  verify.count = G_GUINT64_CONSTANT (1) << 32;
+
+  if (argc > 1)
+    {
+      verify.count = MIN (g_ascii_strtoull (argv[1], NULL, 10), verify.count);
+    }
+
+  g_mutex_init (&verify.lock);
+  start = g_get_monotonic_time ();
+
+  for (guint i = 0; i < n_threads; ++i)
+    {
+      threads[i] = g_thread_new ("verify", verify_thread, &verify);
+    }
+
+  for (guint i = 0; i < n_threads; ++i)
+    {
+      g_thread_join (threads[i]);
+    }
+
+  seconds = (g_get_monotonic_time () - start) / 1e6;
+  g_mutex_clear (&verify.lock);
+
+  g_print ("Checked %" G_GUINT64_FORMAT " numbers on %u threads in %.1f s (%.1f M/s): "
+           "%" G_GUINT64_FORMAT " mismatches, longest words %zu of %d bytes\n",
+           verify.count, n_threads, seconds, verify.count / seconds / 1e6,
+           verify.n_mismatches, verify.max_len, STRING_LEN);
+
+  return verify.n_mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}